@@ -2,6 +2,7 @@
 
 #include "RemoteCallClient.h"
 #include "RemoteCallServer.h"
+#include "RemoteCallStream.h"
 
 // Declare remote function
 #define REMOTE_FUNCTION_DECL(f) \
@@ -12,11 +13,25 @@
 	f(Args&&...args) { return RemoteCall::GetFunctionInfo<Args...>(#f, decltype(&f##RemoteFunction)(), args...); } \
     decltype(f##DeclRemoteFunctionReturn()) f##RemoteFunction
 
+// Declare remote function which result is cached by client transport during 'ttlMs' milliseconds, 
+// at most 'maxEntries' results (for different parameters) are cached
+#define REMOTE_CACHED_FUNCTION_DECL(f, ttlMs, maxEntries) \
+    f##DeclRemoteFunctionReturn(); \
+    using f##DeclRemoteFunctionReturnType = decltype(f##DeclRemoteFunctionReturn()); \
+    template <typename ...Args> \
+	RemoteCall::FunctionInfo<RemoteCall::UseSendReceive<f##DeclRemoteFunctionReturnType, Args...>(), f##DeclRemoteFunctionReturnType> \
+	f(Args&&...args) \
+	{ \
+	    static_assert(RemoteCall::Cacheable(decltype(&f##RemoteFunction)()), "Cached function should return value and have only input parameters"); \
+	    return RemoteCall::GetFunctionInfo<Args...>(#f, decltype(&f##RemoteFunction)(), args...).Cache(std::chrono::milliseconds(ttlMs), maxEntries); \
+	} \
+    decltype(f##DeclRemoteFunctionReturn()) f##RemoteFunction
+
 // Implement remote function
 #define REMOTE_FUNCTION_IMPL(f) \
     f##ImplRemoteFunctionReturn(); \
     static bool f##registerRemoteFunction = RemoteCall::RegisterFunc(#f, &f##RemoteFunction); \
-    static decltype(f##ImplRemoteFunctionReturn()) f##RemoteFunction
+    decltype(f##ImplRemoteFunctionReturn()) f##RemoteFunction
 
 
 // Declare remote interface
@@ -0,0 +1,366 @@
+// Admission - server admission control: adaptive limit of calls in flight, bounded waiting queues per priority,
+// per-client rate limit. Rejected call fails fast with Exception::Overloaded, so client can back off or use another server.
+// Waiting call does not block a thread: it is parked and resumed by the thread which admits it (the one leaving admission).
+
+#pragma once
+
+#include "RemoteCallFrame.h"
+#include "RemoteCallException.h"
+#include "RemoteCallCancellation.h"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <exception>
+#include <algorithm>
+#include <functional>
+
+namespace RemoteCall
+{
+    struct AdmissionPolicy
+    {
+        // Limit of calls in flight: initial, minimal and maximal values
+        size_t initialLimit_ = 32;
+        size_t minLimit_ = 1;
+        size_t maxLimit_ = 1024;
+
+        // AIMD: limit is multiplied by 'decrease_' when recent service time exceeds 'tolerance_' times long-term service time,
+        // otherwise it is increased by 1 per 'limit' calls while it is used at least by half
+        double tolerance_ = 2.0;
+        double decrease_ = 0.9;
+
+        // Calls waiting for admission per priority, call is rejected when queue of its priority is full
+        size_t queueSize_ = 256;
+
+        // Calls per second and burst of each client id (0 - not limited), calls without client id are not limited
+        double clientRate_ = 0;
+        double clientBurst_ = 0;
+    };
+
+
+    struct Admission
+    {
+        // Called when parked call is admitted (with null), or with DeadlineExceeded if its deadline passed while it waited
+        typedef std::function<void(std::exception_ptr pError)> Resume;
+        typedef std::vector<std::pair<Resume, std::exception_ptr>> Resumed;
+
+        // Admission is disabled until it is configured
+        void Configure(const AdmissionPolicy& policy)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            policy_ = policy;
+            limit_ = (double)policy.initialLimit_;
+            buckets_.clear();
+
+            enabled_ = true;
+        }
+
+        // Parked calls are admitted
+        void Disable()
+        {
+            Resumed resumed;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                enabled_ = false;
+
+                for (auto& queue: queues_)
+                {
+                    for (auto& el: queue)
+                    {
+                        inFlight_++;
+                        resumed.emplace_back(std::move(el.resume_), nullptr);
+                    }
+
+                    queue.clear();
+                }
+            }
+
+            Run(resumed);
+        }
+
+        bool Enabled() const
+        {
+            return enabled_;
+        }
+
+        // Returns true if the call is admitted, false if it is parked until 'resume' is called. Throws Overloaded if it is rejected.
+        // Deadline of parked call is checked when calls leave or are parked.
+        bool Enter(const FrameHeader& header, Resume resume)
+        {
+            Resumed expired;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!header.clientId_.empty()  &&  policy_.clientRate_ > 0  &&  !Take(header.clientId_))
+                    throw Exception(Exception::Overloaded, ToString() << "Rate limit of client " << header.clientId_ << " is exceeded.");
+
+                size_t priority = std::min<size_t>(header.priority_, PriorityCount - 1);
+
+                if (inFlight_ < (size_t)limit_  &&  !Waiting(priority))
+                {
+                    inFlight_++;
+                    return true;
+                }
+
+                RemoveExpired(expired);
+
+                auto& queue = queues_[priority];
+                if (queue.size() >= policy_.queueSize_)
+                    throw Exception(Exception::Overloaded, "Server is overloaded.");
+
+                queue.push_back(Waiter{ std::move(resume), header.deadline_ });
+            }
+
+            Run(expired);
+
+            return false;
+        }
+
+        // Called when admitted call is done, 'serviceTime' adjusts the limit. Admitted parked calls are resumed by this thread.
+        void Leave(std::chrono::steady_clock::duration serviceTime)
+        {
+            Resumed resumed;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                inFlight_--;
+
+                Adjust((double)std::chrono::duration_cast<std::chrono::microseconds>(serviceTime).count());
+
+                RemoveExpired(resumed);
+
+                // Waiters of higher priority first
+                for (size_t priority = PriorityCount; priority--  &&  inFlight_ < (size_t)limit_;)
+                {
+                    auto& queue = queues_[priority];
+
+                    while (!queue.empty()  &&  inFlight_ < (size_t)limit_)
+                    {
+                        inFlight_++;
+
+                        resumed.emplace_back(std::move(queue.front().resume_), nullptr);
+                        queue.pop_front();
+                    }
+                }
+            }
+
+            Run(resumed);
+        }
+
+        size_t Limit()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return (size_t)limit_;
+        }
+
+        size_t InFlight()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return inFlight_;
+        }
+
+        size_t Parked()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            size_t count = 0;
+            for (auto& queue: queues_)
+            {
+                count += queue.size();
+            }
+
+            return count;
+        }
+
+    private:
+        struct Waiter
+        {
+            Resume resume_;
+            Deadline deadline_;
+        };
+
+        // Moves waiters whose deadline passed to 'expired'
+        void RemoveExpired(Resumed& expired)
+        {
+            auto now = std::chrono::system_clock::now();
+
+            for (auto& queue: queues_)
+            {
+                for (auto it = queue.begin(); it != queue.end();)
+                {
+                    if (it->deadline_ > now)
+                    {
+                        ++it;
+                        continue;
+                    }
+
+                    expired.emplace_back(std::move(it->resume_), 
+                        std::make_exception_ptr(Exception(Exception::DeadlineExceeded, "Deadline exceeded while waiting for admission.")));
+
+                    it = queue.erase(it);
+                }
+            }
+        }
+
+        // Resumes calls without the lock. Call resumed by a resumed call (it leaves admission) is run after it, not inside it.
+        static void Run(Resumed& resumed)
+        {
+            if (resumed.empty())
+                return;
+
+            auto& pPending = Pending();
+            if (pPending)
+            {
+                pPending->insert(pPending->end(), std::make_move_iterator(resumed.begin()), std::make_move_iterator(resumed.end()));
+                return;
+            }
+
+            std::deque<std::pair<Resume, std::exception_ptr>> pending(std::make_move_iterator(resumed.begin()), std::make_move_iterator(resumed.end()));
+
+            struct PendingScope
+            {
+                PendingScope(std::deque<std::pair<Resume, std::exception_ptr>>* pPending) { Pending() = pPending; }
+                ~PendingScope() { Pending() = nullptr; }
+            };
+
+            PendingScope scope(&pending);
+
+            while (!pending.empty())
+            {
+                auto el = std::move(pending.front());
+                pending.pop_front();
+
+                el.first(el.second);
+            }
+        }
+
+        // Calls resumed by this thread
+        static std::deque<std::pair<Resume, std::exception_ptr>>*& Pending()
+        {
+            thread_local std::deque<std::pair<Resume, std::exception_ptr>>* t_pPending = nullptr; return t_pPending;
+        }
+
+        // Token bucket of a client
+        struct Bucket
+        {
+            double tokens_;
+            std::chrono::steady_clock::time_point updated_;
+        };
+
+        // Call of this priority should wait if calls of the same or higher priority wait
+        bool Waiting(size_t priority) const
+        {
+            for (size_t i = priority; i < PriorityCount; i++)
+            {
+                if (!queues_[i].empty())
+                    return true;
+            }
+
+            return false;
+        }
+
+        bool Take(const std::string& clientId)
+        {
+            auto now = std::chrono::steady_clock::now();
+            double burst = std::max(1.0, policy_.clientBurst_);
+
+            // Full buckets of inactive clients are removed
+            if (buckets_.size() >= MaxBuckets)
+            {
+                for (auto it = buckets_.begin(); it != buckets_.end();)
+                {
+                    if (it->second.tokens_ + Seconds(now - it->second.updated_) * policy_.clientRate_ >= burst)
+                    {
+                        it = buckets_.erase(it);
+                    }
+                    else
+                    {
+                        ++it;
+                    }
+                }
+            }
+
+            auto it = buckets_.find(clientId);
+            if (it == buckets_.end())
+            {
+                it = buckets_.insert(std::make_pair(clientId, Bucket{ burst, now })).first;
+            }
+
+            auto& bucket = it->second;
+
+            bucket.tokens_ = std::min(burst, bucket.tokens_ + Seconds(now - bucket.updated_) * policy_.clientRate_);
+            bucket.updated_ = now;
+
+            if (bucket.tokens_ < 1)
+                return false;
+
+            bucket.tokens_ -= 1;
+
+            return true;
+        }
+
+        // Recent (short-term) and long-term average service times are compared
+        void Adjust(double serviceTime)
+        {
+            if (!longTerm_)
+            {
+                longTerm_ = shortTerm_ = serviceTime;
+            }
+
+            shortTerm_ += (serviceTime - shortTerm_) * 0.1;
+            longTerm_ += (serviceTime - longTerm_) * 0.01;
+
+            // Limit is decreased at most once per 'limit' calls, so effect of the previous decrease is measured
+            callsSinceDecrease_++;
+
+            if (shortTerm_ > longTerm_ * policy_.tolerance_)
+            {
+                if (callsSinceDecrease_ >= (size_t)limit_)
+                {
+                    limit_ = std::max((double)policy_.minLimit_, limit_ * policy_.decrease_);
+                    callsSinceDecrease_ = 0;
+                }
+            }
+            else if (inFlight_ + 1 >= limit_ / 2)
+            {
+                limit_ = std::min((double)policy_.maxLimit_, limit_ + 1 / limit_);
+            }
+        }
+
+        static double Seconds(std::chrono::steady_clock::duration duration)
+        {
+            return std::chrono::duration<double>(duration).count();
+        }
+
+        enum { MaxBuckets = 10000 };
+
+        AdmissionPolicy policy_;
+        std::atomic<bool> enabled_{false};
+
+        double limit_ = 0;
+        size_t inFlight_ = 0;
+        std::deque<Waiter> queues_[PriorityCount];
+
+        double shortTerm_ = 0;
+        double longTerm_ = 0;
+        size_t callsSinceDecrease_ = 0;
+
+        std::map<std::string, Bucket> buckets_;
+
+        std::mutex locker_;
+    };
+
+    inline Admission* GetAdmission()
+    {
+        static Admission s_admission; return &s_admission;
+    }
+}
@@ -0,0 +1,111 @@
+// CallArena - per-thread monotonic arena of the call processed by server, it is released when the call is done.
+// Declared parameters of std::pmr types (std::pmr::string, std::pmr::vector, std::pmr::map...) are created in it, so their
+// deserialization allocates almost nothing from the global heap. They are valid during the call, handler copies what it keeps.
+// Handler can use the arena for its temporaries too: std::pmr::vector<int> v(RemoteCall::CurrentArena());
+
+#pragma once
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>)  &&  (__cplusplus >= 201703L  ||  (defined(_MSVC_LANG)  &&  _MSVC_LANG >= 201703L))
+#define REMOTE_CALL_PMR
+#endif
+#endif
+
+#include <tuple>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+#ifdef REMOTE_CALL_PMR
+#include <memory_resource>
+#endif
+
+namespace RemoteCall
+{
+#ifdef REMOTE_CALL_PMR
+    struct CallArena
+    {
+        CallArena()
+            : buffer_(InitialSize), resource_(buffer_.data(), buffer_.size())
+        {}
+
+        CallArena(const CallArena&) = delete;
+        void operator = (const CallArena&) = delete;
+
+        std::pmr::memory_resource* Resource()
+        {
+            return &resource_;
+        }
+
+        bool Active() const
+        {
+            return depth_ > 0;
+        }
+
+        // Calls can be nested (for instance frames of '~Batch'), the arena is released when the outer one is done
+        void Enter()
+        {
+            depth_++;
+        }
+
+        void Leave()
+        {
+            if (!--depth_)
+            {
+                resource_.release();
+            }
+        }
+
+    private:
+        // Calls which need more allocate next buffers from the global heap
+        enum { InitialSize = 64 * 1024 };
+
+        std::vector<char> buffer_;
+        std::pmr::monotonic_buffer_resource resource_;
+        size_t depth_ = 0;
+    };
+
+    inline CallArena& GetCallArena()
+    {
+        thread_local CallArena t_arena; return t_arena;
+    }
+
+    // Arena of the call processed by this thread, or the default resource outside of calls
+    inline std::pmr::memory_resource* CurrentArena()
+    {
+        auto& arena = GetCallArena();
+
+        return arena.Active()? arena.Resource(): std::pmr::get_default_resource();
+    }
+
+    struct CallArenaScope
+    {
+        CallArenaScope()
+        {
+            GetCallArena().Enter();
+        }
+
+        ~CallArenaScope()
+        {
+            GetCallArena().Leave();
+        }
+
+        CallArenaScope(const CallArenaScope&) = delete;
+        void operator = (const CallArenaScope&) = delete;
+    };
+
+    // Parameters read by server, parameters of std::pmr types are created in the arena of the call
+    template <typename ...T>
+    struct CallParams: public std::tuple<T...>
+    {
+        CallParams()
+            : std::tuple<T...>(std::allocator_arg, std::pmr::polymorphic_allocator<char>(CurrentArena()))
+        {}
+    };
+#else
+    struct CallArenaScope {};
+
+    template <typename ...T>
+    struct CallParams: public std::tuple<T...> {};
+#endif
+}
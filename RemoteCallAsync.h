@@ -0,0 +1,292 @@
+// Async - result of server handler which is completed later. Handler returns it without waiting, and the reply is sent
+// when it is resolved, so a worker thread is not blocked while the call is in progress:
+//     RemoteCall::Async<int> REMOTE_FUNCTION_IMPL(Compute)(int n)
+//     {
+//         RemoteCall::Async<int> result;
+//         pool.Post([=]() mutable { result.Resolve(n * 2); });
+//         return result;
+//     }
+// Client receives resolved Async:  int n = transport(Compute(1)).Get();
+// Async whose copies are all destroyed before it is completed is rejected (client receives ServerError).
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+
+#include <mutex>
+#include <memory>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace RemoteCall
+{
+    // AsyncState - shared by copies of Async
+    struct AsyncState
+    {
+        bool Ready()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return ready_;
+        }
+
+        // Waits until it is completed, rethrows exception of rejected one
+        void Wait()
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            cv_.wait(lock, [this] { return ready_; });
+
+            if (exception_)
+                std::rethrow_exception(exception_);
+        }
+
+        // 'f' is called once when it is completed, by this thread if it is completed already
+        void Then(std::function<void()> f)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!ready_)
+                {
+                    continuation_ = std::move(f);
+                    return;
+                }
+            }
+
+            f();
+        }
+
+        // Called with locked 'locker_' after the result is set
+        void Complete(std::unique_lock<std::mutex>& lock)
+        {
+            ready_ = true;
+
+            auto continuation = std::move(continuation_);
+
+            lock.unlock();
+            cv_.notify_all();
+
+            if (continuation)
+            {
+                continuation();
+            }
+        }
+
+        void Reject(std::exception_ptr exception)
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            if (ready_)
+                return;
+
+            exception_ = exception;
+
+            Complete(lock);
+        }
+
+        std::mutex locker_;
+
+    protected:
+        bool ready_ = false;
+
+    private:
+        std::exception_ptr exception_;
+        std::function<void()> continuation_;
+        std::condition_variable cv_;
+    };
+
+
+    template <typename State>
+    struct AsyncBase
+    {
+        AsyncBase()
+            : pPromise_(std::make_shared<Promise>())
+        {}
+
+        bool Ready() const
+        {
+            return pPromise_->pState_->Ready();
+        }
+
+        // Completes it with exception, which is sent to client as exception of the handler
+        void Reject(std::exception_ptr exception)
+        {
+            pPromise_->pState_->Reject(exception);
+        }
+
+        void Then(std::function<void()> f) const
+        {
+            pPromise_->pState_->Then(std::move(f));
+        }
+
+        // State without the promise to complete it: the reply waits for the state, while copies of Async can complete it
+        const std::shared_ptr<State>& GetState() const
+        {
+            return pPromise_->pState_;
+        }
+
+    protected:
+        // Shared by copies of Async, the state is rejected when the last of them is destroyed before it is completed
+        struct Promise
+        {
+            Promise()
+                : pState_(std::make_shared<State>())
+            {}
+
+            ~Promise()
+            {
+                pState_->Reject(std::make_exception_ptr(Exception(Exception::ServerError, "Async is destroyed before it is completed.")));
+            }
+
+            std::shared_ptr<State> pState_;
+        };
+
+        State& GetStateRef() const
+        {
+            return *pPromise_->pState_;
+        }
+
+        std::shared_ptr<Promise> pPromise_;
+    };
+
+
+    template <typename T>
+    struct AsyncValue: public AsyncState
+    {
+        // Sets the value if it is not completed yet
+        void Resolve(const T& value)
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            if (ready_)
+                return;
+
+            value_ = value;
+
+            Complete(lock);
+        }
+
+        // Waits for the value
+        const T& Get()
+        {
+            Wait();
+
+            return value_;
+        }
+
+    private:
+        T value_;
+    };
+
+    struct AsyncVoid: public AsyncState
+    {
+        void Resolve()
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            if (ready_)
+                return;
+
+            Complete(lock);
+        }
+    };
+
+    template <typename T>
+    struct Async: public AsyncBase<AsyncValue<T>>
+    {
+        Async() {}
+
+        // Resolved (handler can return value directly)
+        Async(const T& value)
+        {
+            Resolve(value);
+        }
+
+        // Waits for the result
+        const T& Get() const
+        {
+            return this->GetStateRef().Get();
+        }
+
+        operator const T& () const
+        {
+            return Get();
+        }
+
+        // Ignored if it is completed already
+        void Resolve(const T& value)
+        {
+            this->GetStateRef().Resolve(value);
+        }
+    };
+
+    template <>
+    struct Async<void>: public AsyncBase<AsyncVoid>
+    {
+        void Get() const
+        {
+            GetStateRef().Wait();
+        }
+
+        void Resolve()
+        {
+            GetStateRef().Resolve();
+        }
+    };
+
+
+    template <typename T>
+    struct IsAsync: public std::false_type {};
+
+    template <typename T>
+    struct IsAsync<Async<T>>: public std::true_type {};
+
+
+    // Reply contains the result, client receives resolved Async
+    template <typename T>
+    Serializer& operator << (Serializer& writer, const Async<T>& async)
+    {
+        return writer << async.Get();
+    }
+
+    inline Serializer& operator << (Serializer& writer, const Async<void>& async)
+    {
+        async.Get();
+
+        return writer;
+    }
+
+    template <typename T>
+    Serializer& operator << (Serializer& writer, AsyncValue<T>& state)
+    {
+        return writer << state.Get();
+    }
+
+    inline Serializer& operator << (Serializer& writer, AsyncVoid& state)
+    {
+        state.Wait();
+
+        return writer;
+    }
+
+    template <typename T>
+    Serializer& operator >> (Serializer& reader, Async<T>& async)
+    {
+        T t;
+        reader >> t;
+
+        async.Resolve(t);
+
+        return reader;
+    }
+
+    inline Serializer& operator >> (Serializer& reader, Async<void>& async)
+    {
+        async.Resolve();
+
+        return reader;
+    }
+}
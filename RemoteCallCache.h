@@ -0,0 +1,147 @@
+// ResultCache - client cache of replies of functions declared via REMOTE_CACHED_FUNCTION_DECL,
+// keyed by function name and serialized parameters (not by the frame header), with TTL and LRU eviction per function.
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <chrono>
+
+namespace RemoteCall
+{
+    struct ResultCache
+    {
+        ResultCache() {}
+
+        // Copy of transport has its own cache
+        ResultCache(const ResultCache&) {}
+
+        void operator = (const ResultCache&) {}
+
+        // Cache of the transport which received the callback processed by this thread, it is invalidated by server via '~InvalidateCache'
+        static ResultCache*& Current()
+        {
+            thread_local ResultCache* t_pCache = nullptr; return t_pCache;
+        }
+
+        struct Scope
+        {
+            Scope(ResultCache* pCache)
+                : pPrevious_(Current())
+            {
+                Current() = pCache;
+            }
+
+            ~Scope()
+            {
+                Current() = pPrevious_;
+            }
+
+        private:
+            ResultCache* pPrevious_;
+        };
+
+        bool Find(const std::string& function, const std::string& frame, std::vector<char>& reply)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto itFunction = mapNameFunction_.find(function);
+            if (itFunction == mapNameFunction_.end())
+                return false;
+
+            auto& entries = itFunction->second;
+
+            auto it = entries.mapFrameEntry_.find(frame);
+            if (it == entries.mapFrameEntry_.end())
+                return false;
+
+            if (std::chrono::steady_clock::now() >= it->second.expires_)
+            {
+                entries.lru_.erase(it->second.itLru_);
+                entries.mapFrameEntry_.erase(it);
+                return false;
+            }
+
+            entries.lru_.splice(entries.lru_.begin(), entries.lru_, it->second.itLru_);
+
+            reply = it->second.reply_;
+
+            return true;
+        }
+
+        void Add(const std::string& function, const std::string& frame, const std::vector<char>& reply, std::chrono::milliseconds ttl, size_t maxEntries)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto& entries = mapNameFunction_[function];
+
+            auto it = entries.mapFrameEntry_.find(frame);
+            if (it != entries.mapFrameEntry_.end())
+            {
+                entries.lru_.erase(it->second.itLru_);
+                entries.mapFrameEntry_.erase(it);
+            }
+
+            entries.lru_.push_front(frame);
+            entries.mapFrameEntry_.insert(std::make_pair(frame, Entry{ reply, std::chrono::steady_clock::now() + ttl, entries.lru_.begin() }));
+
+            while (entries.mapFrameEntry_.size() > maxEntries)
+            {
+                entries.mapFrameEntry_.erase(entries.lru_.back());
+                entries.lru_.pop_back();
+            }
+        }
+
+        // Removes results of 'function' (of all functions if it is empty), or only result of the call 'frame'
+        void Invalidate(const std::string& function, const std::string& frame = std::string())
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            if (function.empty())
+            {
+                mapNameFunction_.clear();
+                return;
+            }
+
+            auto itFunction = mapNameFunction_.find(function);
+            if (itFunction == mapNameFunction_.end())
+                return;
+
+            if (frame.empty())
+            {
+                mapNameFunction_.erase(itFunction);
+                return;
+            }
+
+            auto& entries = itFunction->second;
+
+            auto it = entries.mapFrameEntry_.find(frame);
+            if (it != entries.mapFrameEntry_.end())
+            {
+                entries.lru_.erase(it->second.itLru_);
+                entries.mapFrameEntry_.erase(it);
+            }
+        }
+
+    private:
+        struct Entry
+        {
+            std::vector<char> reply_;
+            std::chrono::steady_clock::time_point expires_;
+            std::list<std::string>::iterator itLru_;
+        };
+
+        // Results of a function, the most recently used frame is the first in 'lru_'
+        struct Entries
+        {
+            std::map<std::string, Entry> mapFrameEntry_;
+            std::list<std::string> lru_;
+        };
+
+        std::map<std::string, Entries> mapNameFunction_;
+        std::mutex locker_;
+    };
+}
@@ -0,0 +1,367 @@
+// CallbackQueue - one-way calls to a client (callbacks) are queued and sent by sender threads, so a server thread
+// handling a request is not blocked by slow client. Consecutive queued calls are sent in one '~Batch' frame.
+//     static RemoteCall::CallbackQueue<ServerTransport> s_callbacks(s_transport);
+//     s_callbacks(s_pCallback->CallFromServer(12345));
+
+#pragma once
+
+#include "RemoteCallClient.h"
+
+#include <deque>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+namespace RemoteCall
+{
+    enum CallbackOverflow
+    {
+        DropNewest,     // call which does not fit is dropped
+        DropOldest,     // the oldest queued call is dropped
+        Block           // caller waits until the call fits
+    };
+
+    struct CallbackPolicy
+    {
+        // Queued calls and their total size, the overflow policy applies when either is exceeded
+        size_t queueSize_ = 1024;
+        size_t queueBytes_ = 16 * 1024 * 1024;
+        CallbackOverflow overflow_ = DropOldest;
+
+        // Calls and bytes sent in one frame
+        size_t maxBatch_ = 256;
+        size_t maxBatchBytes_ = 1024 * 1024;
+    };
+
+    struct CallbackMetrics
+    {
+        uint64_t queued_ = 0;
+        uint64_t sent_ = 0;
+        uint64_t batches_ = 0;
+        uint64_t dropped_ = 0;
+        uint64_t failed_ = 0;       // calls of frames which transport failed to send
+        size_t pending_ = 0;        // calls in the queue
+    };
+
+
+    // CallbackSenders - threads which send queued callbacks, a queue is sent by one thread at a time.
+    // Queues take turns after each frame, so a slow client holds one thread and does not delay other clients while threads are free.
+    struct CallbackSenders
+    {
+        CallbackSenders(size_t threads = 4)
+            : threadCount_(std::max<size_t>(1, threads))
+        {}
+
+        ~CallbackSenders()
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                stop_ = true;
+            }
+
+            cv_.notify_all();
+
+            for (auto& thread: threads_)
+            {
+                thread.join();
+            }
+        }
+
+        // Threads are started by the first task
+        void Run(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                tasks_.push_back(std::move(task));
+
+                while (threads_.size() < threadCount_)
+                {
+                    threads_.emplace_back([this] { Work(); });
+                }
+            }
+
+            cv_.notify_one();
+        }
+
+    private:
+        void Work()
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            while (true)
+            {
+                cv_.wait(lock, [this] { return stop_  ||  !tasks_.empty(); });
+
+                if (stop_)
+                    return;
+
+                auto task = std::move(tasks_.front());
+                tasks_.pop_front();
+
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+
+        size_t threadCount_;
+        std::vector<std::thread> threads_;
+        std::deque<std::function<void()>> tasks_;
+        bool stop_ = false;
+        std::mutex locker_;
+        std::condition_variable cv_;
+    };
+
+    inline CallbackSenders* GetCallbackSenders()
+    {
+        static CallbackSenders s_callbackSenders; return &s_callbackSenders;
+    }
+
+
+    // Frame of several calls, client processes them in order
+    inline FunctionInfo<false, void> BatchCall(const std::vector<std::vector<char>>& frames)
+    {
+        return FunctionInfo<false, void>("~Batch", std::vector<Param>{ ParamType<false>(frames) });
+    }
+
+
+    template <typename T>
+    struct CallbackQueue
+    {
+        CallbackQueue(T& transport, const CallbackPolicy& policy = CallbackPolicy(), CallbackSenders* pSenders = GetCallbackSenders())
+            : pState_(std::make_shared<State>(transport, policy, pSenders))
+        {}
+
+        // Calls which are not sent yet are dropped, call being sent is waited for
+        ~CallbackQueue()
+        {
+            pState_->Close();
+        }
+
+        CallbackQueue(const CallbackQueue&) = delete;
+        void operator = (const CallbackQueue&) = delete;
+
+        // Queues the call, returns false if it is dropped
+        template <bool useSendReceive, typename Ret>
+        bool operator()(const CallInfo<useSendReceive, Ret>& callInfo)
+        {
+            static_assert(!useSendReceive, "Only one-way calls (returning void with input parameters) can be queued");
+
+            Serializer writer;
+            pState_->transport_.WriteFrame(callInfo, writer, false);
+
+            return pState_->Push(writer);
+        }
+
+        // Waits until queued calls are sent
+        void Flush()
+        {
+            pState_->Flush();
+        }
+
+        CallbackMetrics Metrics() const
+        {
+            return pState_->Metrics();
+        }
+
+    private:
+        struct State: public std::enable_shared_from_this<State>
+        {
+            State(T& transport, const CallbackPolicy& policy, CallbackSenders* pSenders)
+                : transport_(transport), policy_(policy), pSenders_(pSenders)
+            {}
+
+            bool Push(std::vector<char>&& frame)
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                if (closed_)
+                    return false;
+
+                while (Full(frame.size()))
+                {
+                    if (Block == policy_.overflow_  &&  !frames_.empty())
+                    {
+                        cv_.wait(lock);
+
+                        if (closed_)
+                            return false;
+                    }
+                    else if (DropOldest == policy_.overflow_  &&  !frames_.empty())
+                    {
+                        bytes_ -= frames_.front().size();
+                        frames_.pop_front();
+
+                        metrics_.dropped_++;
+                    }
+                    else
+                    {
+                        metrics_.dropped_++;
+                        return false;
+                    }
+                }
+
+                bytes_ += frame.size();
+                frames_.push_back(std::move(frame));
+
+                metrics_.queued_++;
+
+                if (!scheduled_)
+                {
+                    scheduled_ = true;
+
+                    Schedule();
+                }
+
+                return true;
+            }
+
+            void Flush()
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                cv_.wait(lock, [this] { return closed_  ||  !scheduled_; });
+            }
+
+            void Close()
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                closed_ = true;
+
+                metrics_.dropped_ += frames_.size();
+                frames_.clear();
+                bytes_ = 0;
+
+                cv_.notify_all();
+
+                // Transport can be destroyed with the queue
+                cv_.wait(lock, [this] { return !sending_; });
+            }
+
+            CallbackMetrics Metrics()
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                auto metrics = metrics_;
+                metrics.pending_ = frames_.size();
+
+                return metrics;
+            }
+
+            T& transport_;
+
+        private:
+            bool Full(size_t size) const
+            {
+                return frames_.size() >= policy_.queueSize_  ||  bytes_ + size > policy_.queueBytes_;
+            }
+
+            void Schedule()
+            {
+                auto pState = this->shared_from_this();
+
+                pSenders_->Run([pState] { pState->Send(); });
+            }
+
+            // Sends one frame, the queue is scheduled again if calls remain
+            void Send()
+            {
+                std::vector<std::vector<char>> frames;
+                {
+                    std::lock_guard<std::mutex> lock(locker_);
+
+                    size_t size = 0;
+                    while (!frames_.empty()  &&  !closed_  &&  frames.size() < policy_.maxBatch_  &&
+                        (frames.empty()  ||  size + frames_.front().size() <= policy_.maxBatchBytes_))
+                    {
+                        size += frames_.front().size();
+                        bytes_ -= frames_.front().size();
+
+                        frames.push_back(std::move(frames_.front()));
+                        frames_.pop_front();
+                    }
+
+                    sending_ = !frames.empty();
+
+                    if (!sending_)
+                    {
+                        scheduled_ = false;
+
+                        cv_.notify_all();
+                        return;
+                    }
+                }
+
+                // Space for blocked callers
+                cv_.notify_all();
+
+                bool sent = true;
+                try
+                {
+                    if (1 == frames.size())
+                    {
+                        Serializer writer(frames.front());
+                        Serializer reader;
+
+                        SendFrame<T, false>::Send(&transport_, writer, reader);
+                    }
+                    else
+                    {
+                        transport_(BatchCall(frames));
+                    }
+                }
+                catch (const std::exception&)
+                {
+                    sent = false;
+                }
+
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (sent)
+                {
+                    metrics_.sent_ += frames.size();
+                    metrics_.batches_++;
+                }
+                else
+                {
+                    metrics_.failed_ += frames.size();
+                }
+
+                sending_ = false;
+
+                if (frames_.empty()  ||  closed_)
+                {
+                    scheduled_ = false;
+                }
+                else
+                {
+                    Schedule();
+                }
+
+                cv_.notify_all();
+            }
+
+            CallbackPolicy policy_;
+            CallbackSenders* pSenders_;
+
+            std::deque<std::vector<char>> frames_;
+            size_t bytes_ = 0;
+            bool scheduled_ = false;
+            bool sending_ = false;
+            bool closed_ = false;
+            CallbackMetrics metrics_;
+
+            std::mutex locker_;
+            std::condition_variable cv_;
+        };
+
+        std::shared_ptr<State> pState_;
+    };
+}
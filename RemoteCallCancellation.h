@@ -0,0 +1,248 @@
+// CancellationToken - cancellation of a call executed by server: its deadline passed, or client cancelled it via '~Cancel'
+// (cancel ids are scoped by client id, a client cancels only its own calls).
+// Handler checks the token of the current call, for instance in a loop of long work:
+//     if (RemoteCall::CurrentCancellation().Cancelled()) ...  or  RemoteCall::CurrentCancellation().ThrowIfCancelled();
+
+#pragma once
+
+#include "RemoteCallException.h"
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <utility>
+
+namespace RemoteCall
+{
+    typedef std::chrono::system_clock::time_point Deadline;
+
+    // Call without deadline
+    inline constexpr Deadline NoDeadline()
+    {
+        return Deadline::max();
+    }
+
+    struct CancellationToken
+    {
+        CancellationToken() {}
+
+        CancellationToken(const std::string& clientId, const std::string& cancelId, Deadline deadline)
+            : clientId_(clientId), cancelId_(cancelId), deadline_(deadline)
+        {}
+
+        CancellationToken(const CancellationToken&) = delete;
+        void operator = (const CancellationToken&) = delete;
+
+        inline ~CancellationToken();
+
+        bool Cancelled() const
+        {
+            return cancelled_  ||  Expired();
+        }
+
+        bool Expired() const
+        {
+            return NoDeadline() != deadline_  &&  std::chrono::system_clock::now() >= deadline_;
+        }
+
+        Deadline GetDeadline() const
+        {
+            return deadline_;
+        }
+
+        void Cancel()
+        {
+            cancelled_ = true;
+        }
+
+        // Throws Cancelled or DeadlineExceeded, it is sent to client as is
+        void ThrowIfCancelled() const
+        {
+            if (cancelled_)
+                throw Exception(Exception::Cancelled, "Call is cancelled.");
+
+            if (Expired())
+                throw Exception(Exception::DeadlineExceeded, "Deadline exceeded.");
+        }
+
+    private:
+        std::string clientId_;
+        std::string cancelId_;
+        Deadline deadline_ = NoDeadline();
+        std::atomic<bool> cancelled_{false};
+    };
+
+
+    // Token of the call executed by this thread (empty if the call has no deadline and cancel id)
+    inline std::shared_ptr<CancellationToken>& CurrentToken()
+    {
+        thread_local std::shared_ptr<CancellationToken> t_pToken; return t_pToken;
+    }
+
+    // Cancellation of the call executed by this thread, it is never cancelled if the call has no deadline and cancel id
+    inline const CancellationToken& CurrentCancellation()
+    {
+        static const CancellationToken s_none;
+
+        auto& pToken = CurrentToken();
+
+        return pToken? *pToken: s_none;
+    }
+
+    // Sets token of the call executed by this thread, the previous one is restored when the scope ends
+    struct CancellationScope
+    {
+        CancellationScope(const std::shared_ptr<CancellationToken>& pToken)
+            : pPrevious_(CurrentToken())
+        {
+            CurrentToken() = pToken;
+        }
+
+        ~CancellationScope()
+        {
+            CurrentToken() = pPrevious_;
+        }
+
+    private:
+        std::shared_ptr<CancellationToken> pPrevious_;
+    };
+
+
+    // Cancellations - tokens of calls by client id and cancel id (several calls can have the same id).
+    // Token is registered while it exists, so '~Cancel' reaches streams and uploads of the call too.
+    struct Cancellations
+    {
+        // Token of a call, it is cancelled already if '~Cancel' was received before the call
+        std::shared_ptr<CancellationToken> Start(const std::string& clientId, const std::string& cancelId, Deadline deadline)
+        {
+            auto pToken = std::make_shared<CancellationToken>(clientId, cancelId, deadline);
+
+            if (cancelId.empty())
+                return pToken;
+
+            Key key(clientId, cancelId);
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            RemoveExpired();
+
+            if (mapCancelledExpires_.count(key))
+            {
+                pToken->Cancel();
+            }
+
+            mapIdToken_.insert(std::make_pair(key, pToken.get()));
+
+            return pToken;
+        }
+
+        // 'deadline' - deadline of '~Cancel', the id is not kept after it
+        void Cancel(const std::string& clientId, const std::string& cancelId, Deadline deadline = NoDeadline())
+        {
+            Key key(clientId, cancelId);
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto range = mapIdToken_.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                it->second->Cancel();
+            }
+
+            // Call can be received after '~Cancel' (for instance it was sent by another connection), the id is kept for a while
+            RemoveExpired();
+
+            auto expires = std::min(std::chrono::system_clock::now() + std::chrono::minutes(1), deadline);
+
+            auto it = mapCancelledExpires_.find(key);
+            if (it != mapCancelledExpires_.end())
+            {
+                if (it->second >= expires)
+                    return;
+
+                cancelled_.erase(std::make_pair(it->second, key));
+                it->second = expires;
+            }
+            else
+            {
+                if (mapCancelledExpires_.size() >= MaxCancelledIds)
+                {
+                    mapCancelledExpires_.erase(cancelled_.begin()->second);
+                    cancelled_.erase(cancelled_.begin());
+                }
+
+                mapCancelledExpires_[key] = expires;
+            }
+
+            cancelled_.insert(std::make_pair(expires, key));
+        }
+
+        void Remove(const std::string& clientId, const std::string& cancelId, CancellationToken* pToken)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto range = mapIdToken_.equal_range(Key(clientId, cancelId));
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                if (it->second == pToken)
+                {
+                    mapIdToken_.erase(it);
+                    break;
+                }
+            }
+        }
+
+        // Cancelled ids which are kept, expired ids are removed when calls start or are cancelled
+        size_t CancelledCount()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            RemoveExpired();
+
+            return mapCancelledExpires_.size();
+        }
+
+    private:
+        typedef std::pair<std::string, std::string> Key;
+
+        enum { MaxCancelledIds = 100000 };
+
+        void RemoveExpired()
+        {
+            auto now = std::chrono::system_clock::now();
+
+            while (!cancelled_.empty()  &&  cancelled_.begin()->first <= now)
+            {
+                mapCancelledExpires_.erase(cancelled_.begin()->second);
+                cancelled_.erase(cancelled_.begin());
+            }
+        }
+
+        std::multimap<Key, CancellationToken*> mapIdToken_;
+
+        // Cancelled ids with time when they are forgotten, and in order of it
+        std::map<Key, Deadline> mapCancelledExpires_;
+        std::set<std::pair<Deadline, Key>> cancelled_;
+
+        std::mutex locker_;
+    };
+
+    inline Cancellations* GetCancellations()
+    {
+        static Cancellations s_cancellations; return &s_cancellations;
+    }
+
+
+    inline CancellationToken::~CancellationToken()
+    {
+        if (!cancelId_.empty())
+        {
+            GetCancellations()->Remove(clientId_, cancelId_, this);
+        }
+    }
+}
@@ -0,0 +1,259 @@
+// Checksum - optional CRC32C of frames and replies. Frame with HasChecksum flag ends with CRC32C of the frame before it,
+// its reply starts with ChecksummedReply marker and CRC32C of the reply after it. CRC32C is computed by SSE4.2 or ARMv8 CRC
+// instructions if processor has them, otherwise by table.
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+#include "RemoteCallFrame.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64)  ||  defined(__x86_64__)  ||  defined(_M_IX86)  ||  defined(__i386__)
+    #define REMOTE_CALL_CRC32C_SSE42
+
+    #include <nmmintrin.h>
+
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define REMOTE_CALL_TARGET_SSE42
+    #else
+        #include <cpuid.h>
+        #define REMOTE_CALL_TARGET_SSE42 __attribute__((target("sse4.2")))
+    #endif
+#elif defined(__ARM_FEATURE_CRC32)
+    #define REMOTE_CALL_CRC32C_ARM
+
+    #include <arm_acle.h>
+#endif
+
+namespace RemoteCall
+{
+    enum
+    {
+        // First byte of reply with checksum (reply starts with empty string, error code or CompressedReply)
+        ChecksummedReply = 0xFE,
+
+        ChecksumSize = 4,
+
+        // Marker and checksum which start the reply
+        SealedPrefixSize = 1 + ChecksumSize
+    };
+
+    // Table of reflected polynomial 0x1EDC6F41
+    inline uint32_t Crc32cTable(const void* p, size_t size, uint32_t crc)
+    {
+        struct Table
+        {
+            Table()
+            {
+                for (uint32_t i = 0; i < 256; i++)
+                {
+                    uint32_t value = i;
+                    for (int bit = 0; bit < 8; bit++)
+                    {
+                        value = (value >> 1) ^ (value & 1? 0x82F63B78: 0);
+                    }
+
+                    values_[i] = value;
+                }
+            }
+
+            uint32_t values_[256];
+        };
+
+        static const Table s_table;
+
+        auto pByte = (const uint8_t*)p;
+        for (size_t i = 0; i < size; i++)
+        {
+            crc = s_table.values_[(crc ^ pByte[i]) & 0xFF] ^ (crc >> 8);
+        }
+
+        return crc;
+    }
+
+#ifdef REMOTE_CALL_CRC32C_SSE42
+    REMOTE_CALL_TARGET_SSE42 inline uint32_t Crc32cHardware(const void* p, size_t size, uint32_t crc)
+    {
+        auto pByte = (const uint8_t*)p;
+
+#if defined(_M_X64)  ||  defined(__x86_64__)
+        uint64_t crc64 = crc;
+        for (; size >= 8; size -= 8, pByte += 8)
+        {
+            uint64_t value;
+            memcpy(&value, pByte, sizeof(value));
+
+            crc64 = _mm_crc32_u64(crc64, value);
+        }
+
+        crc = (uint32_t)crc64;
+#else
+        for (; size >= 4; size -= 4, pByte += 4)
+        {
+            uint32_t value;
+            memcpy(&value, pByte, sizeof(value));
+
+            crc = _mm_crc32_u32(crc, value);
+        }
+#endif
+
+        for (; size; size--, pByte++)
+        {
+            crc = _mm_crc32_u8(crc, *pByte);
+        }
+
+        return crc;
+    }
+
+    inline bool HasCrc32cInstructions()
+    {
+        static const bool s_sse42 = []()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 1);
+
+            return 0 != (info[2] & (1 << 20));
+#else
+            unsigned int eax, ebx, ecx, edx;
+
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx)  &&  0 != (ecx & bit_SSE4_2);
+#endif
+        }();
+
+        return s_sse42;
+    }
+#elif defined(REMOTE_CALL_CRC32C_ARM)
+    inline uint32_t Crc32cHardware(const void* p, size_t size, uint32_t crc)
+    {
+        auto pByte = (const uint8_t*)p;
+
+        for (; size >= 8; size -= 8, pByte += 8)
+        {
+            uint64_t value;
+            memcpy(&value, pByte, sizeof(value));
+
+            crc = __crc32cd(crc, value);
+        }
+
+        for (; size; size--, pByte++)
+        {
+            crc = __crc32cb(crc, *pByte);
+        }
+
+        return crc;
+    }
+
+    inline bool HasCrc32cInstructions()
+    {
+        return true;
+    }
+#else
+    inline uint32_t Crc32cHardware(const void* p, size_t size, uint32_t crc)
+    {
+        return Crc32cTable(p, size, crc);
+    }
+
+    inline bool HasCrc32cInstructions()
+    {
+        return false;
+    }
+#endif
+
+    // CRC32C of 'size' bytes, 'crc' is CRC32C of the preceding bytes
+    inline uint32_t Crc32c(const void* p, size_t size, uint32_t crc = 0)
+    {
+        crc = ~crc;
+        crc = HasCrc32cInstructions()? Crc32cHardware(p, size, crc): Crc32cTable(p, size, crc);
+
+        return ~crc;
+    }
+
+
+    // Appends checksum to the frame written to 'writer' (it is the last change of the frame)
+    inline void SealFrame(Serializer& writer)
+    {
+        if (writer.Size() < FramePrefixSize)
+            return;
+
+        uint16_t flags;
+        memcpy(&flags, writer.Data() + FrameFlagsOffset, sizeof(flags));
+
+        writer.WriteAt(FrameFlagsOffset, (uint16_t)(flags | HasChecksum));
+        writer.WriteAt(FrameLengthOffset, (uint32_t)(writer.TotalSize() + ChecksumSize - FramePrefixSize));
+
+        std::vector<iovec> iov;
+        writer.Gather(iov);
+
+        uint32_t crc = 0;
+        for (auto& el: iov)
+        {
+            crc = Crc32c(el.iov_base, el.iov_len, crc);
+        }
+
+        writer << crc;
+    }
+
+    // Returns false if the frame has no checksum, otherwise 'size' is the size of the frame without checksum, which is verified in place 
+    // (the flag stays, the reply has checksum). Throws InvalidFrame if the checksum does not match.
+    inline bool CheckFrame(const std::vector<char>& vIn, size_t& size)
+    {
+        if (vIn.size() < FramePrefixSize)
+            return false;
+
+        uint16_t flags;
+        memcpy(&flags, vIn.data() + FrameFlagsOffset, sizeof(flags));
+
+        if (!(flags & HasChecksum))
+            return false;
+
+        if (vIn.size() < FramePrefixSize + ChecksumSize)
+            throw Exception(Exception::InvalidFrame, "Frame is truncated.");
+
+        size = vIn.size() - ChecksumSize;
+
+        uint32_t crc;
+        memcpy(&crc, vIn.data() + size, sizeof(crc));
+
+        if (Crc32c(vIn.data(), size) != crc)
+            throw Exception(Exception::InvalidFrame, "Frame checksum does not match.");
+
+        return true;
+    }
+
+    // Checksum prefix is written in place before 'start' of the reply (space reserved by the reply writer), 'start' moves to it
+    inline void SealReply(std::vector<char>& vOut, size_t& start)
+    {
+        uint32_t crc = Crc32c(vOut.data() + start, vOut.size() - start);
+
+        start -= SealedPrefixSize;
+
+        vOut[start] = (char)ChecksummedReply;
+        memcpy(vOut.data() + start + 1, &crc, sizeof(crc));
+    }
+
+    // Returns false if the reply has no checksum, otherwise 'vOut' is the reply without it. Throws InvalidFrame if it does not match.
+    inline bool CheckReply(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        if (vIn.empty()  ||  ChecksummedReply != (uint8_t)vIn[0])
+            return false;
+
+        if (vIn.size() < 1 + ChecksumSize)
+            throw Exception(Exception::InvalidFrame, "Reply is truncated.");
+
+        uint32_t crc;
+        memcpy(&crc, vIn.data() + 1, sizeof(crc));
+
+        if (Crc32c(vIn.data() + 1 + ChecksumSize, vIn.size() - 1 - ChecksumSize) != crc)
+            throw Exception(Exception::InvalidFrame, "Reply checksum does not match.");
+
+        vOut.assign(vIn.begin() + 1 + ChecksumSize, vIn.end());
+
+        return true;
+    }
+}
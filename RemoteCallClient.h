@@ -3,9 +3,29 @@
 #include "RemoteCallUtils.h"
 #include "RemoteCallSerializer.h"
 #include "RemoteCallException.h"
+#include "RemoteCallFrame.h"
+#include "RemoteCallDelta.h"
+#include "RemoteCallCache.h"
+#include "RemoteCallAsync.h"
+#include "RemoteCallSession.h"
+#include "RemoteCallCompression.h"
+#include "RemoteCallChecksum.h"
+#include "RemoteCallNative.h"
+#include "RemoteCallPack.h"
 
 namespace RemoteCall 
 {
+    // Processes frame received by client from server (RemoteCallServer.h)
+    inline void ProcessCallback(const std::vector<char>& vIn, std::vector<char>& vOut);
+
+    // Source of parameter which is sent in several frames (overloaded for InputStream)
+    template <typename T>
+    inline StreamSource* ChunkSource(const T&)
+    {
+        return nullptr;
+    }
+
+
     class Param
     {
     public:
@@ -14,16 +34,34 @@ namespace RemoteCall
             (*write_)(writer, p_);
         }
 
-        void Read(Serializer& reader) const
+        // 'delta' - reply of a call with DeltaReplies flag
+        void Read(Serializer& reader, bool delta) const
         {
             if (read_) 
             {
-                (*read_)(reader, p_);
+                (*read_)(reader, p_, delta);
             }
         }
 
+        StreamSource* Source() const
+        {
+            return pSource_;
+        }
+
+        // In/out parameter, it is changed by reply
+        bool Out() const
+        {
+            return nullptr != read_;
+        }
+
+        // Argument of the call, its type is known to ClientPackWriter
+        const void* Pointer() const
+        {
+            return p_;
+        }
+
     protected:
-	typedef void(*TRead)(Serializer&, void*);
+	typedef void(*TRead)(Serializer&, void*, bool);
 
         template <typename T>
         void Init(T& t, TRead read)
@@ -32,12 +70,14 @@ namespace RemoteCall
 
             write_ = [](Serializer& writer, const void* p) {  writer << *(T*)p; };
             read_ = read;
+            pSource_ = ChunkSource(t);
         }
 
     private:
         void* p_;
         void(*write_)(Serializer&, const void*);
-        void(*read_)(Serializer&, void*);
+        void(*read_)(Serializer&, void*, bool);
+        StreamSource* pSource_;
     };
 
     template <bool out>
@@ -46,7 +86,17 @@ namespace RemoteCall
         template <typename T>
         ParamType(T& t)
         {
-            Init(t, [](Serializer& reader, void* p) { reader >> *(T*)p; });
+            Init(t, [](Serializer& reader, void* p, bool delta) 
+            { 
+                if (delta)
+                {
+                    ParamDelta<T>::Read(reader, *(T*)p);
+                }
+                else
+                {
+                    reader >> *(T*)p; 
+                }
+            });
         }
     };
 
@@ -79,11 +129,19 @@ namespace RemoteCall
     };
 
 		
-    // Check if return type is not 'void' or at least one parameter is non-const reference, then should be used transport 'SendReceive' (otherwise can be used 'Send')
+    // Check if return type is not 'void' or at least one parameter is non-const reference or InputStream, 
+    // then should be used transport 'SendReceive' (otherwise can be used 'Send')
     template <typename Ret, typename ...DeclArgs>
     inline constexpr bool UseSendReceive()
     {
-        return !std::is_same<void, Ret>::value  ||  !AllArgsIn<DeclArgs...>::Check();
+        return !std::is_same<void, Ret>::value  ||  !AllArgsIn<DeclArgs...>::Check()  ||  AnyChunkedParam<DeclArgs...>::value;
+    }
+
+    // Checks declaration of REMOTE_CACHED_FUNCTION_DECL: result depends only on input parameters
+    template <typename Ret, typename ...DeclArgs>
+    inline constexpr bool Cacheable(Ret(*)(DeclArgs...))
+    {
+        return !std::is_void<Ret>::value  &&  !std::is_pointer<Ret>::value  &&  AllArgsIn<DeclArgs...>::Check()  &&  !AnyChunkedParam<DeclArgs...>::value;
     }
 
 
@@ -129,6 +187,100 @@ namespace RemoteCall
     };
 
 
+    // Argument in the fixed prefix of the pack (or in the native block) is converted to the declared type and copied to 'p',
+    // other arguments are written by the serializer (numbers converted to the declared type, server reads its size)
+    template <bool fixed>
+    struct PackArgWriter
+    {
+        template <typename DeclT, typename CallArg>
+        static void Write(Serializer&, char* p, const void* pArg)
+        {
+            const DeclT t = *(const CallArg*)pArg;
+            memcpy(p, &t, sizeof(DeclT));
+        }
+    };
+
+    template <>
+    struct PackArgWriter<false>
+    {
+        template <typename DeclT, typename CallArg>
+        static void Write(Serializer& writer, char*, const void* pArg)
+        {
+            WriteAs<DeclT, CallArg>(writer, pArg, std::is_arithmetic<DeclT>());
+        }
+
+    private:
+        template <typename DeclT, typename CallArg>
+        static void WriteAs(Serializer& writer, const void* pArg, std::true_type)
+        {
+            const DeclT t = *(const CallArg*)pArg;
+            writer << t;
+        }
+
+        template <typename DeclT, typename CallArg>
+        static void WriteAs(Serializer& writer, const void* pArg, std::false_type)
+        {
+            writer << *(const CallArg*)pArg;
+        }
+    };
+
+    template <bool native, typename CallTuple, typename ...DeclArgs>
+    struct NativePackWriter
+    {
+        template <size_t ...I>
+        static void Write(Serializer& writer, const std::vector<Param>& vPar, std::index_sequence<I...>)
+        {
+            using NPack = NativePack<DeclArgs...>;
+
+            auto p = ReserveNativeBlock(writer, NPack::Size(), NPack::Alignment());
+
+            int unused[] = { 0, (PackArgWriter<true>::template Write<typename PackArg<DeclArgs>::Type, typename std::tuple_element<I, CallTuple>::type>(
+                writer, p + NPack::Offset(I), vPar[I].Pointer()), 0)... };
+            (void)unused;
+        }
+    };
+
+    template <typename CallTuple, typename ...DeclArgs>
+    struct NativePackWriter<false, CallTuple, DeclArgs...>
+    {
+        template <size_t ...I>
+        static void Write(Serializer&, const std::vector<Param>&, std::index_sequence<I...>) {}
+    };
+
+    // ClientPackWriter - writes all arguments (of types 'CallTuple') of the declared signature in one function, without calls through
+    // pointers of Param. Arguments in the fixed prefix are copied to one block reserved in the frame.
+    template <typename CallTuple, typename ...DeclArgs>
+    struct ClientPackWriter
+    {
+        // 'native' - session has the same ABI and the parameters are NativePack
+        static void Write(Serializer& writer, const std::vector<Param>& vPar, bool native)
+        {
+            if (native)
+            {
+                NativePackWriter<NativePack<DeclArgs...>::value, CallTuple, DeclArgs...>::Write(writer, vPar, std::index_sequence_for<DeclArgs...>());
+            }
+            else
+            {
+                WriteArgs(writer, vPar, std::index_sequence_for<DeclArgs...>());
+            }
+        }
+
+    private:
+        template <size_t ...I>
+        static void WriteArgs(Serializer& writer, const std::vector<Param>& vPar, std::index_sequence<I...>)
+        {
+            using P = Pack<DeclArgs...>;
+
+            char* p = P::FixedSize()? writer.Reserve(P::FixedSize()): nullptr;
+
+            int unused[] = { 0, (PackArgWriter<(I < P::FixedCount())>::template Write<typename PackArg<DeclArgs>::Type, typename std::tuple_element<I, CallTuple>::type>(
+                writer, p + P::FixedOffset(I), vPar[I].Pointer()), 0)... };
+            (void)unused;
+            (void)p;
+        }
+    };
+
+
     // CallInfo
     template <bool useSendReceive, typename Ret>
     struct CallInfo
@@ -137,27 +289,146 @@ namespace RemoteCall
             : callName_(callName), vPar_(vPar)
         {}
 
-        virtual void Serialize(Serializer& writer) const = 0;
+        // Writes call name (and instance id), they are interned in the session if it is not null
+        virtual void Serialize(Serializer& writer, ClientSession* pSession) const = 0;
+
+        // Called when server replied to the call sent in session 'sessionId', its names are referenced by index in the session since then
+        virtual void Confirm(ClientSession& session, uint64_t sessionId) const = 0;
 
         std::string callName_;
         std::vector<Param> vPar_;
+
+        CallKind kind_ = FunctionCall;
+
+        // Result is cached by client during 'cacheTtl_' (if it is not 0)
+        std::chrono::milliseconds cacheTtl_{0};
+        size_t cacheMaxEntries_ = 0;
+
+        // Options set via CallOptions
+
+        // Server executes the call with the same key once and returns its reply to retries, for instance:
+        //     auto call = Transfer(from, to, amount).Idempotent();
+        //     transport(call); // can be retried after TransportError
+        std::string idempotencyKey_;
+
+        // Call is not sent after deadline, server does not start it after deadline (or transport.WithDeadline)
+        Deadline deadline_ = NoDeadline();
+
+        // Running call is cancelled via CancellationSource
+        std::string cancelId_;
+
+        // Server admits waiting calls of higher priority first
+        uint8_t priority_ = PriorityNormal;
+
+        // Writes the arguments (ClientPackWriter of the declared signature), they are written by Param if it is null
+        void (*writeArgs_)(Serializer&, const std::vector<Param>&, bool native) = nullptr;
+
+        // Arguments can be sent as one block in native session (parameters are trivially copyable inputs)
+        bool native_ = false;
+
+        // One-way call which is done by client and is not sent (Delete of proxy which has other references)
+        bool local_ = false;
+    };
+
+
+    // CancellationSource - cancels calls started with it on server, for instance:
+    //     RemoteCall::CancellationSource source;
+    //     transport(Search(query).Cancellation(source));  // handler checks RemoteCall::CurrentCancellation()
+    //     transport(source.Cancel());                     // from another thread
+    template <bool useSendReceive, typename Ret> struct FunctionInfo;
+
+    struct CancellationSource
+    {
+        FunctionInfo<false, void> Cancel() const;
+
+        std::string id_ = CreateUniqueId();
+    };
+
+
+    // CallOptions - options of FunctionInfo and MethodInfo (I), for instance:
+    //     transport(Transfer(from, to, amount).Idempotent().Timeout(std::chrono::milliseconds(100)))
+    template <typename I>
+    struct CallOptions
+    {
+        I& IdempotencyKey(const std::string& key)
+        {
+            Info().idempotencyKey_ = key;
+
+            return Info();
+        }
+
+        // Sets generated unique idempotency key
+        I& Idempotent()
+        {
+            return IdempotencyKey(CreateUniqueId());
+        }
+
+        I& Deadline(RemoteCall::Deadline deadline)
+        {
+            Info().deadline_ = deadline;
+
+            return Info();
+        }
+
+        I& Timeout(std::chrono::milliseconds timeout)
+        {
+            return Deadline(std::chrono::system_clock::now() + timeout);
+        }
+
+        I& Cancellation(const CancellationSource& source)
+        {
+            Info().cancelId_ = source.id_;
+
+            return Info();
+        }
+
+        I& Priority(CallPriority priority)
+        {
+            Info().priority_ = priority;
+
+            return Info();
+        }
+
+    private:
+        I& Info()
+        {
+            return static_cast<I&>(*this);
+        }
     };
 
 
     // FunctionInfo
     template <bool useSendReceive, typename Ret>
-    struct FunctionInfo: public CallInfo<useSendReceive, Ret>
+    struct FunctionInfo: public CallInfo<useSendReceive, Ret>, public CallOptions<FunctionInfo<useSendReceive, Ret>>
     {
 	FunctionInfo(const std::string callName, const std::vector<Param>& vPar)
 	    : CallInfo<useSendReceive, Ret>(callName, vPar)
 	{}
 
-        void Serialize(Serializer& writer) const override
+        void Serialize(Serializer& writer, ClientSession* pSession) const override
+        {
+            WriteName(writer, pSession, this->callName_);
+        }
+
+        void Confirm(ClientSession& session, uint64_t sessionId) const override
+        {
+            session.Confirm(sessionId, this->callName_);
+        }
+
+        FunctionInfo& Cache(std::chrono::milliseconds ttl, size_t maxEntries)
         {
-            writer << this->callName_;
+            this->cacheTtl_ = ttl;
+            this->cacheMaxEntries_ = maxEntries;
+
+            return *this;
         }
     };
 
+    inline FunctionInfo<false, void> CancellationSource::Cancel() const
+    {
+        return FunctionInfo<false, void>("~Cancel", std::vector<Param>{ ParamType<false>(id_) });
+    }
+
     template <typename ...CallArgs, typename Ret, typename ...DeclArgs>
     inline auto GetFunctionInfo(const std::string& callName, Ret(*)(DeclArgs...), CallArgs&...callArgs)
     {
@@ -166,20 +437,46 @@ namespace RemoteCall
         std::vector<Param> vPar;
         ClientCallProcessor<DeclArgs...>::template CollectParam<CallArgs...>(vPar, callArgs...);
 
-        return FunctionInfo<UseSendReceive<Ret, DeclArgs...>(), Ret>(callName, vPar);
+        FunctionInfo<UseSendReceive<Ret, DeclArgs...>(), Ret> info(callName, vPar);
+        info.writeArgs_ = &ClientPackWriter<std::tuple<typename std::remove_reference<CallArgs>::type...>, DeclArgs...>::Write;
+        info.native_ = NativePack<DeclArgs...>::value;
+
+        return info;
     }
 
     // MethodInfo
     template <bool useSendReceive, typename Ret>
-    struct MethodInfo: public CallInfo<useSendReceive, Ret>
+    struct MethodInfo: public CallInfo<useSendReceive, Ret>, public CallOptions<MethodInfo<useSendReceive, Ret>>
     {
         MethodInfo(const std::string& instanceId, std::string callName, const std::vector<Param>& vPar = std::vector<Param>())
             : CallInfo<useSendReceive, Ret>(callName, vPar), instanceId_(instanceId)
-        {}
+        {
+            this->kind_ = MethodCall;
+        }
 
-        void Serialize(Serializer& writer) const override
+        void Serialize(Serializer& writer, ClientSession* pSession) const override
         {
-            writer << instanceId_ << this->callName_;
+            WriteName(writer, pSession, instanceId_);
+
+            if (DeleteCall != this->kind_)
+            {
+                WriteName(writer, pSession, this->callName_);
+            }
+        }
+
+        void Confirm(ClientSession& session, uint64_t sessionId) const override
+        {
+            session.Confirm(sessionId, instanceId_);
+
+            if (DeleteCall != this->kind_)
+            {
+                session.Confirm(sessionId, this->callName_);
+            }
+        }
+
+        const std::string& InstanceId() const
+        {
+            return instanceId_;
         }
 
     private:
@@ -195,27 +492,31 @@ namespace RemoteCall
         std::vector<Param> vPar;
 	ClientCallProcessor<DeclArgs...>::template CollectParam<CallArgs...>(vPar, callArgs...);
 
-        return MethodInfo<UseSendReceive<Ret, DeclArgs...>(), Ret>(instanceId, callName, vPar);
+        MethodInfo<UseSendReceive<Ret, DeclArgs...>(), Ret> info(instanceId, callName, vPar);
+        info.writeArgs_ = &ClientPackWriter<std::tuple<typename std::remove_reference<CallArgs>::type...>, DeclArgs...>::Write;
+        info.native_ = NativePack<DeclArgs...>::value;
+
+        return info;
     }
 
 
     template <typename Ret>
-    inline Ret Return(Serializer& reader, const std::vector<Param>& vParam)
+    inline Ret Return(Serializer& reader, const std::vector<Param>& vParam, bool delta = false)
     {
         Ret ret;
         reader >> ret;
 
-        Return<void>(reader, vParam);
+        Return<void>(reader, vParam, delta);
 
         return ret;
     }
 
     template <>
-    inline void Return<void>(Serializer& reader, const std::vector<Param>& vParam)
+    inline void Return<void>(Serializer& reader, const std::vector<Param>& vParam, bool delta)
     {
         for (size_t i = vParam.size(); i--;) 
         {
-            vParam[i].Read(reader);
+            vParam[i].Read(reader, delta);
         }
     }
 
@@ -228,10 +529,73 @@ namespace RemoteCall
 
         template<typename> static void Send(...);
         template<typename C> static char Send(TypeValue<bool(C::*)(const std::vector<char>&), &C::Send>*);
+
+        template<typename> static void SendReceiveV(...);
+        template<typename C> static char SendReceiveV(TypeValue<bool(C::*)(const iovec*, size_t, std::vector<char>&), &C::SendReceiveV>*);
+
+        template<typename> static void SendV(...);
+        template<typename C> static char SendV(TypeValue<bool(C::*)(const iovec*, size_t), &C::SendV>*);
     };
 
     template< typename T> inline constexpr bool HasSendReceive() { return std::is_same<decltype(SFINAE::template SendReceive<T>(0)), char>::value; }
     template< typename T> inline constexpr bool HasSend()        { return std::is_same<decltype(SFINAE::template Send<T>(0)), char>::value; }
+    template< typename T> inline constexpr bool HasSendReceiveV() { return std::is_same<decltype(SFINAE::template SendReceiveV<T>(0)), char>::value; }
+    template< typename T> inline constexpr bool HasSendV()        { return std::is_same<decltype(SFINAE::template SendV<T>(0)), char>::value; }
+
+    // Frame is sent as iovecs if transport implements 'SendReceiveV', or 'SendV' for asynchronous call 
+    template <typename T, bool useSendReceive>
+    inline constexpr bool UseGather()
+    {
+        return HasSendReceiveV<T>()  ||  (!useSendReceive  &&  !HasSendReceive<T>()  &&  HasSendV<T>());
+    }
+
+    // Reply to the frame 'pFrame' starts with its correlation id (it is stripped before the reply is cached), and has checksum 
+    // if the frame has it. Cached reply is read without the frame.
+    inline void ReadReply(Serializer& reader, const std::vector<char>& vOut, const void* pFrame = nullptr, size_t frameSize = 0)
+    {
+        bool sealed = 0 != (FrameFlagsOf(pFrame, frameSize) & HasChecksum);
+        auto correlationId = FrameCorrelationId(pFrame, frameSize);
+
+        if (vOut.empty()  &&  !sealed)
+            return;
+
+        // Checksum covers the reply as it was sent, after compression
+        const std::vector<char>* pReply = &vOut;
+
+        std::vector<char> checked, decompressed;
+        if (CheckReply(*pReply, checked))
+        {
+            pReply = &checked;
+        }
+        else if (sealed)
+            throw Exception(Exception::InvalidFrame, "Reply has no checksum.");
+
+        if (DecompressReply(*pReply, decompressed))
+        {
+            pReply = &decompressed;
+        }
+
+        if (auto skip = CheckCorrelation(*pReply, correlationId))
+        {
+            reader = std::vector<char>(pReply->begin() + skip, pReply->end());
+        }
+        else
+        {
+            reader = *pReply;
+        }
+
+        if (reader.GetCurrent())
+        { 
+            Exception e;
+            reader >> e;
+
+            throw e;
+        }
+
+        // Skip "no exception" empty string
+        std::string NoException;
+        reader >> NoException;
+    }
 
     template <typename T, bool yes>
     struct ResolveSendFunctions
@@ -244,22 +608,7 @@ namespace RemoteCall
             if (!pT->SendReceive(vIn, vOut))
                 throw Exception(Exception::TransportError);
 
-            if (vOut.empty())
-                return;
-
-            reader = vOut;
-
-            if (reader.GetCurrent())
-            { 
-                Exception e;
-                reader >> e;
-
-                throw e;
-            }
-
-            // Skip "no exception" empty string
-	    std::string NoException;
-            reader >> NoException;
+            ReadReply(reader, vOut, vIn.data(), vIn.size());
         };
 
         static void SendReceiveAndSend(T* pT, Serializer& reader, const std::vector<char>& vIn)
@@ -289,6 +638,268 @@ namespace RemoteCall
     };
 
 
+    // Same as ResolveSendFunctions for frame sent as iovecs
+    template <typename T, bool useSendReceiveV>
+    struct ResolveSendFunctionsV
+    {
+        static void SendReceiveOrSend(T* pT, Serializer& reader, const std::vector<iovec>& iov)
+        {
+            std::vector<char> vOut;
+            if (!pT->SendReceiveV(iov.data(), iov.size(), vOut))
+                throw Exception(Exception::TransportError);
+
+            ReadReply(reader, vOut, iov.empty()? nullptr: iov[0].iov_base, iov.empty()? 0: iov[0].iov_len);
+        }
+    };
+
+    template <typename T>
+    struct ResolveSendFunctionsV<T, false>
+    {
+        static void SendReceiveOrSend(T* pT, Serializer& reader, const std::vector<iovec>& iov)
+        {
+            if (!pT->SendV(iov.data(), iov.size()))
+                throw Exception(Exception::TransportError);
+        }
+    };
+
+
+    // SendFrame - sends serialized frame as one vector, or as iovecs
+    template <typename T, bool useSendReceive, bool gather = UseGather<T, useSendReceive>()>
+    struct SendFrame
+    {
+        static void Send(T* pT, Serializer& writer, Serializer& reader)
+        {
+            SetFrameLength(writer);
+
+            std::vector<char> vChar = writer;
+
+            ResolveSendFunctions<T, useSendReceive>::SendReceiveOrSend(pT, reader, vChar);
+        }
+    };
+
+    template <typename T, bool useSendReceive>
+    struct SendFrame<T, useSendReceive, true>
+    {
+        static void Send(T* pT, Serializer& writer, Serializer& reader)
+        {
+            SetFrameLength(writer);
+
+            std::vector<iovec> iov;
+            writer.Gather(iov);
+
+            ResolveSendFunctionsV<T, HasSendReceiveV<T>()>::SendReceiveOrSend(pT, reader, iov);
+        }
+    };
+
+
+    // SendCall - sends call frame, and chunks of InputStream parameter if server waits for them
+    template <typename T, bool useSendReceive>
+    struct SendCall
+    {
+        static void Send(T* pT, Serializer& writer, Serializer& reader, const std::vector<Param>& vPar)
+        {
+            try
+            {
+                SendFrame<T, true>::Send(pT, writer, reader);
+            }
+            catch (const Exception& e)
+            {
+                // Server started the call and waits for the rest of InputStream, upload id follows the exception
+                if (Exception::UploadPending != e.Error())
+                    throw;
+
+                std::string uploadId;
+                reader >> uploadId;
+
+                SendChunks(pT, uploadId, vPar, reader);
+            }
+        }
+
+        // Reply to the last chunk is reply to the call
+        static void SendChunks(T* pT, const std::string& uploadId, const std::vector<Param>& vPar, Serializer& reader)
+        {
+            StreamSource* pSource = nullptr;
+            for (auto& el: vPar)
+            {
+                if (el.Source())
+                {
+                    pSource = el.Source();
+                    break;
+                }
+            }
+
+            if (!pSource)
+                throw Exception(Exception::TransportError, "Server expects InputStream which is not sent.");
+
+            while (true)
+            {
+                // Server accepts chunks only from the client of the call
+                Serializer writer;
+                writer << FrameHeader(pT->ClientId()) << "~UploadChunk" << uploadId;
+
+                try
+                {
+                    pSource->WriteChunk(writer, (size_t)-1);
+                }
+                catch (...)
+                {
+                    // Server's InputStream throws in handler
+                    Serializer cancelWriter, cancelReader;
+                    cancelWriter << FrameHeader(pT->ClientId()) << "~UploadCancel" << uploadId;
+
+                    try
+                    {
+                        SendFrame<T, true>::Send(pT, cancelWriter, cancelReader);
+                    }
+                    catch (...)
+                    {
+                    }
+
+                    throw;
+                }
+
+                try
+                {
+                    SendFrame<T, true>::Send(pT, writer, reader);
+                    return;
+                }
+                catch (const Exception& e)
+                {
+                    if (Exception::UploadPending != e.Error())
+                        throw;
+                }
+            }
+        }
+    };
+
+    // Call without reply cannot have InputStream parameter
+    template <typename T>
+    struct SendCall<T, false>
+    {
+        static void Send(T* pT, Serializer& writer, Serializer& reader, const std::vector<Param>&)
+        {
+            SendFrame<T, false>::Send(pT, writer, reader);
+        }
+    };
+
+
+    template <typename T> struct Transport;
+
+    // TransportWithDeadline - sets deadline of calls sent via transport X (the earlier one, if call has its own deadline)
+    template <typename X>
+    struct TransportWithDeadline
+    {
+        TransportWithDeadline(const X& transport, Deadline deadline)
+            : transport_(transport), deadline_(deadline)
+        {}
+
+        template <typename Info>
+        auto operator()(Info callInfo) const -> decltype(std::declval<const X&>()(callInfo))
+        {
+            if (deadline_ < callInfo.deadline_)
+            {
+                callInfo.deadline_ = deadline_;
+            }
+
+            return transport_(callInfo);
+        }
+
+        Deadline GetDeadline() const
+        {
+            return deadline_;
+        }
+
+    private:
+        const X& transport_;
+        Deadline deadline_;
+    };
+
+    // Called for return value with transport used for the call.
+    // Overloaded for return types which call server later (for instance Stream requests next chunks).
+    template <typename Ret, typename T>
+    inline void AttachTransport(Ret&, const Transport<T>*) {}
+
+    template <typename Ret>
+    struct ReturnFromTransport
+    {
+        template <typename T>
+        static Ret Get(const Transport<T>* pTransport, Serializer& reader, const std::vector<Param>& vParam)
+        {
+            auto ret = Return<Ret>(reader, vParam, pTransport->DeltaReplies());
+
+            AttachTransport(ret, pTransport);
+
+            return ret;
+        }
+    };
+
+    template <>
+    struct ReturnFromTransport<void>
+    {
+        template <typename T>
+        static void Get(const Transport<T>* pTransport, Serializer& reader, const std::vector<Param>& vParam)
+        {
+            Return<void>(reader, vParam, pTransport->DeltaReplies());
+        }
+    };
+
+
+    // Sends call in the session of the transport (if its UseSession() returns true)
+    template <typename T, bool useSendReceive>
+    struct SessionCall
+    {
+        template <typename Ret>
+        static Ret Call(const Transport<T>* pT, const CallInfo<useSendReceive, Ret>& callInfo)
+        {
+            if (!pT->UseSession())
+                return WriteAndCall(pT, callInfo);
+
+            pT->OpenSession();
+
+            try
+            {
+                return WriteAndCall(pT, callInfo);
+            }
+            catch (const Exception& e)
+            {
+                if (Exception::InvalidSession != e.Error())
+                    throw;
+            }
+
+            // Server does not know the session, it did not start the call. The call is sent again in a new session.
+            pT->OpenSession();
+
+            return WriteAndCall(pT, callInfo);
+        }
+
+        template <typename Ret>
+        static Ret WriteAndCall(const Transport<T>* pT, const CallInfo<useSendReceive, Ret>& callInfo)
+        {
+            Serializer writer;
+            pT->WriteFrame(callInfo, writer);
+
+            return pT->Call(callInfo, writer);
+        }
+    };
+
+    // Calls without reply are sent without session
+    template <typename T>
+    struct SessionCall<T, false>
+    {
+        template <typename Ret>
+        static Ret Call(const Transport<T>* pT, const CallInfo<false, Ret>& callInfo)
+        {
+            if (callInfo.local_)
+                return Ret();
+
+            Serializer writer;
+            pT->WriteFrame(callInfo, writer);
+
+            return pT->Call(callInfo, writer);
+        }
+    };
+
+
     // Transport
     template <typename T>
     struct Transport
@@ -298,29 +909,281 @@ namespace RemoteCall
         template <bool useSendReceive, typename Ret>
         Ret operator()(const CallInfo<useSendReceive, Ret>& callInfo) const
         {
-            Serializer writer;
+            // Cached result is found before the session is opened
+            if (callInfo.cacheTtl_.count())
+            {
+                Serializer writer;
+                WriteFrame(callInfo, writer, false);
 
-	    writer << (std::is_base_of<RemoteInterface, typename std::remove_pointer<Ret>::type>::value? ClientId() : std::string());
+                Serializer reader;
+                if (FindCached(callInfo, CacheKey(writer), reader))
+                    return ReturnFromTransport<Ret>::Get(this, reader, callInfo.vPar_);
+            }
 
-            callInfo.Serialize(writer);
+            return SessionCall<T, useSendReceive>::Call(this, callInfo);
+        }
 
-            for (auto& el : callInfo.vPar_) 
+        // Sends frame written by 'WriteFrame' and returns result of the call
+        template <bool useSendReceive, typename Ret>
+        Ret Call(const CallInfo<useSendReceive, Ret>& callInfo, Serializer& writer) const
+        {
+            if (NoDeadline() != callInfo.deadline_  &&  std::chrono::system_clock::now() >= callInfo.deadline_)
+                throw Exception(Exception::DeadlineExceeded, "Deadline exceeded.");
+
+            // The reply applies to the session in which the frame was written, it could be replaced since then
+            uint64_t sessionId = useSendReceive? FrameSessionId(writer): 0;
+
+            Serializer reader;
+
+            // Cached result is found before the frame is compressed and sealed
+            std::string key;
+            if (callInfo.cacheTtl_.count())
             {
-                el.Write(writer);
+                key = CacheKey(writer);
+
+                if (FindCached(callInfo, key, reader))
+                    return ReturnFromTransport<Ret>::Get(this, reader, callInfo.vPar_);
             }
 
-            std::vector<char> vChar = writer;
+            auto codec = session_.Codec();
+            if (codec  &&  writer.TotalSize() >= CompressionThreshold())
+            {
+                CompressFrame(writer, codec);
+            }
 
-            Serializer reader;
-            ResolveSendFunctions<T, useSendReceive>::SendReceiveOrSend((T*)this, reader, vChar);
+            if (Checksums())
+            {
+                SealFrame(writer);
+            }
+
+            try
+            {
+                SendCall<T, useSendReceive>::Send((T*)this, writer, reader, callInfo.vPar_);
+
+                if (callInfo.cacheTtl_.count())
+                {
+                    cache_.Add(callInfo.callName_, key, std::vector<char>(reader.Data(), reader.Data() + reader.Size()), 
+                        callInfo.cacheTtl_, callInfo.cacheMaxEntries_);
+                }
+            }
+            catch (const Exception& e)
+            {
+                // Server does not know the session, the transport opens a new one
+                if (Exception::InvalidSession == e.Error())
+                {
+                    session_.Reset(sessionId);
+                }
+
+                throw;
+            }
+
+            if (sessionId)
+            {
+                callInfo.Confirm(session_, sessionId);
+            }
+
+            return ReturnFromTransport<Ret>::Get(this, reader, callInfo.vPar_);
+        }
 
-            return Return<Ret>(reader, callInfo.vPar_);
+        // Calls via returned object have the same deadline: auto t = transport.WithDeadline(std::chrono::milliseconds(100)); t(A()); t(B());
+        TransportWithDeadline<Transport> WithDeadline(std::chrono::milliseconds timeout) const
+        {
+            return TransportWithDeadline<Transport>(*this, std::chrono::system_clock::now() + timeout);
+        }
+
+        // Handler propagates its deadline to calls of other servers: transport.WithDeadline(RemoteCall::CurrentCancellation().GetDeadline())
+        TransportWithDeadline<Transport> WithDeadline(Deadline deadline) const
+        {
+            return TransportWithDeadline<Transport>(*this, deadline);
+        }
+
+        // Removes cached results of all functions, or of 'function'
+        void InvalidateCache(const std::string& function = std::string()) const
+        {
+            cache_.Invalidate(function);
+        }
+
+        // Processes frame received from server via this transport (callback), '~InvalidateCache' removes results cached by this transport
+        void ProcessCallback(const std::vector<char>& vIn, std::vector<char>& vOut) const
+        {
+            ResultCache::Scope scope(&cache_);
+
+            RemoteCall::ProcessCallback(vIn, vOut);
+        }
+
+        // Removes cached result of the call
+        template <bool useSendReceive, typename Ret>
+        void InvalidateCache(const CallInfo<useSendReceive, Ret>& callInfo) const
+        {
+            Serializer writer;
+            WriteFrame(callInfo, writer, false);
+
+            cache_.Invalidate(callInfo.callName_, CacheKey(writer));
         }
 
 	virtual std::string ClientId() const 
 	{ 
 	    return std::string(); 
 	}
+
+        // If true, unchanged in/out parameters are not sent back by server, vectors and maps are sent as changed elements
+        virtual bool DeltaReplies() const
+        {
+            return false;
+        }
+
+        // If true, client id is bound to the session opened by the first call, call names and instance ids are interned in it.
+        // Calls without reply are sent without session (they would be lost silently if server does not know it).
+        virtual bool UseSession() const
+        {
+            return false;
+        }
+
+        // Opens session of the transport if it is not opened, or a new one after the server lost it
+        void OpenSession() const
+        {
+            std::lock_guard<std::mutex> lock(session_.openLocker_);
+
+            if (session_.Id())
+                return;
+
+            auto clientId = ClientId();
+
+            std::vector<uint8_t> codecs;
+            if (Compression())
+            {
+                codecs.push_back(Compression());
+            }
+
+            uint32_t compressionThreshold = (uint32_t)CompressionThreshold();
+
+            // Native layout is used if server has the same ABI
+            uint64_t abi = UseNativeArgs()? NativeAbi(): 0;
+
+            // Server replies with the session id, the codec it accepted and if the layout is native
+            // Server rejects frames of the session without checksum
+            bool checksums = Checksums();
+
+            FunctionInfo<true, std::tuple<uint64_t, uint8_t, bool>> callInfo("~Session", std::vector<Param>{ ParamType<false>(clientId),
+                ParamType<false>(codecs), ParamType<false>(compressionThreshold), ParamType<false>(abi), ParamType<false>(checksums) });
+
+            Serializer writer;
+            WriteFrame(callInfo, writer, false);
+
+            auto session = Call(callInfo, writer);
+
+            session_.Open(std::get<0>(session), std::get<1>(session), std::get<2>(session));
+        }
+
+        // Codec (for instance CodecLz) which compresses frames and replies of the session, if server accepts it
+        virtual uint8_t Compression() const
+        {
+            return NoCodec;
+        }
+
+        // Smaller frames and replies are not compressed
+        virtual size_t CompressionThreshold() const
+        {
+            return 1024;
+        }
+
+        // Arguments of calls with trivially copyable input parameters are sent as one block if server has the same ABI (requires session)
+        virtual bool UseNativeArgs() const
+        {
+            return false;
+        }
+
+        // Frames and replies carry CRC32C, corrupted ones are rejected with InvalidFrame
+        virtual bool Checksums() const
+        {
+            return false;
+        }
+
+        // Minimal size of string or vector which is sent in place, without copying to the frame (if 'SendReceiveV' or 'SendV' is implemented)
+        virtual size_t GatherThreshold() const
+        {
+            return 1024;
+        }
+
+        // Writes call frame. If 'gather' is false, frame does not reference parameters and can be sent after they are destroyed.
+        template <bool useSendReceive, typename Ret>
+        void WriteFrame(const CallInfo<useSendReceive, Ret>& callInfo, Serializer& writer, bool gather = true) const
+        {
+            // Client id is used by server for instances returned to the client, and for admission rate limit
+            FrameHeader header(ClientId(), (DeltaReplies()? RemoteCall::DeltaReplies: 0) | (useSendReceive? 0: OneWay));
+            header.kind_ = callInfo.kind_;
+            header.sessionId_ = useSendReceive? session_.Id(): 0;
+            header.correlationId_ = useSendReceive? NextCorrelationId(): 0;
+            header.idempotencyKey_ = callInfo.idempotencyKey_;
+            header.deadline_ = callInfo.deadline_;
+            header.cancelId_ = callInfo.cancelId_;
+            header.priority_ = callInfo.priority_;
+
+            // Arguments of cached function are the key of its result, padding of native arguments would make equal calls differ
+            bool native = callInfo.native_  &&  header.sessionId_  &&  session_.Native()  &&  !callInfo.cacheTtl_.count();
+            if (native)
+            {
+                header.flags_ |= NativeArgs;
+            }
+
+	    writer << header;
+
+            callInfo.Serialize(writer, header.sessionId_? &session_: nullptr);
+
+            writer.SetGatherThreshold(gather  &&  UseGather<T, useSendReceive>()  &&  !callInfo.cacheTtl_.count()? GatherThreshold(): 0);
+
+            if (callInfo.writeArgs_)
+            {
+                (*callInfo.writeArgs_)(writer, callInfo.vPar_, native);
+            }
+            else
+            {
+                for (auto& el : callInfo.vPar_) 
+                {
+                    el.Write(writer);
+                }
+            }
+
+            SetFrameLength(writer);
+        }
+
+    private:
+        // Result of cached function is keyed by its arguments: the frame (it is not gathered) after the header and the call name
+        static std::string CacheKey(const Serializer& writer)
+        {
+            Serializer reader(std::vector<char>(writer.Data(), writer.Data() + writer.Size()));
+
+            FrameHeader header;
+            reader >> header;
+
+            SkipName(reader);
+
+            return std::string(reader.ReadData(), reader.Remaining());
+        }
+
+        template <bool useSendReceive, typename Ret>
+        bool FindCached(const CallInfo<useSendReceive, Ret>& callInfo, const std::string& key, Serializer& reader) const
+        {
+            std::vector<char> reply;
+            if (!cache_.Find(callInfo.callName_, key, reply))
+                return false;
+
+            ReadReply(reader, reply);
+
+            return true;
+        }
+
+        mutable ResultCache cache_;
+        mutable ClientSession session_;
     };
+
+
+    // Server invalidates cached results of 'function' (of all functions if it is empty) in client, 
+    // it is sent via transport to the client (as callback): transport(RemoteCall::InvalidateClientCache("GetConfig"))
+    template <typename S>
+    inline FunctionInfo<false, void> InvalidateClientCache(const S& function)
+    {
+        return FunctionInfo<false, void>("~InvalidateCache", std::vector<Param>{ ParamType<false>(function) });
+    }
 }
 
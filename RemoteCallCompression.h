@@ -0,0 +1,374 @@
+// Compression - frames and replies bigger than a threshold are compressed by a codec negotiated when the session is opened.
+// Compressed frame has Compressed flag, its part after the fixed header is: codec id, original size, compressed data.
+// Compressed reply starts with CompressedReply marker, then codec id, original size, compressed data.
+// Built-in codec is CodecLz (LZ77 with byte-aligned sequences), others can be added by GetCodecs()->Add on both sides.
+//     struct ClientTransport: public RemoteCall::Transport<ClientTransport>
+//     {
+//         bool UseSession() const override { return true; }
+//         uint8_t Compression() const override { return RemoteCall::CodecLz; }
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+#include "RemoteCallFrame.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+namespace RemoteCall
+{
+    enum CodecId: uint8_t
+    {
+        NoCodec,
+        CodecLz
+    };
+
+    enum
+    {
+        // First byte of compressed reply (reply starts with empty string, or with error code)
+        CompressedReply = 0xFF,
+
+        // Codec id and original size
+        CompressedPrefixSize = 1 + 4,
+
+        MaxDecompressedSize = 256 * 1024 * 1024
+    };
+
+    struct Codec
+    {
+        virtual ~Codec() {}
+
+        // Appends compressed 'p' to 'out'
+        virtual void Compress(const char* p, size_t size, std::vector<char>& out) = 0;
+
+        // Decompresses 'p' to 'out' of 'originalSize' bytes, returns false if the data is corrupted
+        virtual bool Decompress(const char* p, size_t size, char* out, size_t originalSize) = 0;
+    };
+
+
+    // LzCodec - sequences of literals and a match: token (4 bits literal length, 4 bits match length - 4), extra length bytes,
+    // literals, 2 bytes offset of the match, extra length bytes. The last sequence has literals only.
+    struct LzCodec: public Codec
+    {
+        void Compress(const char* p, size_t size, std::vector<char>& out) override
+        {
+            auto in = (const uint8_t*)p;
+
+            thread_local std::vector<uint32_t> t_table;
+            t_table.assign(1 << HashBits, 0);
+
+            size_t anchor = 0, pos = 0;
+            while (pos + MinMatch <= size)
+            {
+                uint32_t sequence;
+                memcpy(&sequence, in + pos, sizeof(sequence));
+
+                auto& entry = t_table[(sequence * 2654435761u) >> (32 - HashBits)];
+                size_t candidate = entry;
+                entry = (uint32_t)pos + 1;
+
+                // Positions are stored + 1, 0 is empty entry
+                if (!candidate  ||  pos + 1 - candidate > MaxOffset  ||  memcmp(in + candidate - 1, in + pos, MinMatch))
+                {
+                    pos++;
+                    continue;
+                }
+
+                size_t match = candidate - 1;
+                size_t length = MinMatch;
+                while (pos + length < size  &&  in[match + length] == in[pos + length])
+                {
+                    length++;
+                }
+
+                WriteSequence(out, in + anchor, pos - anchor, pos - match, length);
+
+                pos += length;
+                anchor = pos;
+            }
+
+            if (anchor < size)
+            {
+                WriteSequence(out, in + anchor, size - anchor, 0, 0);
+            }
+        }
+
+        bool Decompress(const char* p, size_t size, char* out, size_t originalSize) override
+        {
+            auto in = (const uint8_t*)p;
+            auto end = in + size;
+            size_t pos = 0;
+
+            while (pos < originalSize)
+            {
+                if (in == end)
+                    return false;
+
+                uint8_t token = *in++;
+
+                size_t literals = token >> 4;
+                if (!ReadLength(in, end, literals)  ||  (size_t)(end - in) < literals  ||  originalSize - pos < literals)
+                    return false;
+
+                memcpy(out + pos, in, literals);
+                in += literals;
+                pos += literals;
+
+                if (pos == originalSize)
+                    break;
+
+                if (end - in < 2)
+                    return false;
+
+                size_t offset = in[0] | (in[1] << 8);
+                in += 2;
+
+                size_t length = token & 0x0F;
+                if (!ReadLength(in, end, length))
+                    return false;
+
+                length += MinMatch;
+
+                if (!offset  ||  offset > pos  ||  originalSize - pos < length)
+                    return false;
+
+                // Match can overlap the bytes it produces
+                for (size_t i = 0; i < length; i++, pos++)
+                {
+                    out[pos] = out[pos - offset];
+                }
+            }
+
+            return in == end;
+        }
+
+    private:
+        enum { HashBits = 12, MinMatch = 4, MaxOffset = 65535 };
+
+        static void WriteLength(std::vector<char>& out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+            {
+                out.push_back((char)255);
+            }
+
+            out.push_back((char)length);
+        }
+
+        static bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+        {
+            if (length < 15)
+                return true;
+
+            uint8_t byte;
+            do
+            {
+                if (in == end)
+                    return false;
+
+                byte = *in++;
+                length += byte;
+            } while (255 == byte);
+
+            return true;
+        }
+
+        // Sequence without match if 'length' is 0
+        static void WriteSequence(std::vector<char>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t length)
+        {
+            size_t matchLength = length? length - MinMatch: 0;
+
+            out.push_back((char)((std::min<size_t>(literalCount, 15) << 4) | std::min<size_t>(matchLength, 15)));
+
+            if (literalCount >= 15)
+            {
+                WriteLength(out, literalCount - 15);
+            }
+
+            out.insert(out.end(), (const char*)literals, (const char*)literals + literalCount);
+
+            if (!length)
+                return;
+
+            out.push_back((char)(offset & 0xFF));
+            out.push_back((char)(offset >> 8));
+
+            if (matchLength >= 15)
+            {
+                WriteLength(out, matchLength - 15);
+            }
+        }
+    };
+
+
+    // Codecs - codecs by id
+    struct Codecs
+    {
+        Codecs()
+        {
+            codecs_[CodecLz] = &lz_;
+        }
+
+        void Add(uint8_t id, Codec* pCodec)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            codecs_[id] = pCodec;
+        }
+
+        Codec* Get(uint8_t id)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = codecs_.find(id);
+            if (codecs_.end() == it)
+                return nullptr;
+
+            return it->second;
+        }
+
+    private:
+        LzCodec lz_;
+        std::map<uint8_t, Codec*> codecs_;
+        std::mutex locker_;
+    };
+
+    inline Codecs* GetCodecs()
+    {
+        static Codecs s_codecs; return &s_codecs;
+    }
+
+
+    // Appends codec id, original size and compressed data, returns false if it is not smaller
+    inline bool Compress(uint8_t codecId, const char* p, size_t size, std::vector<char>& out)
+    {
+        auto pCodec = GetCodecs()->Get(codecId);
+        if (!pCodec)
+            return false;
+
+        auto prefix = out.size();
+
+        uint32_t originalSize = (uint32_t)size;
+        out.push_back((char)codecId);
+        out.insert(out.end(), (const char*)&originalSize, (const char*)&originalSize + sizeof(originalSize));
+
+        pCodec->Compress(p, size, out);
+
+        return out.size() - prefix < size;
+    }
+
+    // Decompresses data written by Compress and appends it to 'out'
+    inline void Decompress(const char* p, size_t size, std::vector<char>& out)
+    {
+        if (size < CompressedPrefixSize)
+            throw Exception(Exception::InvalidFrame, "Compressed data is truncated.");
+
+        uint32_t originalSize;
+        memcpy(&originalSize, p + 1, sizeof(originalSize));
+
+        auto pCodec = GetCodecs()->Get((uint8_t)p[0]);
+        if (!pCodec)
+            throw Exception(Exception::InvalidFrame, ToString() << "Unknown codec " << (int)(uint8_t)p[0] << '.');
+
+        if (originalSize > MaxDecompressedSize)
+            throw Exception(Exception::InvalidFrame, "Compressed data is too big.");
+
+        auto pos = out.size();
+        out.resize(pos + originalSize);
+
+        if (!pCodec->Decompress(p + CompressedPrefixSize, size - CompressedPrefixSize, out.data() + pos, originalSize))
+            throw Exception(Exception::InvalidFrame, "Compressed data is corrupted.");
+    }
+
+
+    // Compresses frame written to 'writer' after its fixed header, it is sent as is if it does not compress
+    inline void CompressFrame(Serializer& writer, uint8_t codecId)
+    {
+        std::vector<char> frame = writer;
+        if (frame.size() < FramePrefixSize)
+            return;
+
+        std::vector<char> out(frame.begin(), frame.begin() + FramePrefixSize);
+        if (!Compress(codecId, frame.data() + FramePrefixSize, frame.size() - FramePrefixSize, out))
+            return;
+
+        uint16_t flags;
+        memcpy(&flags, out.data() + FrameFlagsOffset, sizeof(flags));
+
+        flags |= Compressed;
+        memcpy(out.data() + FrameFlagsOffset, &flags, sizeof(flags));
+
+        writer = out;
+
+        SetFrameLength(writer);
+    }
+
+    // Returns false if the frame is not compressed, otherwise 'vOut' is the frame without compression.
+    // Throws InvalidFrame if the compressed frame is truncated or corrupted.
+    inline bool DecompressFrame(const char* p, size_t size, std::vector<char>& vOut)
+    {
+        if (size < FramePrefixSize)
+            return false;
+
+        uint16_t flags;
+        memcpy(&flags, p + FrameFlagsOffset, sizeof(flags));
+
+        if (!(flags & Compressed))
+            return false;
+
+        uint32_t length;
+        memcpy(&length, p + FrameLengthOffset, sizeof(length));
+
+        if (size - FramePrefixSize != length)
+            throw Exception(Exception::InvalidFrame, "Invalid frame length.");
+
+        vOut.assign(p, p + FramePrefixSize);
+        Decompress(p + FramePrefixSize, size - FramePrefixSize, vOut);
+
+        flags &= ~Compressed;
+        memcpy(vOut.data() + FrameFlagsOffset, &flags, sizeof(flags));
+
+        length = (uint32_t)(vOut.size() - FramePrefixSize);
+        memcpy(vOut.data() + FrameLengthOffset, &length, sizeof(length));
+
+        return true;
+    }
+
+    inline bool DecompressFrame(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        return DecompressFrame(vIn.data(), vIn.size(), vOut);
+    }
+
+    // Compresses the reply from 'start', the compressed reply keeps 'reserved' bytes before it for its prefixes ('start' moves to it)
+    inline void CompressReply(std::vector<char>& vOut, size_t& start, uint8_t codecId, size_t threshold, size_t reserved)
+    {
+        if (vOut.size() - start < threshold)
+            return;
+
+        std::vector<char> out(reserved + 1);
+        out[reserved] = (char)CompressedReply;
+
+        if (Compress(codecId, vOut.data() + start, vOut.size() - start, out))
+        {
+            vOut.swap(out);
+            start = reserved;
+        }
+    }
+
+    // Returns false if the reply is not compressed, throws InvalidFrame if it is truncated or corrupted
+    inline bool DecompressReply(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        if (vIn.empty()  ||  CompressedReply != (uint8_t)vIn[0])
+            return false;
+
+        vOut.clear();
+        Decompress(vIn.data() + 1, vIn.size() - 1, vOut);
+
+        return true;
+    }
+}
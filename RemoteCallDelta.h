@@ -0,0 +1,253 @@
+// ReplyDelta - in/out parameter in reply of a call with DeltaReplies flag: 
+// unchanged parameter is sent as one byte, changed vector or map as changed elements (if it is smaller than the whole value).
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+
+#include <vector>
+#include <map>
+#include <cstring>
+
+namespace RemoteCall
+{
+    enum ReplyKind: char { ReplyUnchanged, ReplyValue, ReplyDelta };
+
+    // Writes 't' as value, returns true if it is the same as received 'begin'-'end' bytes of 'reader' (then only ReplyUnchanged is written)
+    template <typename T>
+    inline bool WriteIfChanged(Serializer& writer, const T& t, const Serializer& reader, size_t begin, size_t end)
+    {
+        size_t pos = writer.Size();
+
+        writer << (char)ReplyValue << t;
+
+        size_t size = writer.Size() - pos - 1;
+        if (size != end - begin  ||  memcmp(writer.Data() + pos + 1, reader.Data() + begin, size))
+            return false;
+
+        writer.Truncate(pos);
+        writer << (char)ReplyUnchanged;
+
+        return true;
+    }
+
+    // Replaces value written by WriteIfChanged with 'delta', if it is smaller
+    inline void ReplaceWithDelta(Serializer& writer, const Serializer& delta, size_t valueSize)
+    {
+        if (delta.Size() >= valueSize)
+            return;
+
+        writer.Truncate(writer.Size() - valueSize - 1);
+
+        writer << (char)ReplyDelta;
+        writer.WriteBytes(delta.Data(), delta.Size());
+    }
+
+
+    template <typename T>
+    struct ParamDelta
+    {
+        static void Write(Serializer& writer, const T& t, Serializer& reader, size_t begin, size_t end)
+        {
+            WriteIfChanged(writer, t, reader, begin, end);
+        }
+
+        static void Read(Serializer& reader, T& t)
+        {
+            char kind;
+            reader >> kind;
+
+            if (ReplyValue == kind)
+            {
+                reader >> t;
+            }
+        }
+    };
+
+
+    // vector: new size and changed or added elements with their indexes
+    template <typename T>
+    struct ParamDelta<std::vector<T>>
+    {
+        static void Write(Serializer& writer, const std::vector<T>& v, Serializer& reader, size_t begin, size_t end)
+        {
+            size_t pos = writer.Size();
+
+            if (WriteIfChanged(writer, v, reader, begin, end))
+                return;
+
+            // Offsets of received elements
+            size_t readPos = reader.ReadPosition();
+            reader.Seek(begin);
+
+            size_t size;
+            reader >> size;
+
+            std::vector<size_t> offsets;
+            offsets.reserve(size + 1);
+            for (size_t i = 0; i < size; i++)
+            {
+                offsets.push_back(reader.ReadPosition());
+
+                T t;
+                reader >> t;
+            }
+            offsets.push_back(reader.ReadPosition());
+
+            reader.Seek(readPos);
+
+            Serializer changes, element;
+            size_t count = 0;
+
+            for (size_t i = 0; i < v.size(); i++)
+            {
+                element.clear();
+                element << v[i];
+
+                if (i < size  &&  element.Size() == offsets[i + 1] - offsets[i]  &&  !memcmp(element.Data(), reader.Data() + offsets[i], element.Size()))
+                    continue;
+
+                changes << i;
+                changes.WriteBytes(element.Data(), element.Size());
+                count++;
+            }
+
+            Serializer delta;
+            delta << v.size() << count;
+            delta.WriteBytes(changes.Data(), changes.Size());
+
+            ReplaceWithDelta(writer, delta, writer.Size() - pos - 1);
+        }
+
+        static void Read(Serializer& reader, std::vector<T>& v)
+        {
+            char kind;
+            reader >> kind;
+
+            if (ReplyValue == kind)
+            {
+                reader >> v;
+            }
+            else if (ReplyDelta == kind)
+            {
+                size_t size, count;
+                reader >> size >> count;
+
+                // Each change has its index, elements added to the sent vector are changes
+                if (count > reader.Remaining() / sizeof(size_t)  ||  size > v.size() + count)
+                    throw Exception(Exception::InvalidFrame, "Vector delta is truncated.");
+
+                v.resize(size);
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    size_t index;
+                    T t;
+                    reader >> index >> t;
+
+                    if (index >= size)
+                        throw Exception(Exception::InvalidFrame, "Vector delta index is out of range.");
+
+                    v[index] = std::move(t);
+                }
+            }
+        }
+    };
+
+
+    // map: changed or added entries, and removed keys
+    template <typename TKey, typename TValue>
+    struct ParamDelta<std::map<TKey, TValue>>
+    {
+        static void Write(Serializer& writer, const std::map<TKey, TValue>& m, Serializer& reader, size_t begin, size_t end)
+        {
+            size_t pos = writer.Size();
+
+            if (WriteIfChanged(writer, m, reader, begin, end))
+                return;
+
+            size_t readPos = reader.ReadPosition();
+            reader.Seek(begin);
+
+            std::map<TKey, TValue> received;
+            reader >> received;
+
+            reader.Seek(readPos);
+
+            Serializer changes, removed, value, receivedValue;
+            size_t changeCount = 0, removeCount = 0;
+
+            for (auto& el: m)
+            {
+                auto it = received.find(el.first);
+                if (it != received.end())
+                {
+                    value.clear();
+                    value << el.second;
+
+                    receivedValue.clear();
+                    receivedValue << it->second;
+
+                    if (value.Size() == receivedValue.Size()  &&  !memcmp(value.Data(), receivedValue.Data(), value.Size()))
+                        continue;
+                }
+
+                changes << el.first << el.second;
+                changeCount++;
+            }
+
+            for (auto& el: received)
+            {
+                if (m.find(el.first) == m.end())
+                {
+                    removed << el.first;
+                    removeCount++;
+                }
+            }
+
+            Serializer delta;
+            delta << changeCount;
+            delta.WriteBytes(changes.Data(), changes.Size());
+            delta << removeCount;
+            delta.WriteBytes(removed.Data(), removed.Size());
+
+            ReplaceWithDelta(writer, delta, writer.Size() - pos - 1);
+        }
+
+        static void Read(Serializer& reader, std::map<TKey, TValue>& m)
+        {
+            char kind;
+            reader >> kind;
+
+            if (ReplyValue == kind)
+            {
+                reader >> m;
+            }
+            else if (ReplyDelta == kind)
+            {
+                size_t count;
+                reader >> count;
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    TKey key;
+                    TValue value;
+                    reader >> key >> value;
+
+                    m[key] = std::move(value);
+                }
+
+                reader >> count;
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    TKey key;
+                    reader >> key;
+
+                    m.erase(key);
+                }
+            }
+        }
+    };
+}
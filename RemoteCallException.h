@@ -9,16 +9,16 @@ namespace RemoteCall
     class Exception : public std::exception
     {
     public:
-        enum ErrorType {NoError, TransportError, ServerError, InvalidFunction, InvalidClassInstance, InvalidMethod};
+        enum ErrorType {NoError, TransportError, ServerError, InvalidFunction, InvalidClassInstance, InvalidMethod, UploadPending, DeadlineExceeded, Cancelled, Overloaded, InvalidSession, InvalidFrame};
 
         Exception() {}
 
         Exception(ErrorType error, const std::string& description = "")
-            : std::exception(format(error, description).c_str()), error_(error)
+            : what_(format(error, description)), error_(error)
          {}
 
         Exception(int err, const std::string& what)
-            : std::exception(what.c_str()), error_((Exception::ErrorType)err)
+            : what_(what), error_((Exception::ErrorType)err)
         {}
 
         ErrorType Error() const
@@ -26,6 +26,11 @@ namespace RemoteCall
             return error_; 
         }
 
+        const char* what() const noexcept override
+        {
+            return what_.c_str();
+        }
+
     private:
         std::string format(ErrorType error, const std::string& description)
         {
@@ -33,23 +38,7 @@ namespace RemoteCall
         }
 
     private:
+        std::string what_;
         ErrorType error_ = NoError;
     };
-
-
-    inline Serializer& operator << (Serializer& writer, const Exception& e)
-    {
-        return writer << (int)e.Error() << e.what();
-    }
-
-    inline Serializer& operator >> (Serializer& reader, Exception& e)
-    {
-        std::string what;
-        int err;
-        reader >> err >> what;
-
-        e = Exception(err, what);
-
-        return reader;
-    }
 }
@@ -0,0 +1,426 @@
+// Frame header - the first part of a call frame. Fixed part: magic, version, kind of the call, flags, length of the rest of the frame
+// and correlation id, so server routes and validates the frame without parsing strings. It is followed by optional fields indicated by flags.
+// Reply of the call with correlation id starts with CorrelatedReply marker and the id, client does not take the reply of another call.
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+#include "RemoteCallCancellation.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+namespace RemoteCall
+{
+    enum FrameFlags: uint16_t
+    {
+        // Unchanged in/out parameters are not sent back, vectors and maps are sent as changed elements
+        DeltaReplies = 0x01,
+
+        // Header contains idempotency key (set automatically if it is not empty)
+        HasIdempotencyKey = 0x02,
+
+        // Header contains deadline: microseconds since system clock epoch (set automatically if call has deadline)
+        HasDeadline = 0x04,
+
+        // Header contains cancel id which is used by '~Cancel' (set automatically if it is not empty)
+        HasCancelId = 0x08,
+
+        // Header contains priority (set automatically if it is not PriorityNormal)
+        HasPriority = 0x10,
+
+        // Header contains session id instead of client id (set automatically if it is not 0)
+        HasSession = 0x20,
+
+        // Header contains client id (set automatically if it is not empty and there is no session)
+        HasClientId = 0x40,
+
+        // Call does not wait for reply
+        OneWay = 0x80,
+
+        // The rest of the frame after the fixed part is compressed (RemoteCallCompression.h)
+        Compressed = 0x100,
+
+        // Frame ends with CRC32C of the frame, the reply starts with CRC32C of the reply (RemoteCallChecksum.h)
+        HasChecksum = 0x200,
+
+        // Arguments are one block of native layout, negotiated by the session (RemoteCallNative.h)
+        NativeArgs = 0x400,
+    };
+
+    // Kind of the call, it is followed by function name, or by instance id and method name (instance id only for delete)
+    enum CallKind: uint8_t
+    {
+        FunctionCall,
+        MethodCall,
+        DeleteCall,
+
+        CallKindCount
+    };
+
+    enum
+    {
+        FrameMagic = 0xC5,
+        FrameVersion = 2,
+
+        // Magic, version, kind, flags, length, correlation id
+        FramePrefixSize = 1 + 1 + 1 + 2 + 4 + 4,
+        FrameFlagsOffset = 1 + 1 + 1,
+        FrameLengthOffset = 1 + 1 + 1 + 2,
+        FrameCorrelationOffset = 1 + 1 + 1 + 2 + 4,
+
+        // First byte of reply with correlation id (reply starts with empty string or with error code), it is followed by the id
+        CorrelatedReply = 0xFD,
+        CorrelatedPrefixSize = 1 + 4
+    };
+
+    // Priority of a call in server admission queues
+    enum CallPriority: uint8_t
+    {
+        PriorityLow,
+        PriorityNormal,
+        PriorityHigh,
+        PriorityCritical,
+
+        PriorityCount
+    };
+
+    struct FrameHeader
+    {
+        FrameHeader() {}
+
+        FrameHeader(const std::string& clientId, uint16_t flags = 0)
+            : clientId_(clientId), flags_(flags)
+        {}
+
+        CallKind kind_ = FunctionCall;
+
+        std::string clientId_;
+        uint16_t flags_ = 0;
+
+        // Call with the same key is executed by server once, its reply is returned to retries
+        std::string idempotencyKey_;
+
+        // Server does not start the call after deadline, handler can check it via CurrentCancellation()
+        Deadline deadline_ = NoDeadline();
+
+        std::string cancelId_;
+
+        uint8_t priority_ = PriorityNormal;
+
+        // Session opened by '~Session', server sets client id of the session
+        uint64_t sessionId_ = 0;
+
+        // Size of the frame after the fixed part, it is set by SetFrameLength when the frame is written
+        uint32_t length_ = 0;
+
+        // Reply of the call starts with it (0 - client does not wait for the reply)
+        uint32_t correlationId_ = 0;
+    };
+
+    // Correlation id of the next call which waits for the reply, it is not 0
+    inline uint32_t NextCorrelationId()
+    {
+        static std::atomic<uint32_t> s_id{0};
+
+        uint32_t id;
+        do
+        {
+            id = ++s_id;
+        } while (!id);
+
+        return id;
+    }
+
+    // Client id of the call executed by this thread (client id of its session, empty if client did not send it)
+    inline std::string& CurrentClientId()
+    {
+        thread_local std::string t_clientId; return t_clientId;
+    }
+
+    // Sets client id of the call executed by this thread, the previous one is restored when the scope ends
+    struct ClientIdScope
+    {
+        ClientIdScope(const std::string& clientId)
+            : previous_(CurrentClientId())
+        {
+            CurrentClientId() = clientId;
+        }
+
+        ~ClientIdScope()
+        {
+            CurrentClientId() = previous_;
+        }
+
+    private:
+        std::string previous_;
+    };
+
+    // Process id of the client whose frame is processed by this thread, it is set by transport which knows it 
+    // (SocketServer for Unix domain sockets, from SO_PEERCRED). 0 if it is not known, then SharedBlob is not mapped.
+    inline int& CurrentPeerPid()
+    {
+        thread_local int t_pid = 0; return t_pid;
+    }
+
+    struct PeerScope
+    {
+        PeerScope(int pid)
+            : previous_(CurrentPeerPid())
+        {
+            CurrentPeerPid() = pid;
+        }
+
+        ~PeerScope()
+        {
+            CurrentPeerPid() = previous_;
+        }
+
+    private:
+        int previous_;
+    };
+
+    // Sets length of the frame which is written to 'writer' (including blocks referenced in gather mode)
+    inline void SetFrameLength(Serializer& writer)
+    {
+        if (writer.Size() >= FramePrefixSize)
+        {
+            writer.WriteAt(FrameLengthOffset, (uint32_t)(writer.TotalSize() - FramePrefixSize));
+        }
+    }
+
+    inline Serializer& operator << (Serializer& writer, const FrameHeader& header)
+    {
+        uint16_t flags = header.flags_;
+        if (!header.idempotencyKey_.empty())
+        {
+            flags |= HasIdempotencyKey;
+        }
+
+        if (NoDeadline() != header.deadline_)
+        {
+            flags |= HasDeadline;
+        }
+
+        if (!header.cancelId_.empty())
+        {
+            flags |= HasCancelId;
+        }
+
+        if (PriorityNormal != header.priority_)
+        {
+            flags |= HasPriority;
+        }
+
+        if (header.sessionId_)
+        {
+            flags |= HasSession;
+        }
+        else if (!header.clientId_.empty())
+        {
+            flags |= HasClientId;
+        }
+
+        writer << (uint8_t)FrameMagic << (uint8_t)FrameVersion << (uint8_t)header.kind_ << flags << header.length_ << header.correlationId_;
+
+        if (flags & HasClientId)
+        {
+            writer << header.clientId_;
+        }
+
+        if (flags & HasIdempotencyKey)
+        {
+            writer << header.idempotencyKey_;
+        }
+
+        if (flags & HasDeadline)
+        {
+            writer << (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(header.deadline_.time_since_epoch()).count();
+        }
+
+        if (flags & HasCancelId)
+        {
+            writer << header.cancelId_;
+        }
+
+        if (flags & HasPriority)
+        {
+            writer << header.priority_;
+        }
+
+        if (flags & HasSession)
+        {
+            writer << header.sessionId_;
+        }
+
+        return writer;
+    }
+
+    // Throws InvalidFrame if the frame is not a call frame of this version, or if it is truncated
+    inline Serializer& operator >> (Serializer& reader, FrameHeader& header)
+    {
+        if (reader.Size() - reader.ReadPosition() < FramePrefixSize)
+            throw Exception(Exception::InvalidFrame, "Frame is truncated.");
+
+        uint8_t magic, version, kind;
+        uint32_t correlationId;
+        reader >> magic >> version >> kind >> header.flags_ >> header.length_ >> correlationId;
+
+        if (FrameMagic != magic  ||  FrameVersion != version  ||  kind >= CallKindCount)
+            throw Exception(Exception::InvalidFrame, ToString() << "Invalid frame (version " << (int)version << ").");
+
+        // Error reply to the invalid frame does not have it
+        header.correlationId_ = correlationId;
+
+        if (reader.Size() - reader.ReadPosition() != header.length_)
+            throw Exception(Exception::InvalidFrame, "Invalid frame length.");
+
+        header.kind_ = (CallKind)kind;
+
+        if (header.flags_ & HasClientId)
+        {
+            reader >> header.clientId_;
+        }
+
+        if (header.flags_ & HasIdempotencyKey)
+        {
+            reader >> header.idempotencyKey_;
+        }
+
+        if (header.flags_ & HasDeadline)
+        {
+            int64_t deadline;
+            reader >> deadline;
+
+            header.deadline_ = Deadline(std::chrono::duration_cast<Deadline::duration>(std::chrono::microseconds(deadline)));
+        }
+
+        if (header.flags_ & HasCancelId)
+        {
+            reader >> header.cancelId_;
+        }
+
+        if (header.flags_ & HasPriority)
+        {
+            reader >> header.priority_;
+        }
+
+        if (header.flags_ & HasSession)
+        {
+            reader >> header.sessionId_;
+        }
+
+        return reader;
+    }
+
+    // Session id of the frame written to 'writer' (0 if it has no session), the other fields of the header are skipped
+    inline uint64_t FrameSessionId(const Serializer& writer)
+    {
+        if (writer.Size() < FramePrefixSize)
+            return 0;
+
+        uint16_t flags;
+        memcpy(&flags, writer.Data() + FrameFlagsOffset, sizeof(flags));
+
+        if (!(flags & HasSession))
+            return 0;
+
+        auto p = writer.Data() + FramePrefixSize;
+
+        if (flags & HasClientId)
+        {
+            p += strlen(p) + 1;
+        }
+
+        if (flags & HasIdempotencyKey)
+        {
+            p += strlen(p) + 1;
+        }
+
+        if (flags & HasDeadline)
+        {
+            p += sizeof(int64_t);
+        }
+
+        if (flags & HasCancelId)
+        {
+            p += strlen(p) + 1;
+        }
+
+        if (flags & HasPriority)
+        {
+            p += sizeof(uint8_t);
+        }
+
+        uint64_t sessionId;
+        memcpy(&sessionId, p, sizeof(sessionId));
+
+        return sessionId;
+    }
+
+    // Flags of the frame which starts with 'p' (0 if it is not a call frame)
+    inline uint16_t FrameFlagsOf(const void* p, size_t size)
+    {
+        uint16_t flags = 0;
+        if (size >= FramePrefixSize  &&  FrameMagic == *(const uint8_t*)p)
+        {
+            memcpy(&flags, (const char*)p + FrameFlagsOffset, sizeof(flags));
+        }
+
+        return flags;
+    }
+
+    // Correlation id of the frame which starts with 'p' (0 if it is not a call frame or client does not wait for the reply)
+    inline uint32_t FrameCorrelationId(const void* p, size_t size)
+    {
+        uint32_t correlationId = 0;
+        if (size >= FramePrefixSize  &&  FrameMagic == *(const uint8_t*)p)
+        {
+            memcpy(&correlationId, (const char*)p + FrameCorrelationOffset, sizeof(correlationId));
+        }
+
+        return correlationId;
+    }
+
+    // Reply of the call with correlation id starts with it, it is written in place before 'start' of the reply (space reserved 
+    // by the reply writer), 'start' moves to it
+    inline void CorrelateReply(std::vector<char>& vOut, size_t& start, uint32_t correlationId)
+    {
+        if (!correlationId)
+            return;
+
+        start -= CorrelatedPrefixSize;
+
+        vOut[start] = (char)CorrelatedReply;
+        memcpy(vOut.data() + start + 1, &correlationId, sizeof(correlationId));
+    }
+
+    // Returns size of the correlation id which starts the reply to the call with 'correlationId'. Throws TransportError if it is
+    // the reply of another call. Reply without it is accepted only if it is an error (server could not read the frame header).
+    inline size_t CheckCorrelation(const std::vector<char>& vOut, uint32_t correlationId)
+    {
+        if (!correlationId  ||  vOut.empty())
+            return 0;
+
+        if (CorrelatedReply != (uint8_t)vOut[0])
+        {
+            if (!vOut[0])
+                throw Exception(Exception::TransportError, "Reply without correlation id.");
+
+            return 0;
+        }
+
+        uint32_t id = 0;
+        if (vOut.size() >= CorrelatedPrefixSize)
+        {
+            memcpy(&id, vOut.data() + 1, sizeof(id));
+        }
+
+        if (correlationId != id)
+            throw Exception(Exception::TransportError, ToString() << "Reply of another call (correlation id " << id << ", expected " << correlationId << ").");
+
+        return CorrelatedPrefixSize;
+    }
+}
@@ -0,0 +1,132 @@
+// InstancePool - opt-in pooled factory of server instances. Instance deleted by client (or when no client uses it) returns
+// to the pool and is reused with a new instance id generation (calls with the old id fail), so construction, instance id
+// and method callers registration are amortized. Instances are placed in slabs of the class.
+// Class implements Reset with the same parameters as its constructor, it is called when released instance is reused:
+//     static RemoteCall::InstancePool<CTest> s_tests;
+//     ITest* REMOTE_FUNCTION_IMPL(TestClassFactory)(const std::string& s, const std::string& c) { return s_tests.Create(s, 10); }
+
+#pragma once
+
+#include "RemoteCallInterface.h"
+
+#include <new>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+namespace RemoteCall
+{
+    template <typename C, size_t SlabSize = 64>
+    struct InstancePool: public InstancePoolBase
+    {
+        InstancePool() {}
+
+        InstancePool(const InstancePool&) = delete;
+        void operator = (const InstancePool&) = delete;
+
+        template <typename ...Args>
+        C* Create(Args&&...args)
+        {
+            Entry* pEntry = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!free_.empty())
+                {
+                    pEntry = free_.back();
+                    free_.pop_back();
+                }
+                else
+                {
+                    if (slabs_.empty()  ||  SlabSize == used_)
+                    {
+                        slabs_.push_back(new Entry[SlabSize]);
+                        used_ = 0;
+                    }
+
+                    pEntry = &slabs_.back()[used_++];
+                }
+            }
+
+            if (pEntry->constructed_)
+            {
+                auto pC = pEntry->Get();
+                pC->Reset(args...);
+
+                pEntry->generation_++;
+
+                // Generation goes before the node tag, which is the current one like in ids of new instances
+                ToString id;
+                id << pC->instanceId_.substr(0, pEntry->baseLength_) << '.' << pEntry->generation_;
+
+                if (!GetNodeTag().empty())
+                {
+                    id << '@' << GetNodeTag();
+                }
+
+                pC->Reuse(id);
+
+                return pC;
+            }
+
+            auto pC = new (&pEntry->storage_) C(std::forward<Args>(args)...);
+
+            pEntry->constructed_ = true;
+            pEntry->baseLength_ = std::min(pC->instanceId_.size(), pC->instanceId_.rfind('@'));
+
+            pC->pPool_ = this;
+
+            return pC;
+        }
+
+        // Called by the released instance
+        void Put(RemoteInterface* pInterface) override
+        {
+            auto pEntry = reinterpret_cast<Entry*>(static_cast<C*>(pInterface));
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            free_.push_back(pEntry);
+        }
+
+        // Constructed instances, and released ones ready for reuse
+        size_t Size()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return slabs_.empty()? 0: (slabs_.size() - 1) * SlabSize + used_;
+        }
+
+        size_t Free()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return free_.size();
+        }
+
+    private:
+        // Instance is at the beginning of its entry
+        struct Entry
+        {
+            typename std::aligned_storage<sizeof(C), alignof(C)>::type storage_;
+            size_t baseLength_ = 0;
+            unsigned int generation_ = 0;
+            bool constructed_ = false;
+
+            C* Get()
+            {
+                return reinterpret_cast<C*>(&storage_);
+            }
+        };
+
+        static_assert(std::is_standard_layout<Entry>::value, "Entry should have standard layout");
+
+        // Pool is static like registries of instances, its instances and slabs are not destroyed (they can be in use until the process exits)
+        std::vector<Entry*> slabs_;
+        size_t used_ = 0;
+        std::vector<Entry*> free_;
+        std::mutex locker_;
+    };
+}
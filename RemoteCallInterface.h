@@ -1,5 +1,9 @@
 #pragma once
 
+#include "RemoteCallUtils.h"
+
+#include <map>
+#include <mutex>
 #include <string>
 #include <thread>
 #include <atomic>
@@ -11,6 +15,33 @@ namespace RemoteCall
     struct RemoteInterface;
     void AddInterface(RemoteInterface* pInterface);
     void RemoveInterface(RemoteInterface* pInterface);
+    void RemoveProxy(RemoteInterface* pProxy);
+
+    // Pool keeping released instances for reuse (RemoteCallInstancePool.h)
+    struct InstancePoolBase
+    {
+        virtual void Put(RemoteInterface* pInterface) = 0;
+    };
+
+    // Node tag of this process is appended to instance ids ("id@tag"), 
+    // client transport over several servers sends methods to the server which created the instance
+    inline std::string& GetNodeTag()
+    {
+        static std::string s_nodeTag = CreateUniqueId().substr(0, 12); return s_nodeTag;
+    }
+
+    // Should be called before instances are created, tag should be unique between servers
+    inline void SetNodeTag(const std::string& tag)
+    {
+        GetNodeTag() = tag;
+    }
+
+    inline std::string InstanceNodeTag(const std::string& instanceId)
+    {
+        auto pos = instanceId.rfind('@');
+
+        return std::string::npos == pos? std::string(): instanceId.substr(pos + 1);
+    }
 
     struct RemoteInterface
     {
@@ -20,9 +51,21 @@ namespace RemoteCall
             AddInterface(this);
         }
 
+        // Proxy of remote instance, it is not registered for calls
+        explicit RemoteInterface(const std::string& instanceId)
+            : instanceId_(instanceId), proxy_(true), counter_(1)
+        {}
+
         virtual ~RemoteInterface() 
         {
-            RemoveInterface(this);
+            if (proxy_)
+            {
+                RemoveProxy(this);
+            }
+            else
+            {
+                RemoveInterface(this);
+            }
         }
 
 
@@ -35,6 +78,34 @@ namespace RemoteCall
 
 	bool deleteWhenNoClient_ = false;
 
+        const bool proxy_ = false;
+
+        // Pool of the instance, it returns there instead of being deleted
+        InstancePoolBase* pPool_ = nullptr;
+
+        // Called when the instance is deleted by client, or when no client uses it
+        void Dispose()
+        {
+            if (pPool_)
+            {
+                pPool_->Put(this);
+            }
+            else
+            {
+                delete this;
+            }
+        }
+
+        // Pooled instance is reused with a new id, calls with the old one fail
+        void Reuse(const std::string& instanceId)
+        {
+            instanceId_ = instanceId;
+            deleteWhenNoClient_ = false;
+            counter_ = 1;
+
+            AddInterface(this);
+        }
+
 	void IncCounter()
 	{
 	   counter_++;
@@ -47,7 +118,7 @@ namespace RemoteCall
 	   {
 	      if (deleteWhenNoClient_)
 	      {
-	         delete this;
+	         Dispose();
 	      }
 	   }
 	}
@@ -58,7 +129,15 @@ namespace RemoteCall
         {
 	   static std::atomic<unsigned int> s_counter{0};
             
-           return ToString() << std::this_thread::get_id() << ':' << ++s_counter;
+           ToString id;
+           id << std::this_thread::get_id() << ':' << ++s_counter;
+
+           if (!GetNodeTag().empty())
+           {
+               id << '@' << GetNodeTag();
+           }
+
+           return id;
         }
         
    private:
@@ -66,6 +145,102 @@ namespace RemoteCall
     };
 
 
+    // Proxies - proxies of remote instances by instance id, an instance received several times has one proxy.
+    // Proxy has a reference per receiving, it is deleted when all are released (or when it is deleted directly).
+    struct Proxies
+    {
+        RemoteInterface* Acquire(const std::string& instanceId)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = mapInstanceIdProxy_.find(instanceId);
+            if (it == mapInstanceIdProxy_.end())
+            {
+                it = mapInstanceIdProxy_.insert(std::make_pair(instanceId, Entry{ new RemoteInterface(instanceId), 0 })).first;
+            }
+
+            it->second.refs_++;
+
+            return it->second.pProxy_;
+        }
+
+        void AddRef(RemoteInterface* pProxy)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = mapInstanceIdProxy_.find(pProxy->instanceId_);
+            if (it != mapInstanceIdProxy_.end()  &&  it->second.pProxy_ == pProxy)
+            {
+                it->second.refs_++;
+            }
+        }
+
+        // Returns true if the last reference is released (proxy is deleted)
+        bool Release(RemoteInterface* pProxy)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                auto it = mapInstanceIdProxy_.find(pProxy->instanceId_);
+                if (it != mapInstanceIdProxy_.end()  &&  it->second.pProxy_ == pProxy  &&  --it->second.refs_)
+                    return false;
+            }
+
+            delete pProxy;
+
+            return true;
+        }
+
+        // Called by proxy destructor
+        void Remove(RemoteInterface* pProxy)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = mapInstanceIdProxy_.find(pProxy->instanceId_);
+            if (it != mapInstanceIdProxy_.end()  &&  it->second.pProxy_ == pProxy)
+            {
+                mapInstanceIdProxy_.erase(it);
+            }
+        }
+
+        size_t Count()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return mapInstanceIdProxy_.size();
+        }
+
+    private:
+        struct Entry
+        {
+            RemoteInterface* pProxy_;
+            size_t refs_;
+        };
+
+        std::map<std::string, Entry> mapInstanceIdProxy_;
+        std::mutex locker_;
+    };
+
+    inline Proxies* GetProxies()
+    {
+        static Proxies s_proxies; return &s_proxies;
+    }
+
+    inline void RemoveProxy(RemoteInterface* pProxy)
+    {
+        GetProxies()->Remove(pProxy);
+    }
+
+    // Releases reference of received interface pointer, the proxy is deleted with the last one (the remote instance is not deleted)
+    inline void Release(RemoteInterface* pProxy)
+    {
+        if (pProxy  &&  pProxy->proxy_)
+        {
+            GetProxies()->Release(pProxy);
+        }
+    }
+
+
     template <typename I>
     struct TRemoteInterface: public RemoteInterface
     {
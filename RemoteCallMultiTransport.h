@@ -0,0 +1,667 @@
+// MultiTransport - client transport over several endpoints (transports of type E to equivalent servers).
+// Function calls are balanced by power of two choices on calls in flight, methods are sent to the server of the instance.
+// Idempotent function call is hedged: if reply is not received during a percentile of latencies of recent calls,
+// the same call is sent to another endpoint and the first reply is used. Failed idempotent calls are retried with jittered backoff.
+
+#pragma once
+
+#include "RemoteCallClient.h"
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <iterator>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+namespace RemoteCall
+{
+    struct CallPolicy
+    {
+        // Hedged call is sent after this percentile of latencies of recent calls (0 disables hedging)
+        double hedgePercentile_ = 0.95;
+
+        // Hedging delay until enough latencies are measured, and the minimal delay
+        std::chrono::microseconds initialHedgeDelay_{10000};
+        std::chrono::microseconds minHedgeDelay_{100};
+
+        // Hedged calls in flight (until their attempts and cancellations finish), other calls are sent without hedging
+        int maxHedges_ = 16;
+
+        // Idempotent call failed with TransportError, or any call rejected with Overloaded, 
+        // is retried after random delay up to min(backoffBase_ * 2^retry, backoffMax_)
+        int maxRetries_ = 2;
+        std::chrono::milliseconds backoffBase_{10};
+        std::chrono::milliseconds backoffMax_{1000};
+
+        // Endpoint failed with TransportError is not chosen during this time while other endpoints are available
+        std::chrono::milliseconds downTime_{1000};
+
+        // Node tag which no endpoint has is not requested again during this time
+        std::chrono::milliseconds unknownTagTime_{1000};
+    };
+
+
+    // LatencyWindow - latencies of the last calls
+    struct LatencyWindow
+    {
+        void Add(std::chrono::microseconds latency)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            samples_[next_++ % Size] = latency.count();
+
+            if (count_ < Size)
+            {
+                count_++;
+            }
+        }
+
+        // Returns 'fallback' until enough latencies are measured
+        std::chrono::microseconds Percentile(double percentile, std::chrono::microseconds fallback)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            if (count_ < MinSamples)
+                return fallback;
+
+            // Recalculated after several new latencies
+            if (next_ - calculated_ >= Recalculate  ||  percentile != percentile_)
+            {
+                std::vector<int64_t> v(samples_, samples_ + count_);
+
+                auto it = v.begin() + std::min(count_ - 1, (size_t)(percentile * count_));
+                std::nth_element(v.begin(), it, v.end());
+
+                value_ = *it;
+                percentile_ = percentile;
+                calculated_ = next_;
+            }
+
+            return std::chrono::microseconds(value_);
+        }
+
+    private:
+        enum { Size = 512, MinSamples = 32, Recalculate = 32 };
+
+        int64_t samples_[Size];
+        size_t next_ = 0;
+        size_t count_ = 0;
+
+        size_t calculated_ = 0;
+        double percentile_ = 0;
+        int64_t value_ = 0;
+
+        std::mutex locker_;
+    };
+
+
+    // Workers - threads running hedged calls, created on demand and reused
+    struct Workers
+    {
+        ~Workers()
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                stop_ = true;
+            }
+
+            cv_.notify_all();
+
+            for (auto& thread: threads_)
+            {
+                thread.join();
+            }
+        }
+
+        void Run(std::function<void()> task)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                tasks_.push_back(std::move(task));
+
+                if (idle_ < tasks_.size())
+                {
+                    threads_.emplace_back([this] { Work(); });
+                }
+            }
+
+            cv_.notify_one();
+        }
+
+    private:
+        void Work()
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            while (true)
+            {
+                idle_++;
+                cv_.wait(lock, [this] { return stop_  ||  !tasks_.empty(); });
+                idle_--;
+
+                if (stop_)
+                    return;
+
+                auto task = std::move(tasks_.front());
+                tasks_.pop_front();
+
+                lock.unlock();
+                task();
+                lock.lock();
+            }
+        }
+
+        std::vector<std::thread> threads_;
+        std::deque<std::function<void()>> tasks_;
+        size_t idle_ = 0;
+        bool stop_ = false;
+        std::mutex locker_;
+        std::condition_variable cv_;
+    };
+
+
+    // Result of a call attempt
+    template <typename Ret>
+    struct AttemptResult
+    {
+        template <typename F>
+        void Set(F f)
+        {
+            value_ = f();
+        }
+
+        Ret Get()
+        {
+            return std::move(value_);
+        }
+
+        Ret value_{};
+    };
+
+    template <>
+    struct AttemptResult<void>
+    {
+        template <typename F>
+        void Set(F f)
+        {
+            f();
+        }
+
+        void Get() {}
+    };
+
+    // HedgedCall - attempts of one call, the first reply (or the last TransportError) completes the call.
+    // It is counted in 'hedges' until its last attempt or cancellation finishes.
+    template <typename Ret>
+    struct HedgedCall
+    {
+        explicit HedgedCall(std::atomic<int>& hedges)
+            : hedges_(hedges)
+        {}
+
+        ~HedgedCall()
+        {
+            hedges_--;
+        }
+
+        AttemptResult<Ret> result_;
+        std::exception_ptr pError_;
+
+        bool done_ = false;
+        int pending_ = 0;
+
+        // Endpoints of started attempts, and of the first reply
+        std::vector<size_t> started_;
+        size_t winner_ = 0;
+
+        std::atomic<int>& hedges_;
+
+        std::mutex locker_;
+        std::condition_variable cv_;
+    };
+
+
+    // Endpoint of MultiTransport and its load
+    template <typename E>
+    struct EndpointInfo
+    {
+        std::unique_ptr<E> pTransport_;
+        std::atomic<int> inFlight_{0};
+
+        // steady_clock time until which endpoint is not chosen
+        std::atomic<int64_t> downUntil_{0};
+    };
+
+
+    template <typename E>
+    struct MultiTransport
+    {
+        // Creates endpoint transports E(address, args...)
+        template <typename ...Args>
+        MultiTransport(const std::vector<std::string>& addresses, const CallPolicy& policy, const Args&...args)
+            : policy_(policy)
+        {
+            if (addresses.empty())
+                throw Exception(Exception::TransportError, "No endpoints.");
+
+            for (auto& address: addresses)
+            {
+                endpoints_.emplace_back(new EndpointInfo<E>);
+                endpoints_.back()->pTransport_.reset(new E(address, args...));
+            }
+        }
+
+        MultiTransport(const MultiTransport&) = delete;
+        void operator = (const MultiTransport&) = delete;
+
+        template <bool useSendReceive, typename Ret>
+        Ret operator()(const FunctionInfo<useSendReceive, Ret>& callInfo) const
+        {
+            return Call<Ret>(callInfo, [this](size_t failed) { return Choose(failed); }, Hedged(callInfo));
+        }
+
+        // Instance exists on the server which created it, it is found by node tag of instance id
+        template <bool useSendReceive, typename Ret>
+        Ret operator()(const MethodInfo<useSendReceive, Ret>& callInfo) const
+        {
+            size_t index = Find(callInfo.InstanceId());
+
+            return Call<Ret>(callInfo, [index](size_t) { return index; }, false);
+        }
+
+        TransportWithDeadline<MultiTransport> WithDeadline(std::chrono::milliseconds timeout) const
+        {
+            return TransportWithDeadline<MultiTransport>(*this, std::chrono::system_clock::now() + timeout);
+        }
+
+        TransportWithDeadline<MultiTransport> WithDeadline(Deadline deadline) const
+        {
+            return TransportWithDeadline<MultiTransport>(*this, deadline);
+        }
+
+        // Calls started with 'source' can run on any endpoint, it is sent to all of them
+        void Cancel(const CancellationSource& source) const
+        {
+            for (auto& pEndpoint: endpoints_)
+            {
+                try
+                {
+                    (*pEndpoint->pTransport_)(source.Cancel());
+                }
+                catch (const Exception&)
+                {
+                }
+            }
+        }
+
+        void InvalidateCache(const std::string& function = std::string()) const
+        {
+            for (auto& pEndpoint: endpoints_)
+            {
+                pEndpoint->pTransport_->InvalidateCache(function);
+            }
+        }
+
+        size_t EndpointCount() const
+        {
+            return endpoints_.size();
+        }
+
+        E& Endpoint(size_t index) const
+        {
+            return *endpoints_[index]->pTransport_;
+        }
+
+        // Calls in flight of endpoint
+        int Load(size_t index) const
+        {
+            return endpoints_[index]->inFlight_;
+        }
+
+    private:
+        // Hedged call is sent twice, so its parameters cannot be changed by reply and the result cannot be an instance on one server
+        template <bool useSendReceive, typename Ret>
+        bool Hedged(const FunctionInfo<useSendReceive, Ret>& callInfo) const
+        {
+            if (!useSendReceive  ||  std::is_pointer<Ret>::value  ||  callInfo.idempotencyKey_.empty()  ||
+                endpoints_.size() < 2  ||  policy_.hedgePercentile_ <= 0)
+                return false;
+
+            for (auto& el: callInfo.vPar_)
+            {
+                if (el.Out()  ||  el.Source())
+                    return false;
+            }
+
+            return true;
+        }
+
+        // 'select' returns endpoint of the call, it is passed endpoint which failed the previous attempt
+        template <typename Ret, typename Info, typename S>
+        Ret Call(const Info& callInfo, S select, bool hedged) const
+        {
+            size_t failed = NoEndpoint;
+
+            for (int retry = 0; ; retry++)
+            {
+                size_t index = select(failed);
+
+                try
+                {
+                    if (hedged)
+                        return Hedge<Ret>(callInfo, index);
+
+                    return Send<Ret>(index, [&](E& transport) { return transport(callInfo); });
+                }
+                catch (const Exception& e)
+                {
+                    // Not idempotent call could be executed by server, call rejected by server admission was not started
+                    bool retriable = Exception::Overloaded == e.Error()  ||  (Exception::TransportError == e.Error()  &&  !callInfo.idempotencyKey_.empty());
+
+                    if (!retriable  ||  retry >= policy_.maxRetries_)
+                        throw;
+                }
+
+                failed = index;
+
+                Backoff(retry);
+            }
+        }
+
+        // Calls 'send' with endpoint transport, counts calls in flight, latencies and failures
+        template <typename Ret, typename F>
+        Ret Send(size_t index, F send) const
+        {
+            auto& endpoint = *endpoints_[index];
+
+            endpoint.inFlight_++;
+
+            auto start = std::chrono::steady_clock::now();
+
+            AttemptResult<Ret> result;
+
+            try
+            {
+                result.Set([&] { return send(*endpoint.pTransport_); });
+            }
+            catch (const Exception& e)
+            {
+                endpoint.inFlight_--;
+
+                if (Exception::TransportError == e.Error())
+                {
+                    endpoint.downUntil_ = (std::chrono::steady_clock::now() + policy_.downTime_).time_since_epoch().count();
+                }
+
+                throw;
+            }
+            catch (...)
+            {
+                endpoint.inFlight_--;
+                throw;
+            }
+
+            endpoint.inFlight_--;
+
+            latencies_.Add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
+            return result.Get();
+        }
+
+        // Power of two choices: of two random endpoints which are not down the one with less calls in flight
+        size_t Choose(size_t excluded = NoEndpoint) const
+        {
+            size_t count = endpoints_.size();
+            if (1 == count)
+                return 0;
+
+            auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+
+            auto usable = [&](size_t index) { return index != excluded  &&  endpoints_[index]->downUntil_ <= now; };
+
+            size_t first = Random()() % count;
+            size_t second = Random()() % (count - 1);
+            if (second >= first)
+            {
+                second++;
+            }
+
+            if (usable(first)  &&  usable(second))
+                return endpoints_[first]->inFlight_ <= endpoints_[second]->inFlight_? first: second;
+
+            if (usable(first))
+                return first;
+
+            if (usable(second))
+                return second;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (usable(i))
+                    return i;
+            }
+
+            // All endpoints are down
+            return first != excluded? first: second;
+        }
+
+        // Endpoint of instance by node tag of its id. Tags of endpoints are requested (without the lock) when tag is not known 
+        // (server is added or restarted with a new tag), tag which is still not found is not requested during 'unknownTagTime_'.
+        size_t Find(const std::string& instanceId) const
+        {
+            auto tag = InstanceNodeTag(instanceId);
+            if (tag.empty()  ||  1 == endpoints_.size())
+                return 0;
+
+            auto now = std::chrono::steady_clock::now();
+
+            {
+                std::lock_guard<std::mutex> lock(tagsLocker_);
+
+                auto it = mapTagEndpoint_.find(tag);
+                if (it != mapTagEndpoint_.end())
+                    return it->second;
+
+                auto itUnknown = mapUnknownTags_.find(tag);
+                if (itUnknown != mapUnknownTags_.end()  &&  itUnknown->second > now)
+                    throw Exception(Exception::InvalidClassInstance, ToString() << "No server of class instance " << instanceId << '.');
+            }
+
+            std::vector<std::pair<std::string, size_t>> tags;
+            for (size_t i = 0; i < endpoints_.size(); i++)
+            {
+                try
+                {
+                    tags.emplace_back((*endpoints_[i]->pTransport_)(FunctionInfo<true, std::string>("~NodeTag", std::vector<Param>())), i);
+                }
+                catch (const Exception&)
+                {
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(tagsLocker_);
+
+            for (auto& el: tags)
+            {
+                mapTagEndpoint_[el.first] = el.second;
+                mapUnknownTags_.erase(el.first);
+            }
+
+            auto it = mapTagEndpoint_.find(tag);
+            if (it != mapTagEndpoint_.end())
+                return it->second;
+
+            // Expired unknown tags are removed when a new one is added
+            for (auto itUnknown = mapUnknownTags_.begin(); itUnknown != mapUnknownTags_.end(); )
+            {
+                itUnknown = itUnknown->second <= now? mapUnknownTags_.erase(itUnknown): std::next(itUnknown);
+            }
+
+            mapUnknownTags_[tag] = now + policy_.unknownTagTime_;
+
+            throw Exception(Exception::InvalidClassInstance, ToString() << "No server of class instance " << instanceId << '.');
+        }
+
+        // Attempts have cancel id (if the call is not started with CancellationSource), so the loser is cancelled on its server.
+        // Worker threads are limited by the number of hedged calls in flight, the call over it is not hedged.
+        template <typename Ret, typename Info>
+        Ret Hedge(const Info& call, size_t index) const
+        {
+            if (hedges_++ >= policy_.maxHedges_)
+            {
+                hedges_--;
+
+                return Send<Ret>(index, [&](E& transport) { return transport(call); });
+            }
+
+            auto pCall = std::make_shared<HedgedCall<Ret>>(hedges_);
+
+            CancellationSource source;
+
+            Info callInfo(call);
+            if (callInfo.cancelId_.empty())
+            {
+                callInfo.Cancellation(source);
+            }
+
+            std::unique_lock<std::mutex> lock(pCall->locker_);
+
+            Attempt(pCall, callInfo, index);
+
+            auto delay = std::max(policy_.minHedgeDelay_, latencies_.Percentile(policy_.hedgePercentile_, policy_.initialHedgeDelay_));
+
+            if (!pCall->cv_.wait_for(lock, delay, [&] { return pCall->done_; }))
+            {
+                Attempt(pCall, callInfo, Choose(index));
+            }
+
+            pCall->cv_.wait(lock, [&] { return pCall->done_; });
+
+            if (pCall->pending_  &&  source.id_ == callInfo.cancelId_)
+            {
+                for (auto loser: pCall->started_)
+                {
+                    if (loser == pCall->winner_)
+                        continue;
+
+                    workers_.Run([this, loser, source, pCall]()
+                    {
+                        try
+                        {
+                            (*endpoints_[loser]->pTransport_)(source.Cancel());
+                        }
+                        catch (const Exception&)
+                        {
+                        }
+                    });
+                }
+            }
+
+            if (pCall->pError_)
+                std::rethrow_exception(pCall->pError_);
+
+            return pCall->result_.Get();
+        }
+
+        // Sends the call to endpoint in worker thread, called under lock of 'pCall'.
+        // Frame is written here since parameters are valid only until the call returns.
+        template <typename Ret, typename Info>
+        void Attempt(const std::shared_ptr<HedgedCall<Ret>>& pCall, const Info& callInfo, size_t index) const
+        {
+            Serializer writer;
+            endpoints_[index]->pTransport_->WriteFrame(callInfo, writer, false);
+
+            pCall->pending_++;
+            pCall->started_.push_back(index);
+
+            workers_.Run([this, pCall, index, callInfo, writer]() mutable
+            {
+                AttemptResult<Ret> result;
+                std::exception_ptr pError;
+                // Attempt failed without reply, the other attempt can still reply
+                bool failed = false;
+
+                // Loser which did not start is cancelled
+                bool cancelled;
+                {
+                    std::lock_guard<std::mutex> lock(pCall->locker_);
+
+                    cancelled = pCall->done_;
+                }
+
+                if (!cancelled)
+                {
+                    try
+                    {
+                        result.Set([&] { return Send<Ret>(index, [&](E& transport) { return transport.Call(callInfo, writer); }); });
+                    }
+                    catch (const Exception& e)
+                    {
+                        pError = std::current_exception();
+                        failed = Exception::TransportError == e.Error()  ||  Exception::Overloaded == e.Error();
+                    }
+                    catch (...)
+                    {
+                        pError = std::current_exception();
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(pCall->locker_);
+
+                    pCall->pending_--;
+
+                    if (!pCall->done_  &&  !cancelled  &&  (!failed  ||  !pCall->pending_))
+                    {
+                        pCall->result_ = std::move(result);
+                        pCall->pError_ = pError;
+                        pCall->winner_ = index;
+                        pCall->done_ = true;
+                    }
+                }
+
+                pCall->cv_.notify_all();
+
+                // Result of the loser (for instance Stream which cancels itself on server) is destroyed here,
+                // running loser is cancelled via '~Cancel'
+            });
+        }
+
+        void Backoff(int retry) const
+        {
+            auto maxDelay = std::min(policy_.backoffMax_.count(), policy_.backoffBase_.count() << std::min(retry, 20));
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::uniform_int_distribution<int64_t>(0, maxDelay)(Random())));
+        }
+
+        static std::mt19937& Random()
+        {
+            static thread_local std::mt19937 s_random(std::random_device{}()); return s_random;
+        }
+
+        static constexpr size_t NoEndpoint = (size_t)-1;
+
+        CallPolicy policy_;
+        std::vector<std::unique_ptr<EndpointInfo<E>>> endpoints_;
+        mutable LatencyWindow latencies_;
+
+        mutable std::map<std::string, size_t> mapTagEndpoint_;
+        mutable std::map<std::string, std::chrono::steady_clock::time_point> mapUnknownTags_;
+        mutable std::mutex tagsLocker_;
+
+        mutable std::atomic<int> hedges_{0};
+
+        // Destroyed first, so running attempts are finished while endpoints exist
+        mutable Workers workers_;
+    };
+}
@@ -0,0 +1,175 @@
+// Native layout - peers with the same ABI (byte order, type sizes and alignments, compiler family) negotiate it when the session is opened.
+// Then arguments of calls whose parameters are all numbers, enums or structures marked by NativeLayout are sent as one block: each
+// argument at the offset computed at compile time from the declared parameters, the block aligned from the start of the frame. Server
+// passes them to the handler in place. Other calls, and all calls between peers with different ABIs, use the portable encoding.
+//     struct ClientTransport: public RemoteCall::Transport<ClientTransport>
+//     {
+//         bool UseSession() const override { return true; }
+//         bool UseNativeArgs() const override { return true; }
+//     namespace RemoteCall { template <> struct NativeLayout<Point>: std::true_type {}; }
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <type_traits>
+
+namespace RemoteCall
+{
+    namespace NativeDetail
+    {
+        constexpr bool LittleEndian()
+        {
+#if defined(__BYTE_ORDER__)
+            return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+            return true;
+#endif
+        }
+
+        constexpr uint64_t Compiler()
+        {
+#if defined(_MSC_VER)  &&  !defined(__clang__)
+            return 1;
+#elif defined(__clang__)
+            return 2;
+#elif defined(__GNUC__)
+            return 3;
+#else
+            return 0;
+#endif
+        }
+    }
+
+    // Fingerprint of the layout of trivially copyable types, peers with the same one read each other's blocks as they are
+    inline constexpr uint64_t NativeAbi()
+    {
+        const uint64_t values[] = { NativeDetail::LittleEndian(), NativeDetail::Compiler(), CHAR_BIT, sizeof(bool), sizeof(wchar_t),
+            sizeof(short), sizeof(int), sizeof(long), sizeof(long long), sizeof(void*), sizeof(long double),
+            alignof(double), alignof(long long), alignof(long double), alignof(std::max_align_t) };
+
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (auto el: values)
+        {
+            hash = (hash ^ el) * 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+
+    // Structure whose bytes are its value (no pointers, handles or padding which matters) is sent in the block if it is marked:
+    //     namespace RemoteCall { template <> struct NativeLayout<Point>: std::true_type {}; }
+    template <typename T>
+    struct NativeLayout: std::false_type {};
+
+    // Parameter which can be sent in the block: input number (not bool, its byte could be other than 0 or 1), enum, 
+    // or trivially copyable structure marked by NativeLayout
+    template <typename DeclArg>
+    struct NativeArg
+    {
+        using Type = typename std::remove_const<typename std::remove_reference<DeclArg>::type>::type;
+
+        static constexpr bool value = ((std::is_arithmetic<Type>::value  &&  !std::is_same<Type, bool>::value)  ||  std::is_enum<Type>::value  ||
+            (NativeLayout<Type>::value  &&  std::is_trivially_copyable<Type>::value))  &&  alignof(Type) <= alignof(std::max_align_t)  &&
+            !(std::is_lvalue_reference<DeclArg>::value  &&  !std::is_const<typename std::remove_reference<DeclArg>::type>::value);
+    };
+
+    constexpr size_t AlignUp(size_t pos, size_t alignment)
+    {
+        return (pos + alignment - 1) / alignment * alignment;
+    }
+
+    template <typename ...DeclArgs> struct AllNativeArgs;
+
+    template <typename DeclArg, typename ...DeclArgs>
+    struct AllNativeArgs<DeclArg, DeclArgs...>
+    {
+        static constexpr bool value = NativeArg<DeclArg>::value  &&  AllNativeArgs<DeclArgs...>::value;
+    };
+
+    template <> struct AllNativeArgs<>
+    {
+        static constexpr bool value = true;
+    };
+
+
+    // NativePack - layout of the block of declared parameters, calls without parameters do not use it
+    template <typename ...DeclArgs>
+    struct NativePack
+    {
+        static constexpr bool value = sizeof...(DeclArgs) > 0  &&  AllNativeArgs<DeclArgs...>::value;
+
+        // Offset of parameter 'i' in the block
+        static constexpr size_t Offset(size_t i)
+        {
+            const size_t sizes[] = { sizeof(typename NativeArg<DeclArgs>::Type)..., 0 };
+            const size_t alignments[] = { alignof(typename NativeArg<DeclArgs>::Type)..., 1 };
+
+            size_t pos = 0;
+            for (size_t j = 0; j < i; j++)
+            {
+                pos = AlignUp(pos, alignments[j]) + sizes[j];
+            }
+
+            return AlignUp(pos, alignments[i]);
+        }
+
+        static constexpr size_t Alignment()
+        {
+            const size_t alignments[] = { alignof(typename NativeArg<DeclArgs>::Type)..., 1 };
+
+            size_t alignment = 1;
+            for (auto el: alignments)
+            {
+                alignment = el > alignment? el: alignment;
+            }
+
+            return alignment;
+        }
+
+        static constexpr size_t Size()
+        {
+            return AlignUp(Offset(sizeof...(DeclArgs)), Alignment());
+        }
+    };
+
+
+    // Writes pad size and padding, returns the block of 'size' bytes to which the arguments are copied
+    inline char* ReserveNativeBlock(Serializer& writer, size_t size, size_t alignment)
+    {
+        auto pos = writer.TotalSize() + 1;
+        auto pad = AlignUp(pos, alignment) - pos;
+
+        writer << (uint8_t)pad;
+
+        return writer.Reserve(pad + size) + pad;
+    }
+
+    // Returns the block written by WriteNativeBlock in place, or its aligned copy in 'copy' if the frame is not aligned
+    inline char* ReadNativeBlock(Serializer& reader, size_t size, size_t alignment, std::vector<char>& copy)
+    {
+        uint8_t pad;
+        reader >> pad;
+
+        reader.Skip(pad);
+        reader.Require(size);
+
+        auto p = const_cast<char*>(reader.ReadData());
+        reader.Skip(size);
+
+        if ((uintptr_t)p % alignment)
+        {
+            copy.assign(p, p + size);
+            p = copy.data();
+        }
+
+        return p;
+    }
+}
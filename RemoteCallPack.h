@@ -0,0 +1,77 @@
+// Pack - compile-time layout of the arguments of a declared signature. Leading parameters of arithmetic type form the fixed prefix
+// of the pack: its size and their offsets are constants, so client writes it and server reads it as one block, the other parameters
+// follow it. The encoding is the same as writing the arguments one by one.
+
+#pragma once
+
+#include <tuple>
+#include <cstddef>
+#include <type_traits>
+
+namespace RemoteCall
+{
+    template <typename DeclArg>
+    struct PackArg
+    {
+        using Type = typename std::remove_const<typename std::remove_reference<DeclArg>::type>::type;
+
+        // Written as it is in memory
+        static constexpr bool fixed = std::is_arithmetic<Type>::value;
+
+        // Non-const reference, it is sent back in the reply
+        static constexpr bool out = std::is_lvalue_reference<DeclArg>::value  &&  !std::is_const<typename std::remove_reference<DeclArg>::type>::value;
+    };
+
+    template <typename ...DeclArgs>
+    struct Pack
+    {
+        template <size_t i>
+        using Arg = PackArg<typename std::tuple_element<i, std::tuple<DeclArgs...>>::type>;
+
+        // Parameters in the fixed prefix
+        static constexpr size_t FixedCount()
+        {
+            const bool fixed[] = { PackArg<DeclArgs>::fixed..., false };
+
+            size_t count = 0;
+            while (fixed[count])
+            {
+                count++;
+            }
+
+            return count;
+        }
+
+        // Offset of parameter 'i' in the fixed prefix (size of the prefix for the other parameters)
+        static constexpr size_t FixedOffset(size_t i)
+        {
+            const size_t sizes[] = { sizeof(typename PackArg<DeclArgs>::Type)..., 0 };
+
+            size_t offset = 0;
+            for (size_t j = 0; j < i  &&  j < FixedCount(); j++)
+            {
+                offset += sizes[j];
+            }
+
+            return offset;
+        }
+
+        static constexpr size_t FixedSize()
+        {
+            return FixedOffset(sizeof...(DeclArgs));
+        }
+
+        static constexpr bool AnyOut()
+        {
+            const bool out[] = { PackArg<DeclArgs>::out..., false };
+
+            for (auto el: out)
+            {
+                if (el)
+                    return true;
+            }
+
+            return false;
+        }
+    };
+}
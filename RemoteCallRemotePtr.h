@@ -0,0 +1,176 @@
+// RemotePtr - reference counted pointer to remote instance. When the last reference of its proxy is released, the instance is deleted
+// on server, deletes are sent in batches by RemoteDeletes of the transport (by sender threads, not by the thread releasing it):
+//     RemoteCall::RemoteDeletes<ClientTransport> deletes(transport);
+//     RemoteCall::RemotePtr<ITest> pTest = deletes.Hold(transport(TestClassFactory("Test ", "Z")));
+//     transport(pTest->UpdateData("ABC", 5));
+
+#pragma once
+
+#include "RemoteCallClient.h"
+#include "RemoteCallCallbackQueue.h"
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace RemoteCall
+{
+    template <typename I>
+    using RemotePtr = std::shared_ptr<I>;
+
+
+    // One-way call deleting instances on server
+    inline FunctionInfo<false, void> DeleteInstances(const std::vector<std::string>& instanceIds)
+    {
+        return FunctionInfo<false, void>("~Delete", std::vector<Param>{ ParamType<false>(instanceIds) });
+    }
+
+
+    template <typename T>
+    struct RemoteDeletes
+    {
+        // Deletes are sent by 'pSenders' when 'batch' instances are released, or by Flush
+        RemoteDeletes(const T& transport, size_t batch = 64, CallbackSenders* pSenders = GetCallbackSenders())
+            : pState_(std::make_shared<State>(transport, batch, pSenders))
+        {}
+
+        // Pending deletes are sent, instances released later are deleted by server when the client disconnects
+        ~RemoteDeletes()
+        {
+            Flush();
+
+            std::unique_lock<std::mutex> lock(pState_->locker_);
+
+            // Transport can be destroyed with this
+            pState_->cv_.wait(lock, [this] { return !pState_->sending_; });
+
+            pState_->pTransport_ = nullptr;
+        }
+
+        RemoteDeletes(const RemoteDeletes&) = delete;
+        void operator = (const RemoteDeletes&) = delete;
+
+        // Takes reference of received interface pointer (it is not released otherwise), the instance is deleted 
+        // when the last reference of its proxy is released
+        template <typename I>
+        RemotePtr<I> Hold(I* pI)
+        {
+            if (!pI)
+                return RemotePtr<I>();
+
+            auto pState = pState_;
+
+            return RemotePtr<I>(pI, [pState](I* pI)
+            {
+                auto instanceId = pI->instanceId_;
+
+                if (GetProxies()->Release(pI))
+                {
+                    pState->Add(instanceId);
+                }
+            });
+        }
+
+        // Sends pending deletes by this thread
+        void Flush()
+        {
+            pState_->Flush();
+        }
+
+        size_t Pending() const
+        {
+            std::lock_guard<std::mutex> lock(pState_->locker_);
+
+            return pState_->instanceIds_.size();
+        }
+
+    private:
+        struct State: public std::enable_shared_from_this<State>
+        {
+            State(const T& transport, size_t batch, CallbackSenders* pSenders)
+                : pTransport_(&transport), batch_(batch), pSenders_(pSenders)
+            {}
+
+            // Called by RemotePtr deleter, it does not send
+            void Add(const std::string& instanceId)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(locker_);
+
+                    if (!pTransport_)
+                        return;
+
+                    instanceIds_.push_back(instanceId);
+
+                    if (instanceIds_.size() < batch_  ||  sending_)
+                        return;
+
+                    sending_ = true;
+                }
+
+                auto pState = this->shared_from_this();
+
+                pSenders_->Run([pState] { pState->Send(); });
+            }
+
+            void Flush()
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                cv_.wait(lock, [this] { return !sending_; });
+
+                if (!pTransport_  ||  instanceIds_.empty())
+                    return;
+
+                sending_ = true;
+
+                lock.unlock();
+
+                Send();
+            }
+
+            // Sends pending deletes without the lock, by the thread which set 'sending_'. Deletes which fail to be sent are dropped.
+            void Send()
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                while (!instanceIds_.empty())
+                {
+                    std::vector<std::string> instanceIds;
+                    instanceIds.swap(instanceIds_);
+
+                    lock.unlock();
+
+                    try
+                    {
+                        (*pTransport_)(DeleteInstances(instanceIds));
+                    }
+                    catch (const std::exception&)
+                    {
+                    }
+
+                    lock.lock();
+                }
+
+                sending_ = false;
+
+                cv_.notify_all();
+            }
+
+            const T* pTransport_;
+            size_t batch_;
+            CallbackSenders* pSenders_;
+            std::vector<std::string> instanceIds_;
+
+            // Deletes are being sent (or the sending is scheduled)
+            bool sending_ = false;
+
+            mutable std::mutex locker_;
+            std::condition_variable cv_;
+        };
+
+        std::shared_ptr<State> pState_;
+    };
+}
@@ -0,0 +1,192 @@
+// ResponseCache - server cache of replies of calls with idempotency key: retried call is not executed again, 
+// the stored reply is returned, concurrent duplicates wait for the first execution (without blocking a thread). 
+// Keys are scoped by client id and call name.
+
+#pragma once
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <string>
+#include <tuple>
+#include <chrono>
+#include <functional>
+
+namespace RemoteCall
+{
+    struct ResponseCache
+    {
+        typedef std::function<void(std::vector<char>&& vOut)> Reply;
+
+        // Calls 'execute(done)' once for 'key' of call 'name' of the client while its reply is stored. The call passes its reply 
+        // to 'done' (when the handler returns, or later), it is stored and passed to 'complete'. Stored reply completes retried call.
+        // Concurrent duplicates are completed by the reply of the first execution, or executed again if it is not stored 
+        // ('store' returns false for reply which should not be stored).
+        template <typename E, typename S>
+        void Process(const std::string& clientId, const std::string& name, const std::string& idempotencyKey, E execute, S store, Reply complete)
+        {
+            Key key(clientId, name, idempotencyKey);
+
+            std::shared_ptr<Entry> pEntry;
+            std::vector<char> reply;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                auto it = mapKeyEntry_.find(key);
+                if (it != mapKeyEntry_.end()  &&  !(it->second->done_  &&  it->second->expires_ <= std::chrono::steady_clock::now()))
+                {
+                    if (!it->second->done_)
+                    {
+                        it->second->waiters_.push_back(Waiter{ complete, [=]() { Process(clientId, name, idempotencyKey, execute, store, complete); } });
+                        return;
+                    }
+
+                    reply = it->second->reply_;
+                }
+                else
+                {
+                    pEntry = std::make_shared<Entry>();
+                    mapKeyEntry_[key] = pEntry;
+                }
+            }
+
+            if (!pEntry)
+            {
+                complete(std::move(reply));
+                return;
+            }
+
+            auto pDone = std::make_shared<bool>(false);
+
+            try
+            {
+                execute([this, key, pEntry, pDone, store, complete](std::vector<char>&& vOut)
+                {
+                    *pDone = true;
+
+                    bool stored = store(vOut);
+                    if (stored)
+                    {
+                        pEntry->reply_ = vOut;
+                    }
+
+                    auto waiters = Complete(key, pEntry, stored);
+
+                    for (auto& el: waiters)
+                    {
+                        if (stored)
+                        {
+                            el.complete_(std::vector<char>(vOut));
+                        }
+                    }
+
+                    complete(std::move(vOut));
+
+                    for (auto& el: waiters)
+                    {
+                        if (!stored)
+                        {
+                            el.retry_();
+                        }
+                    }
+                });
+            }
+            catch (...)
+            {
+                if (!*pDone)
+                {
+                    for (auto& el: Complete(key, pEntry, false))
+                    {
+                        el.retry_();
+                    }
+                }
+
+                throw;
+            }
+        }
+
+        // Reply is stored during 'ttl', at most 'maxEntries' replies are stored
+        void SetLimits(std::chrono::milliseconds ttl, size_t maxEntries)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            ttl_ = ttl;
+            maxEntries_ = maxEntries;
+        }
+
+    private:
+        typedef std::tuple<std::string, std::string, std::string> Key;
+
+        // Duplicate waiting for the first execution
+        struct Waiter
+        {
+            Reply complete_;
+            std::function<void()> retry_;
+        };
+
+        struct Entry
+        {
+            std::vector<Waiter> waiters_;
+            std::vector<char> reply_;
+            std::chrono::steady_clock::time_point expires_;
+            bool done_ = false;
+        };
+
+        // Returns the waiters of the entry
+        std::vector<Waiter> Complete(const Key& key, const std::shared_ptr<Entry>& pEntry, bool stored)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto now = std::chrono::steady_clock::now();
+
+            pEntry->done_ = true;
+            pEntry->expires_ = now + ttl_;
+
+            auto it = mapKeyEntry_.find(key);
+            if (it != mapKeyEntry_.end()  &&  it->second == pEntry)
+            {
+                if (stored)
+                {
+                    order_.push_back(key);
+                }
+                else
+                {
+                    mapKeyEntry_.erase(it);
+                }
+            }
+
+            // Replies are stored in order of expiration
+            while (!order_.empty())
+            {
+                auto itFirst = mapKeyEntry_.find(order_.front());
+                if (itFirst != mapKeyEntry_.end()  &&  itFirst->second->done_)
+                {
+                    if (order_.size() <= maxEntries_  &&  itFirst->second->expires_ > now)
+                        break;
+
+                    mapKeyEntry_.erase(itFirst);
+                }
+
+                order_.pop_front();
+            }
+
+            std::vector<Waiter> waiters;
+            waiters.swap(pEntry->waiters_);
+
+            return waiters;
+        }
+
+        std::map<Key, std::shared_ptr<Entry>> mapKeyEntry_;
+        std::list<Key> order_;
+        std::chrono::milliseconds ttl_ = std::chrono::minutes(1);
+        size_t maxEntries_ = 10000;
+        std::mutex locker_;
+    };
+
+    inline ResponseCache* GetResponseCache()
+    {
+        static ResponseCache s_responseCache; return &s_responseCache;
+    }
+}
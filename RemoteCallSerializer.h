@@ -4,13 +4,26 @@
 
 #include "RemoteCallUtils.h"
 #include "RemoteCallInterface.h"
+#include "RemoteCallException.h"
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <memory.h>
+#include <cstring>
 #include <algorithm>
 #include <iterator>
 
+#ifdef _WIN32
+    struct iovec
+    {
+        void* iov_base;
+        size_t iov_len;
+    };
+#else
+    #include <sys/uio.h>
+#endif
+
 namespace RemoteCall
 {
     // Serializer
@@ -26,21 +39,28 @@ namespace RemoteCall
         {
             readPos_ = 0;
             v_ = v;
+            segments_.clear();
+            prefixSize_ = 0;
         }
 
+        void operator = (std::vector<char>&& v)
+        {
+            readPos_ = 0;
+            v_ = std::move(v);
+            segments_.clear();
+            prefixSize_ = 0;
+        }
+
+        // Reads are checked against the remaining size, truncated or corrupted data throws InvalidFrame
         template <typename T>
         void Read(T& t)
         {
             static_assert(!std::is_pointer<T>::value, "Parameter cannot be pointer");
             static_assert(!std::is_class<T>::value, "Parameter cannot be class");
 
-	    char data[sizeof(T)];
-            for (size_t i = 0; i < sizeof(T); i++) 
-            {
-                data[i] = v_[readPos_ + i];
-            }
+            Require(sizeof(T));
 
-	    memcpy((void*)&t, data, sizeof(T));
+            memcpy((void*)&t, v_.data() + readPos_, sizeof(T));
 
             readPos_ += sizeof(T);
         }
@@ -54,26 +74,234 @@ namespace RemoteCall
 	    std::copy((char*)&t, (char*)&t + sizeof(T), back_inserter(v_));
         }
 
+        // Value written via Ref is referenced by the frame in gather mode instead of copied, it should be valid until the frame is sent.
+        //     transport(Store(RemoteCall::Serializer::Ref<std::string>{ data }));
+        template <typename T>
+        struct Ref
+        {
+            const T& t_;
+
+            operator const T& () const
+            {
+                return t_;
+            }
+        };
+
+        template <typename T>
+        void WriteRef(const T& t)
+        {
+            bool referenced = referenced_;
+            referenced_ = true;
+
+            *this << t;
+
+            referenced_ = referenced;
+        }
+
+        // Writes block of bytes. In gather mode blocks of at least 'gatherThreshold' bytes written via Ref are not copied, 
+        // they are referenced in place. Other blocks are copied, the caller's data can be destroyed before the frame is sent.
+        void WriteBytes(const void* p, size_t size)
+        {
+            if (referenced_  &&  gatherThreshold_  &&  size >= gatherThreshold_)
+            {
+                segments_.push_back(Segment{ v_.size(), (const char*)p, size });
+                return;
+            }
+
+            v_.insert(v_.end(), (const char*)p, (const char*)p + size);
+        }
+
+        // Appends 'size' zero bytes and returns them, they are valid until the next write
+        char* Reserve(size_t size)
+        {
+            auto pos = v_.size();
+            v_.resize(pos + size);
+
+            return v_.data() + pos;
+        }
+
+        // Overwrites serialized data at 'pos' (for instance length of the frame which is known when it is written)
+        template <typename T>
+        void WriteAt(size_t pos, const T& t)
+        {
+            memcpy(v_.data() + pos, &t, sizeof(T));
+        }
+
+        void ReadBytes(void* p, size_t size)
+        {
+            // Data of an empty vector may be null
+            if (!size)
+                return;
+
+            Require(size);
+
+            memcpy(p, v_.data() + readPos_, size);
+
+            readPos_ += size;
+        }
+
+        // Unread data, it is consumed by Skip
+        const char* ReadData() const
+        {
+            return v_.data() + readPos_;
+        }
+
+        size_t Remaining() const
+        {
+            return v_.size() - readPos_;
+        }
+
+        void Skip(size_t size)
+        {
+            Require(size);
+
+            readPos_ += size;
+        }
+
+        void Require(size_t size) const
+        {
+            if (size > Remaining())
+                throw Exception(Exception::InvalidFrame, "Frame is truncated.");
+        }
+
+        // Enables gather mode (0 disables it)
+        void SetGatherThreshold(size_t gatherThreshold)
+        {
+            gatherThreshold_ = gatherThreshold;
+        }
+
+        // Returns frame as iovecs: serialized data interleaved with referenced blocks
+        void Gather(std::vector<iovec>& iov) const
+        {
+            iov.clear();
+
+            size_t pos = 0;
+            for (auto& segment: segments_)
+            {
+                if (segment.offset > pos)
+                {
+                    iov.push_back(iovec{ (void*)(v_.data() + pos), segment.offset - pos });
+                }
+
+                iov.push_back(iovec{ (void*)segment.p, segment.size });
+
+                pos = segment.offset;
+            }
+
+            if (v_.size() > pos)
+            {
+                iov.push_back(iovec{ (void*)(v_.data() + pos), v_.size() - pos });
+            }
+        }
+
         operator std::vector<char>()
         {
-            return v_;
+            if (segments_.empty())
+                return v_;
+
+            std::vector<iovec> iov;
+            Gather(iov);
+
+            std::vector<char> v;
+            for (auto& el: iov)
+            {
+                v.insert(v.end(), (const char*)el.iov_base, (const char*)el.iov_base + el.iov_len);
+            }
+
+            return v;
         }
 
+        // Keeps the reserved prefix
         void clear()
         {
-            v_.clear();
+            v_.resize(prefixSize_);
+            segments_.clear();
+        }
+
+        // First 'size' bytes are reserved for prefixes of the reply written when it is complete (correlation id, checksum)
+        void ReservePrefix(size_t size)
+        {
+            if (v_.size() < size)
+            {
+                v_.resize(size);
+            }
+
+            prefixSize_ = size;
+        }
+
+        size_t PrefixSize() const
+        {
+            return prefixSize_;
         }
 
         char GetCurrent()
         {
+            Require(1);
+
             return v_[readPos_];
         }
+
+        // Serialized data (without blocks referenced in gather mode)
+        const char* Data() const
+        {
+            return v_.data();
+        }
+
+        size_t Size() const
+        {
+            return v_.size();
+        }
+
+        // Size including blocks referenced in gather mode
+        size_t TotalSize() const
+        {
+            size_t size = v_.size();
+            for (auto& segment: segments_)
+            {
+                size += segment.size;
+            }
+
+            return size;
+        }
+
+        void Truncate(size_t size)
+        {
+            v_.resize(size);
+        }
+
+        size_t ReadPosition() const
+        {
+            return readPos_;
+        }
+
+        void Seek(size_t readPos)
+        {
+            readPos_ = std::min(readPos, v_.size());
+        }
     private:
-        int readPos_ = 0;
+        // Block referenced in gather mode, it follows 'offset' bytes of serialized data
+        struct Segment
+        {
+            size_t offset;
+            const char* p;
+            size_t size;
+        };
+
+        size_t readPos_ = 0;
         std::vector<char> v_;
+        size_t gatherThreshold_ = 0;
+        bool referenced_ = false;
+        std::vector<Segment> segments_;
+        size_t prefixSize_ = 0;
     };
 
 
+    // Declared before the templates which write and read them as elements
+    template <typename Traits, typename A> Serializer& operator << (Serializer& writer, const std::basic_string<char, Traits, A>& str);
+    template <typename Traits, typename A> Serializer& operator >> (Serializer& reader, std::basic_string<char, Traits, A>& str);
+    Serializer& operator << (Serializer& writer, const char* s);
+
+
     // Built-in types
     template <typename T>
     Serializer& operator << (Serializer& writer, const T& t)
@@ -92,6 +320,15 @@ namespace RemoteCall
     }
 
 
+    template <typename T>
+    Serializer& operator << (Serializer& writer, const Serializer::Ref<T>& ref)
+    {
+        writer.WriteRef(ref.t_);
+
+        return writer;
+    }
+
+
     // RemoteInterface*
     template <typename T>
     Serializer& operator << (Serializer& writer, T* pT)
@@ -127,82 +364,130 @@ namespace RemoteCall
         }
         else
         {
-            pT = (T*)new RemoteInterface;
-
-            pT->instanceId_ = instanceId;
+            pT = (T*)GetProxies()->Acquire(instanceId);
         }
 
         return reader;
     }
 
 
-    // string
-    inline Serializer& operator << (Serializer& writer, const std::string& str)
+    // Element read into container is created with its allocator if it uses one (elements of std::pmr container use its memory resource)
+    template <typename T, typename A, bool = std::uses_allocator<T, A>::value>
+    struct Element
     {
-        for (auto& c : str) 
+        static T Create(const A&)
         {
-            writer.Write(c);
+            return T();
         }
+    };
+
+    template <typename T, typename A>
+    struct Element<T, A, true>
+    {
+        static T Create(const A& allocator)
+        {
+            return T(allocator);
+        }
+    };
+
+
+    // string (std::string, std::pmr::string)
+    template <typename Traits, typename A>
+    Serializer& operator << (Serializer& writer, const std::basic_string<char, Traits, A>& str)
+    {
+        writer.WriteBytes(str.data(), str.size());
         writer.Write('\0');
 
         return writer;
     }
 
-    inline Serializer& operator >> (Serializer& reader, std::string& str)
+    template <typename Traits, typename A>
+    Serializer& operator >> (Serializer& reader, std::basic_string<char, Traits, A>& str)
     {
-        str.clear();
+        auto p = reader.ReadData();
 
-        char c;
-        while (true) 
-        {
-            reader.Read(c);
-            if (!c)
-                break;
+        auto pEnd = (const char*)memchr(p, 0, reader.Remaining());
+        if (!pEnd)
+            throw Exception(Exception::InvalidFrame, "String is not terminated.");
 
-            str.push_back(c);
-        }
+        str.assign(p, pEnd);
+        reader.Skip(pEnd - p + 1);
 
         return reader;
     }
 
 
     // vector
-    template<typename T>
-    Serializer& operator << (Serializer& writer, const std::vector<T>& v)
+    template <typename T, typename A, bool bytes = std::is_arithmetic<T>::value  &&  !std::is_same<T, bool>::value>
+    struct VectorElements
     {
-        writer << v.size();
+        static void Write(Serializer& writer, const std::vector<T, A>& v)
+        {
+            for (auto& t : v) 
+            {
+                writer << t;
+            }
+        }
 
-        for (auto& t : v) 
+        static void Read(Serializer& reader, std::vector<T, A>& v, size_t size)
         {
-            writer << t;
+            for (size_t i = 0; i < size; i++) 
+            {
+                T t = Element<T, A>::Create(v.get_allocator());
+                reader >> t;
+
+                v.push_back(std::move(t));
+            }
         }
+    };
+
+    // Elements of arithmetic type are written as one block
+    template <typename T, typename A>
+    struct VectorElements<T, A, true>
+    {
+        static void Write(Serializer& writer, const std::vector<T, A>& v)
+        {
+            writer.WriteBytes(v.data(), v.size() * sizeof(T));
+        }
+
+        static void Read(Serializer& reader, std::vector<T, A>& v, size_t size)
+        {
+            // Size is checked before it is allocated
+            if (size > reader.Remaining() / sizeof(T))
+                throw Exception(Exception::InvalidFrame, "Vector is truncated.");
+
+            v.resize(size);
+            reader.ReadBytes(v.data(), size * sizeof(T));
+        }
+    };
+
+    template<typename T, typename A>
+    Serializer& operator << (Serializer& writer, const std::vector<T, A>& v)
+    {
+        writer << v.size();
+
+        VectorElements<T, A>::Write(writer, v);
 
         return writer;
     }
 
-    template<typename T>
-    Serializer& operator >> (Serializer& reader, std::vector<T>& v)
+    template<typename T, typename A>
+    Serializer& operator >> (Serializer& reader, std::vector<T, A>& v)
     {
         v.clear();
 
         size_t size;
         reader >> size;
 
-        for (size_t i = 0; i < size; i++) 
-        {
-            T t;
-            reader >> t;
-
-            v.push_back(t);
-        }
+        VectorElements<T, A>::Read(reader, v, size);
 
         return reader;
     }
 
 
     // map
-    template<typename TKey, typename TValue>
-    Serializer& operator << (Serializer& writer, const std::map<TKey, TValue>& m)
+    template<typename TKey, typename TValue, typename C, typename A>
+    Serializer& operator << (Serializer& writer, const std::map<TKey, TValue, C, A>& m)
     {
         writer << m.size();
 
@@ -214,8 +499,8 @@ namespace RemoteCall
         return writer;
     }
 
-    template<typename TKey, typename TValue>
-    Serializer& operator >> (Serializer& reader, std::map<TKey, TValue>& m)
+    template<typename TKey, typename TValue, typename C, typename A>
+    Serializer& operator >> (Serializer& reader, std::map<TKey, TValue, C, A>& m)
     {
         m.clear();
 
@@ -224,13 +509,13 @@ namespace RemoteCall
 
         for (size_t i = 0; i < size; i++) 
         {
-            TKey key;
+            TKey key = Element<TKey, A>::Create(m.get_allocator());
             reader >> key;
 
-            TValue value;
+            TValue value = Element<TValue, A>::Create(m.get_allocator());
             reader >> value;
 
-            m.insert(std::make_pair(key, value));
+            m.emplace(std::move(key), std::move(value));
         }
 
         return reader;
@@ -243,11 +528,7 @@ namespace RemoteCall
         if (!s)
             return writer;
 
-        while (*s) 
-        {
-            writer.Write(*s);
-            s++;
-        }
+        writer.WriteBytes(s, strlen(s));
         writer.Write('\0');
 
         return writer;
@@ -301,4 +582,33 @@ namespace RemoteCall
 
         return reader;
     }
+
+
+    // Exception
+    inline Serializer& operator << (Serializer& writer, const Exception& e)
+    {
+        return writer << (int)e.Error() << e.what();
+    }
+
+    inline Serializer& operator >> (Serializer& reader, Exception& e)
+    {
+        std::string what;
+        int err;
+        reader >> err >> what;
+
+        e = Exception(err, what);
+
+        return reader;
+    }
+
+
+    // StreamSource - produces items of a stream (Stream on server, InputStream on client) chunk by chunk
+    struct StreamSource
+    {
+        virtual ~StreamSource() {}
+
+        // Writes up to 'credits' items and end flag, returns true if the stream ended.
+        // Written items are valid until the next chunk, so they can be referenced by the frame in gather mode.
+        virtual bool WriteChunk(Serializer& writer, size_t credits) = 0;
+    };
 }
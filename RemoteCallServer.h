@@ -4,17 +4,43 @@
 #include "RemoteCallSerializer.h"
 #include "RemoteCallInterface.h"
 #include "RemoteCallException.h"
+#include "RemoteCallFrame.h"
+#include "RemoteCallDelta.h"
+#include "RemoteCallCache.h"
+#include "RemoteCallResponseCache.h"
+#include "RemoteCallCancellation.h"
+#include "RemoteCallAdmission.h"
+#include "RemoteCallAsync.h"
+#include "RemoteCallArena.h"
+#include "RemoteCallSession.h"
+#include "RemoteCallCompression.h"
+#include "RemoteCallChecksum.h"
+#include "RemoteCallNative.h"
+#include "RemoteCallPack.h"
 
 #include <map>
 #include <set>
-#include <cctype>
 #include <mutex> 
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <deque>
+#include <functional>
+#include <condition_variable>
+#include <future>
 
 namespace RemoteCall
 {
     struct Caller
     {
-        virtual void Call(const std::string& clientId, Serializer& writer, Serializer& reader) = 0;
+        virtual void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) = 0;
+
+        // True if call should run in its own thread (it has InputStream parameter)
+        virtual bool Detached() const
+        {
+            return false;
+        }
     };
 
     struct Callers
@@ -93,8 +119,9 @@ namespace RemoteCall
                 }
             }
 
+            // Method callers of pooled instance are kept for its reuse
             auto it = mapInterfaceMethodCallers_.find(pInterface);
-            if (it != mapInterfaceMethodCallers_.end())
+            if (it != mapInterfaceMethodCallers_.end()  &&  !pInterface->pPool_)
             {
                 mapInterfaceMethodCallers_.erase(it);
             }
@@ -112,7 +139,11 @@ namespace RemoteCall
 
             auto pInterface = it->second;
 
-            mapInterfaceMethodCallers_.erase(mapInterfaceMethodCallers_.find(pInterface));
+            if (!pInterface->pPool_)
+            {
+                mapInterfaceMethodCallers_.erase(mapInterfaceMethodCallers_.find(pInterface));
+            }
+
             mapInstancedIdInterface_.erase(it);
 
             return pInterface;
@@ -148,6 +179,18 @@ namespace RemoteCall
 	    it->second.insert(pInterface);
 	}
 
+	// Instance deleted by the client (pooled instance can be reused for another client)
+	void Remove(const std::string& clientId, RemoteInterface* pInterface)
+	{
+	    std::lock_guard<std::recursive_mutex> lock(locker_);
+
+	    auto it = mapClientIdInterface_.find(clientId);
+	    if (mapClientIdInterface_.end() != it)
+	    {
+	        it->second.erase(pInterface);
+	    }
+	}
+
 	std::vector<RemoteInterface*> Clear(const std::string& clientId)
 	{
 	    std::lock_guard<std::recursive_mutex> lock(locker_);
@@ -204,28 +247,11 @@ namespace RemoteCall
         static ClientClassInstances s_clientClassInstances; return &s_clientClassInstances; 
     }
 
-    // ServerCallProcessor
-    template <typename Ret, typename ...DeclArgs> struct ServerCallProcessor;
-
-    template <typename Ret, typename DeclArg, typename ...DeclArgs>
-    struct ServerCallProcessor<Ret, DeclArg, DeclArgs...>
-    {
-        template <typename Caller, typename ...CallArgs>
-        static void Call(const std::string& clientId, Caller* pCaller, Serializer& writer, Serializer& reader, CallArgs&...callArgs)
-        {
-	    auto t = typename std::remove_const<typename std::remove_reference<DeclArg>::type>::type();
-
-            reader >> t;
-
-            ServerCallProcessor<Ret, DeclArgs...>::Call(clientId, pCaller, writer, reader, callArgs..., t);
+    // Called for each argument after it is read, 'out' is true for non-const reference parameter.
+    // Overloaded for parameter types which need to know how they are used (for instance SharedBlob is mapped read-only or read-write).
+    template <typename T>
+    inline void PrepareParam(T&, bool) {}
 
-            // If out parameter
-            if (std::is_lvalue_reference<DeclArg>::value  &&  !std::is_const<typename std::remove_reference<DeclArg>::type>::value) 
-            {
-                writer << t;
-            }
-        }
-    };
 
     template <typename T>
     struct StoreRemoteInterface
@@ -249,245 +275,1707 @@ namespace RemoteCall
     };
 
 
-    template <typename Ret> struct ServerCallProcessor<Ret>
+    // ServerCallReturn - calls the handler with read arguments and writes its result
+    template <typename Ret> struct ServerCallReturn
     {
         template <typename Caller, typename ...CallArgs>
-        static void Call(const std::string& clientId, Caller* pCaller, Serializer& writer, Serializer& reader, CallArgs&...args)
+        static void Call(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer&, CallArgs&...args)
         {
 	    auto ret = pCaller->template Call<Ret>(args...);
 
-	    StoreRemoteInterface<Ret>::Store(clientId, ret);
+	    StoreRemoteInterface<Ret>::Store(header.clientId_, ret);
 
             writer << ret;
         }
     };
 
-    template <> struct ServerCallProcessor<void>
+    // AsyncReply - reply of handler which returned Async not completed yet, it is sent when the result is ready.
+    // Set for the call processed by this thread if its reply can be completed later, otherwise the handler result is waited for.
+    struct AsyncReply
     {
-        template <typename Caller, typename ...CallArgs>
-        static void Call(const std::string& clientId, Caller* pCaller, Serializer& writer, Serializer& reader, CallArgs&...args)
+        // Registers function called when the result is ready
+        std::function<void(std::function<void()>)> then_;
+
+        // Writes the result, or throws exception of the handler
+        std::function<void(Serializer&)> write_;
+
+        std::string name_;
+
+        static AsyncReply*& Current()
         {
-            pCaller->template Call<void>(args...);
+            thread_local AsyncReply* t_pReply = nullptr; return t_pReply;
         }
     };
 
-
-    // FunctionCaller
-    template <typename F>
-    struct FunctionCaller: public Caller
+    struct AsyncReplyScope
     {
-        FunctionCaller(F f)
-            :f_(f)
-        {}
-
-        template <typename Ret, typename ...Args>
-        Ret Call(Args&...args)
+        AsyncReplyScope(AsyncReply* pReply)
+            : pPrevious_(AsyncReply::Current())
         {
-            return (*f_)(args...);
+            AsyncReply::Current() = pReply;
         }
 
-        void Call(const std::string& clientId, Serializer& writer, Serializer& reader) override
+        ~AsyncReplyScope()
         {
-            Call(clientId, f_, writer, reader);
+            AsyncReply::Current() = pPrevious_;
         }
 
-        template <typename Ret, typename ...Args>
-        void Call(const std::string& clientId, Ret(*f)(Args...), Serializer& writer, Serializer& reader)
+    private:
+        AsyncReply* pPrevious_;
+    };
+
+    template <typename T> struct ServerCallReturn<Async<T>>
+    {
+        template <typename Caller, typename ...CallArgs>
+        static void Call(const FrameHeader&, Caller* pCaller, Serializer& writer, Serializer&, CallArgs&...args)
         {
-            ServerCallProcessor<Ret, Args...>::Call(clientId, this, writer, reader);
+            // Returned Async is not kept, so the state is rejected if the handler destroyed all its copies without completing it
+            auto pState = pCaller->template Call<Async<T>>(args...).GetState();
+
+            auto pReply = AsyncReply::Current();
+            if (!pReply  ||  pState->Ready())
+            {
+                writer << *pState;
+                return;
+            }
+
+            pReply->then_ = [pState](std::function<void()> f) { pState->Then(std::move(f)); };
+
+            // Continuation which writes the reply is stored in the state, it does not keep the state
+            std::weak_ptr<typename decltype(pState)::element_type> pWeak = pState;
+            pReply->write_ = [pWeak](Serializer& writer) 
+            { 
+                auto pState = pWeak.lock();
+                if (!pState)
+                    throw Exception(Exception::ServerError, "Async is destroyed before it is completed.");
+
+                writer << *pState; 
+            };
         }
+    };
 
-    private:
-        F f_;
+    template <> struct ServerCallReturn<void>
+    {
+        template <typename Caller, typename ...CallArgs>
+        static void Call(const FrameHeader&, Caller* pCaller, Serializer&, Serializer&, CallArgs&...args)
+        {
+            pCaller->template Call<void>(args...);
+        }
     };
 
-    inline Callers* FunctionCallers()
+
+    // Argument in the fixed prefix of the pack is copied from 'p', other arguments are read after the prefix
+    template <bool fixed>
+    struct PackArgReader
     {
-        static Callers s_functionCallers; return &s_functionCallers;
-    }
+        template <typename T>
+        static void ReadFixed(const char* p, T& t)
+        {
+            memcpy(&t, p, sizeof(T));
+        }
 
-    template <typename F>
-    bool RegisterFunc(const std::string& name, F f)
+        template <typename T>
+        static void Read(Serializer&, T&, size_t&) {}
+    };
+
+    template <>
+    struct PackArgReader<false>
     {
-        FunctionCallers()->AddCaller(name, new FunctionCaller<F>(f));
+        template <typename T>
+        static void ReadFixed(const char*, T&) {}
 
-        return true;
-    }
+        template <typename T>
+        static void Read(Serializer& reader, T& t, size_t& position)
+        {
+            position = reader.ReadPosition();
+            reader >> t;
+        }
+    };
 
-    inline std::vector<char> ProcessFunctionCall(const std::string& clientId, Serializer& reader)
+    // ServerCallProcessor - reads all arguments of the declared signature in one function (the fixed prefix is checked and copied as one block),
+    // calls the handler and writes out parameters
+    template <typename Ret, typename ...DeclArgs>
+    struct ServerCallProcessor
     {
-        std::string func;
-        reader >> func;
+        static_assert(!Pack<DeclArgs...>::AnyOut()  ||  !IsAsync<Ret>::value, "Handler returning Async cannot have out parameters");
 
-        Serializer writer;
+        template <typename Caller>
+        static void Call(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer& reader)
+        {
+            Call(header, pCaller, writer, reader, std::index_sequence_for<DeclArgs...>());
+        }
 
-        auto pFunctionCaller = FunctionCallers()->GetCaller(func);
+    private:
+        using P = Pack<DeclArgs...>;
 
-        if (pFunctionCaller)
+        template <typename Caller, size_t ...I>
+        static void Call(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer& reader, std::index_sequence<I...>)
         {
-            try 
-            {
-                writer << NoException();
+            CallParams<typename PackArg<DeclArgs>::Type...> params;
+
+            // Positions of the arguments in the frame, delta of out parameter is computed from its original
+            size_t positions[sizeof...(DeclArgs) + 1];
+            positions[0] = reader.ReadPosition();
+
+            reader.Require(P::FixedSize());
+            auto p = reader.ReadData();
+
+            int fixed[] = { 0, (positions[I] = positions[0] + P::FixedOffset(I), PackArgReader<(I < P::FixedCount())>::ReadFixed(p + P::FixedOffset(I), std::get<I>(params)), 0)... };
+            reader.Skip(P::FixedSize());
+
+            int other[] = { 0, (PackArgReader<(I < P::FixedCount())>::Read(reader, std::get<I>(params), positions[I]), 0)... };
+            positions[sizeof...(DeclArgs)] = reader.ReadPosition();
+
+            int prepared[] = { 0, (PrepareParam(std::get<I>(params), PackArg<DeclArgs>::out), 0)... };
+            (void)fixed; (void)other; (void)prepared; (void)p; (void)positions;
 
-                pFunctionCaller->Call(clientId, writer, reader);
+            ServerCallReturn<Ret>::Call(header, pCaller, writer, reader, std::get<I>(params)...);
+
+            // Out parameters follow the result in reverse order
+            int written[] = { 0, (WriteOut<sizeof...(DeclArgs) - 1 - I>(header, writer, reader, params, positions), 0)... };
+            (void)written;
+        }
+
+        template <size_t i, typename Params>
+        static void WriteOut(const FrameHeader& header, Serializer& writer, Serializer& reader, Params& params, const size_t* positions)
+        {
+            if (!P::template Arg<i>::out)
+                return;
+
+            auto& t = std::get<i>(params);
+
+            if (header.flags_ & DeltaReplies)
+            {
+                ParamDelta<typename P::template Arg<i>::Type>::Write(writer, t, reader, positions[i], positions[i + 1]);
             }
-            catch (const std::exception& e) 
+            else
             {
-                writer.clear();
-
-                writer << Exception(Exception::ServerError, ToString() << "Server exception in " << func << " \"" << e.what() << "\".");
+                writer << t;
             }
         }
+    };
+
+
+    // NativeCallProcessor - passes arguments of the native block to the handler in place, the result is written as usual
+    template <bool native, typename Ret, typename ...DeclArgs>
+    struct NativeCallProcessor
+    {
+        template <typename Caller>
+        static void Call(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer& reader)
+        {
+            Call(header, pCaller, writer, reader, std::index_sequence_for<DeclArgs...>());
+        }
+
+    private:
+        template <typename Caller, size_t ...I>
+        static void Call(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer& reader, std::index_sequence<I...>)
+        {
+            using NPack = NativePack<DeclArgs...>;
+
+            std::vector<char> copy;
+            auto p = ReadNativeBlock(reader, NPack::Size(), NPack::Alignment(), copy);
+
+            ServerCallReturn<Ret>::Call(header, pCaller, writer, reader, *(typename NativeArg<DeclArgs>::Type*)(p + NPack::Offset(I))...);
+        }
+    };
+
+    template <typename Ret, typename ...DeclArgs>
+    struct NativeCallProcessor<false, Ret, DeclArgs...>
+    {
+        template <typename Caller>
+        static void Call(const FrameHeader&, Caller*, Serializer&, Serializer&)
+        {
+            throw Exception(Exception::InvalidFrame, "Parameters cannot be native.");
+        }
+    };
+
+    template <typename Ret, typename ...Args, typename Caller>
+    inline void ProcessCallArgs(const FrameHeader& header, Caller* pCaller, Serializer& writer, Serializer& reader)
+    {
+        if (header.flags_ & NativeArgs)
+        {
+            NativeCallProcessor<NativePack<Args...>::value, Ret, Args...>::Call(header, pCaller, writer, reader);
+        }
         else
         {
-            writer << Exception(Exception::InvalidFunction, ToString() << "Function " << func << " is not implemented.");
+            ServerCallProcessor<Ret, Args...>::Call(header, pCaller, writer, reader);
         }
+    }
 
-        return writer;
+
+    template <typename Ret, typename ...Args>
+    inline constexpr bool HasChunkedParam(Ret(*)(Args...))
+    {
+        return AnyChunkedParam<Args...>::value;
+    }
+
+    template <typename C, typename Ret, typename ...Args>
+    inline constexpr bool HasChunkedParam(Ret(C::*)(Args...))
+    {
+        return AnyChunkedParam<Args...>::value;
     }
 
 
-    // MethodCaller
-    template <typename C, typename M>
-    struct MethodCaller : public Caller
+    // FunctionCaller
+    template <typename F>
+    struct FunctionCaller: public Caller
     {
-        MethodCaller(C* pC, M m)
-            :pC_(pC), m_(m)
-        {};
+        FunctionCaller(F f)
+            :f_(f)
+        {}
 
         template <typename Ret, typename ...Args>
         Ret Call(Args&...args)
         {
-	    struct AutoCounter
-	    {
-	        RemoteInterface* pInterface_;
-
-	        AutoCounter(RemoteInterface* pInterface)
-		    : pInterface_(pInterface)
-		{
-		    pInterface_->IncCounter();
-		}
-
-		~AutoCounter()
-		{
-		    pInterface_->DecCounter();
-		}
-	    };
-
-	    AutoCounter autoCounter(pC_);
+            return (*f_)(args...);
+        }
 
-	    return ((*pC_).*(m_))(args...);
+        void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) override
+        {
+            Call(header, f_, writer, reader);
         }
 
-        void Call(const std::string& clientId, Serializer& writer, Serializer& reader) override
+        bool Detached() const override
         {
-            Call(clientId, pC_, m_, writer, reader);
-        };
+            return HasChunkedParam(f_);
+        }
 
-        template <typename C, typename Ret, typename ...Args>
-        void Call(const std::string& clientId, C* pC, Ret(C::*)(Args...), Serializer& writer, Serializer& reader)
+        template <typename Ret, typename ...Args>
+        void Call(const FrameHeader& header, Ret(*)(Args...), Serializer& writer, Serializer& reader)
         {
-            ServerCallProcessor<Ret, Args...>::Call(clientId, this, writer, reader);
+            ProcessCallArgs<Ret, Args...>(header, this, writer, reader);
         }
 
     private:
-        C* pC_;
-        M m_;
+        F f_;
     };
 
-    template <typename C, typename M>
-    bool RegisterMethod(C* pC, const std::string& method, M m)
+    // Client function called by server to invalidate cached results
+    struct InvalidateCacheCaller: public Caller
     {
-        GetClassInstances()->AddMethodCaller(pC, method, new MethodCaller<C, M>(pC, m));
+        void Call(const FrameHeader&, Serializer&, Serializer& reader) override
+        {
+            std::string function;
+            reader >> function;
 
-        return true;
-    }
+            auto pCache = ResultCache::Current();
+            if (!pCache)
+                throw Exception(Exception::ServerError, "~InvalidateCache is not received by transport.ProcessCallback.");
 
+            pCache->Invalidate(function);
+        }
+    };
 
-    inline std::vector<char> ProcessClassCall(const std::string& clientId, Serializer& reader)
+    // Returns node tag of server instances, client transport over several servers finds server of an instance by it
+    struct NodeTagCaller: public Caller
     {
-        Serializer writer;
-
-        std::string instanceId;
-        reader >> instanceId;
+        void Call(const FrameHeader&, Serializer& writer, Serializer&) override
+        {
+            writer << GetNodeTag();
+        }
+    };
 
-        if ('~' == reader.GetCurrent())
+    // Cancels calls of the client with the cancel id (running, and received later during a minute or until the deadline of '~Cancel')
+    struct CancelCaller: public Caller
+    {
+        void Call(const FrameHeader& header, Serializer&, Serializer& reader) override
         {
-            auto pInterface = GetClassInstances()->RemoveInterface(instanceId);
-            if (pInterface)
-            {
-                writer << NoException();
+            std::string cancelId;
+            reader >> cancelId;
 
-                delete pInterface;
-            }
-            else
-            {
-                writer << Exception(Exception::InvalidClassInstance, ToString() << "Invalid class instance " << instanceId << '.');
-            }
+            GetCancellations()->Cancel(header.clientId_, cancelId, header.deadline_);
         }
-        else
+    };
+
+    // Deletes instances released by clients (sent in batches by RemoteDeletes)
+    struct DeleteCaller: public Caller
+    {
+        void Call(const FrameHeader& header, Serializer&, Serializer& reader) override
         {
-            do
+            std::vector<std::string> instanceIds;
+            reader >> instanceIds;
+
+            for (auto& instanceId: instanceIds)
             {
-                auto pMethodCallers = GetClassInstances()->GeMethodCallers(instanceId);
-                if (!pMethodCallers)
+                auto pInterface = GetClassInstances()->RemoveInterface(instanceId);
+                if (pInterface)
                 {
-                    writer << Exception(Exception::InvalidClassInstance, ToString() << "Invalid class instance " << instanceId << '.');
-                    break;
-                }
+                    GetClientClassInstances()->Remove(header.clientId_, pInterface);
 
-                std::string method;
-                reader >> method;
+                    pInterface->Dispose();
+                }
+            }
+        }
+    };
 
-                auto pMethodCaller = pMethodCallers->GetCaller(method);
-                if (!pMethodCaller)
+    // Opens session of the client, frames of the session carry its id instead of the client id.
+    // Replies with the session id and the first codec of the client which is known (replies of the session are compressed by it).
+    struct SessionCaller: public Caller
+    {
+        void Call(const FrameHeader&, Serializer& writer, Serializer& reader) override
+        {
+            std::string clientId;
+            std::vector<uint8_t> codecs;
+            uint32_t compressionThreshold;
+            uint64_t abi;
+            bool checksums;
+            reader >> clientId >> codecs >> compressionThreshold >> abi >> checksums;
+
+            uint8_t codec = NoCodec;
+            for (auto el: codecs)
+            {
+                if (GetCodecs()->Get(el))
                 {
-                    writer << "Method " << method << " is not implemented.";
+                    codec = el;
                     break;
                 }
+            }
 
-                try 
-                {
-                    writer << NoException();
-
-                    pMethodCaller->Call(clientId, writer, reader);
-                }
-                catch (const std::exception& e) 
-                {
-                    writer.clear();
+            bool native = NativeAbi() == abi;
 
-                    writer << Exception(Exception::ServerError, ToString() << "Exception in " << method << " \"" << e.what() << "\".");
-                }
-            } while (false);
+            writer << std::make_tuple(GetSessions()->Open(clientId, codec, compressionThreshold, native, checksums), codec, native);
         }
+    };
 
-        return writer;
-    }
-
-	
-    inline void ProcessCall(const std::vector<char>& vIn, std::vector<char>& vOut, bool (*clientRunning)(const std::string& clientId) = nullptr)
+    // Processes frames of several one-way calls sent in one frame by CallbackQueue. It is accepted only in frames which client
+    // processes by ProcessCallback, not inside other '~Batch'. Each call is admitted as if it was sent alone, call waiting 
+    // for admission does not block the thread, the next calls are processed after it by the thread which completes it.
+    struct BatchCaller: public Caller
     {
-	Serializer reader(vIn);
+        enum Direction
+        {
+            Request,        // frame received by server
+            Callback,       // frame received by client from server
+            Batched         // frame of '~Batch'
+        };
 
-        std::string clientId;
-        reader >> clientId;
+        // Direction of the frame processed by this thread, the previous one is restored when the scope ends
+        struct Scope
+        {
+            Scope(Direction direction)
+                : previous_(Current())
+            {
+                Current() = direction;
+            }
 
-	GetClientClassInstances()->Clear(clientRunning);
+            ~Scope()
+            {
+                Current() = previous_;
+            }
 
-        if (std::isdigit(reader.GetCurrent()))
-        {
-            vOut = ProcessClassCall(clientId, reader);
-        }
-        else
+        private:
+            Direction previous_;
+        };
+
+        static Direction& Current()
         {
-            vOut = ProcessFunctionCall(clientId, reader);
+            thread_local Direction t_direction = Request; return t_direction;
         }
-    }
 
-    inline void AddInterface(RemoteInterface* pInterface)
-    {
-        GetClassInstances()->AddInterface(pInterface);
-    }
+        inline void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) override;
+
+    private:
+        struct Batch
+        {
+            std::vector<std::vector<char>> frames_;
+            size_t next_ = 0;
+
+            // Cache of the transport which received the batch, the batch can be continued by another thread
+            ResultCache* pCache_ = nullptr;
+        };
+
+        inline static void Process(const std::shared_ptr<Batch>& pBatch);
+    };
+
+    // Writes handler exception which is sent to client as is (the call is cancelled, its deadline passed, its parameters are truncated,
+    // or server is overloaded), returns false for other exceptions
+    inline bool WriteCancellation(Serializer& writer, const std::exception& e)
+    {
+        auto pException = dynamic_cast<const Exception*>(&e);
+        if (!pException  ||  (Exception::Cancelled != pException->Error()  &&  Exception::DeadlineExceeded != pException->Error()  &&
+            Exception::InvalidFrame != pException->Error()  &&  Exception::Overloaded != pException->Error()))
+            return false;
+
+        writer << *pException;
+
+        return true;
+    }
+
+    // Defined after the registries whose internal calls it has
+    inline Callers* FunctionCallers();
+
+    template <typename F>
+    bool RegisterFunc(const std::string& name, F f)
+    {
+        FunctionCallers()->AddCaller(name, new FunctionCaller<F>(f));
+
+        return true;
+    }
+
+
+    // ChunkSink - receives chunks of parameter which is sent in several frames (InputStream on server)
+    struct ChunkSink
+    {
+        virtual ~ChunkSink() {}
+
+        // Reads chunk, returns true if no more chunks are expected
+        virtual bool Push(Serializer& reader) = 0;
+
+        // Calls 'f' when handler read enough chunks to receive the next one, or when sink is closed (at once if it is so)
+        virtual void WhenReady(std::function<void()> f) = 0;
+
+        // Releases waiting Next, 'cancelled' - next chunks will not be received
+        virtual void Close(bool cancelled) = 0;
+    };
+
+
+    // DetachedCall - call with InputStream parameter runs in its own thread, since its handler waits for chunks received in next frames
+    struct DetachedCall
+    {
+        DetachedCall(const std::string& name, const Serializer& writer, const Serializer& reader)
+            : name_(name), writer_(writer), reader_(reader), pToken_(CurrentToken())
+        {}
+
+        static DetachedCall*& Current()
+        {
+            thread_local DetachedCall* t_pCall = nullptr; return t_pCall;
+        }
+
+        // Called by InputStream if its first chunk (received in the call frame) is not the last one
+        void Suspend(const std::shared_ptr<ChunkSink>& pSink)
+        {
+            std::function<void()> then;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (pSink_)
+                    throw Exception(Exception::ServerError, "Only one InputStream parameter can be used.");
+
+                pSink_ = pSink;
+
+                if (thenSuspended_)
+                {
+                    then.swap(then_);
+                }
+            }
+
+            if (then)
+            {
+                then();
+            }
+        }
+
+        void Run(Caller* pCaller, const FrameHeader& header)
+        {
+            Current() = this;
+
+            try
+            {
+                CancellationScope scope(pToken_);
+                ClientIdScope clientIdScope(header.clientId_);
+
+                pCaller->Call(header, writer_, reader_);
+            }
+            catch (const std::exception& e)
+            {
+                writer_.clear();
+
+                if (!WriteCancellation(writer_, e))
+                {
+                    writer_ << Exception(Exception::ServerError, ToString() << "Server exception in " << name_ << " \"" << e.what() << "\".");
+                }
+            }
+
+            Current() = nullptr;
+
+            std::shared_ptr<ChunkSink> pSink;
+            std::function<void()> then;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                done_ = true;
+
+                pSink = pSink_;
+                then.swap(then_);
+            }
+
+            // Handler may return before reading all chunks
+            if (pSink)
+            {
+                pSink->Close(false);
+            }
+
+            if (then)
+            {
+                then();
+            }
+        }
+
+        // Calls 'f' when the call is done, or when it waits for chunks (if 'orSuspended'), at once if it is so
+        void Then(bool orSuspended, std::function<void()> f)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!done_  &&  !(orSuspended  &&  pSink_))
+                {
+                    then_ = std::move(f);
+                    thenSuspended_ = orSuspended;
+                    return;
+                }
+            }
+
+            f();
+        }
+
+        // Calls 'f' when handler read enough chunks to receive the next one, or when the call is done
+        void WhenReady(std::function<void()> f)
+        {
+            std::shared_ptr<ChunkSink> pSink;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!done_)
+                {
+                    pSink = pSink_;
+                }
+            }
+
+            if (pSink)
+            {
+                pSink->WhenReady(std::move(f));
+            }
+            else
+            {
+                f();
+            }
+        }
+
+        bool Done()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return done_;
+        }
+
+        bool Push(Serializer& reader)
+        {
+            std::shared_ptr<ChunkSink> pSink;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (done_)
+                    return true;
+
+                pSink = pSink_;
+            }
+
+            return pSink->Push(reader);
+        }
+
+        void Cancel()
+        {
+            std::shared_ptr<ChunkSink> pSink;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (pToken_)
+                {
+                    pToken_->Cancel();
+                }
+
+                pSink = pSink_;
+            }
+
+            if (pSink)
+            {
+                pSink->Close(true);
+            }
+        }
+
+        // Reply, valid when the call is done
+        const Serializer& Writer() const
+        {
+            return writer_;
+        }
+
+    private:
+        std::string name_;
+        Serializer writer_;
+        Serializer reader_;
+        std::shared_ptr<ChunkSink> pSink_;
+        std::shared_ptr<CancellationToken> pToken_;
+        bool done_ = false;
+
+        // Completes the reply of the call or of its chunk
+        std::function<void()> then_;
+        bool thenSuspended_ = false;
+
+        std::mutex locker_;
+    };
+
+
+    // DetachedCalls - detached calls which wait for chunks, by upload id.
+    // Upload id is random, chunks are accepted only from the client of the call.
+    struct DetachedCalls;
+    inline DetachedCalls* GetDetachedCalls();
+
+    struct DetachedCalls
+    {
+        ~DetachedCalls()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            for (auto& el: mapIdCall_)
+            {
+                el.second.pCall_->Cancel();
+            }
+
+            pPool_->Stop();
+        }
+
+        // Reply is the call's reply if it is done, or UploadPending followed by upload id if it waits for chunks.
+        // Call runs in a thread of the pool until it is done, Overloaded is thrown if all threads run calls.
+        // The reply is completed by the thread of the call, the receiving thread does not wait for the handler.
+        void Invoke(Caller* pCaller, const std::string& name, const FrameHeader& header, Serializer& writer, Serializer& reader)
+        {
+            auto pCall = std::make_shared<DetachedCall>(name, writer, reader);
+
+            pPool_->Start([pCall, pCaller, header]() { pCall->Run(pCaller, header); });
+
+            auto clientId = header.clientId_;
+
+            Reply(writer, [pCall](std::function<void()> f) { pCall->Then(true, std::move(f)); }, [pCall, clientId](Serializer& writer)
+            {
+                if (pCall->Done())
+                {
+                    writer = pCall->Writer();
+                    return;
+                }
+
+                WritePending(writer, GetDetachedCalls()->Add(pCall, clientId));
+            });
+        }
+
+        // Maximal number of detached calls running at the same time (64 by default)
+        void SetMaxThreads(size_t maxThreads)
+        {
+            pPool_->SetMaxThreads(maxThreads);
+        }
+
+        // Upload which is not continued during 'idleTimeout' is cancelled
+        void SetIdleTimeout(std::chrono::milliseconds idleTimeout)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            idleTimeout_ = idleTimeout;
+        }
+
+    private:
+        friend Callers* FunctionCallers();
+
+        // Reply is written when 'then' calls its function, it is completed later via AsyncReply of the call processed by this thread
+        static void Reply(Serializer& writer, std::function<void(std::function<void()>)> then, std::function<void(Serializer&)> write)
+        {
+            auto pReply = AsyncReply::Current();
+            if (pReply)
+            {
+                pReply->then_ = std::move(then);
+                pReply->write_ = std::move(write);
+                return;
+            }
+
+            std::promise<void> ready;
+            then([&ready]() { ready.set_value(); });
+            ready.get_future().wait();
+
+            write(writer);
+        }
+
+        static void WritePending(Serializer& writer, const std::string& id)
+        {
+            writer.clear();
+            writer << (int)Exception::UploadPending << "Upload is pending." << id;
+        }
+
+        // Threads of detached calls, they stay for next calls. Threads are detached and share the pool, so it outlives 
+        // DetachedCalls destroyed at exit, they exit when it is stopped.
+        struct Pool: public std::enable_shared_from_this<Pool>
+        {
+            void Start(std::function<void()>&& task)
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (threads_ - idle_ + tasks_.size() >= maxThreads_)
+                    throw Exception(Exception::Overloaded, "All threads of detached calls are busy.");
+
+                // Each idle thread takes one queued task
+                if (tasks_.size() >= idle_)
+                {
+                    threads_++;
+                    idle_++;
+
+                    auto pPool = shared_from_this();
+                    std::thread([pPool]() { pPool->Work(); }).detach();
+                }
+
+                tasks_.push_back(std::move(task));
+
+                cv_.notify_one();
+            }
+
+            void SetMaxThreads(size_t maxThreads)
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                maxThreads_ = maxThreads;
+            }
+
+            void Stop()
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                stop_ = true;
+
+                cv_.notify_all();
+            }
+
+        private:
+            void Work()
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                while (true)
+                {
+                    cv_.wait(lock, [this]() { return stop_  ||  !tasks_.empty(); });
+
+                    if (tasks_.empty())
+                    {
+                        threads_--;
+                        idle_--;
+                        return;
+                    }
+
+                    auto task = std::move(tasks_.front());
+                    tasks_.pop_front();
+
+                    idle_--;
+                    lock.unlock();
+
+                    task();
+
+                    lock.lock();
+                    idle_++;
+                }
+            }
+
+            std::deque<std::function<void()>> tasks_;
+            size_t threads_ = 0;
+            size_t idle_ = 0;
+            size_t maxThreads_ = 64;
+            bool stop_ = false;
+            std::mutex locker_;
+            std::condition_variable cv_;
+        };
+
+        std::string Add(const std::shared_ptr<DetachedCall>& pCall, const std::string& clientId)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto now = std::chrono::steady_clock::now();
+
+            // Uploads abandoned by clients
+            for (auto it = mapIdCall_.begin(); it != mapIdCall_.end();)
+            {
+                if (now - it->second.lastAccess_ > idleTimeout_)
+                {
+                    it->second.pCall_->Cancel();
+                    it = mapIdCall_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            std::string id = CreateUniqueId();
+
+            mapIdCall_.insert(std::make_pair(id, Entry{ pCall, clientId, now }));
+
+            return id;
+        }
+
+        std::shared_ptr<DetachedCall> Find(const std::string& id, const std::string& clientId)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = mapIdCall_.find(id);
+            if (it == mapIdCall_.end()  ||  clientId != it->second.clientId_)
+                throw Exception(Exception::ServerError, ToString() << "Invalid upload " << id << '.');
+
+            it->second.lastAccess_ = std::chrono::steady_clock::now();
+
+            return it->second.pCall_;
+        }
+
+        void Remove(const std::string& id)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            mapIdCall_.erase(id);
+        }
+
+        struct ChunkCaller: public Caller
+        {
+            void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) override
+            {
+                std::string id;
+                reader >> id;
+
+                auto pCall = GetDetachedCalls()->Find(id, header.clientId_);
+
+                // Reply to a chunk is completed when handler read previous chunks, so memory is bounded without waiting here
+                if (!pCall->Push(reader))
+                {
+                    Reply(writer, [pCall](std::function<void()> f) { pCall->WhenReady(std::move(f)); }, [id](Serializer& writer) { WritePending(writer, id); });
+                    return;
+                }
+
+                Reply(writer, [pCall](std::function<void()> f) { pCall->Then(false, std::move(f)); }, [pCall, id](Serializer& writer)
+                {
+                    GetDetachedCalls()->Remove(id);
+
+                    // Reply of the call follows the prefix reserved for the reply of the chunk
+                    auto& reply = pCall->Writer();
+
+                    writer.clear();
+                    writer.WriteBytes(reply.Data() + reply.PrefixSize(), reply.Size() - reply.PrefixSize());
+                });
+            }
+        };
+
+        struct CancelCaller: public Caller
+        {
+            void Call(const FrameHeader& header, Serializer&, Serializer& reader) override
+            {
+                std::string id;
+                reader >> id;
+
+                GetDetachedCalls()->Find(id, header.clientId_)->Cancel();
+                GetDetachedCalls()->Remove(id);
+            }
+        };
+
+        struct Entry
+        {
+            std::shared_ptr<DetachedCall> pCall_;
+            std::string clientId_;
+            std::chrono::steady_clock::time_point lastAccess_;
+        };
+
+        std::map<std::string, Entry> mapIdCall_;
+        std::chrono::milliseconds idleTimeout_ = std::chrono::minutes(10);
+        std::shared_ptr<Pool> pPool_ = std::make_shared<Pool>();
+        std::mutex locker_;
+    };
+
+    inline DetachedCalls* GetDetachedCalls()
+    {
+        static DetachedCalls s_detachedCalls; return &s_detachedCalls;
+    }
+
+
+    // Streams
+    struct Streams;
+    inline Streams* GetStreams();
+
+    struct Streams
+    {
+        // Stream is cancelled with the call which returned it (its deadline passed or client cancelled it).
+        // Its id is random and it is read only by the client of the call.
+        std::string Add(const std::shared_ptr<StreamSource>& pSource)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto now = std::chrono::steady_clock::now();
+
+            Reap(now);
+
+            std::string id = CreateUniqueId();
+
+            auto pToken = CurrentToken();
+            if (!pToken)
+            {
+                pToken = std::make_shared<CancellationToken>();
+            }
+
+            mapIdStream_.insert(std::make_pair(id, Entry{ pSource, pToken, CurrentClientId(), now }));
+
+            return id;
+        }
+
+        std::shared_ptr<StreamSource> Find(const std::string& id, const std::string& clientId, std::shared_ptr<CancellationToken>& pToken)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto now = std::chrono::steady_clock::now();
+
+            Reap(now);
+
+            auto it = mapIdStream_.find(id);
+            if (it == mapIdStream_.end()  ||  clientId != it->second.clientId_)
+                return nullptr;
+
+            it->second.lastAccess_ = now;
+
+            pToken = it->second.pToken_;
+
+            return it->second.pSource_;
+        }
+
+        void Remove(const std::string& id)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            mapIdStream_.erase(id);
+        }
+
+        // Stream which is not read during 'idleTimeout' is removed
+        void SetIdleTimeout(std::chrono::milliseconds idleTimeout)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            idleTimeout_ = idleTimeout;
+        }
+
+    private:
+        friend Callers* FunctionCallers();
+
+        struct NextCaller: public Caller
+        {
+            void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) override
+            {
+                std::string id;
+                size_t credits;
+                reader >> id >> credits;
+
+                std::shared_ptr<CancellationToken> pToken;
+
+                auto pSource = GetStreams()->Find(id, header.clientId_, pToken);
+                if (!pSource)
+                    throw Exception(Exception::ServerError, ToString() << "Invalid stream " << id << '.');
+
+                if (pToken->Cancelled())
+                {
+                    GetStreams()->Remove(id);
+
+                    pToken->ThrowIfCancelled();
+                }
+
+                // Producer checks cancellation of the call which returned the stream
+                CancellationScope scope(pToken);
+
+                bool end = pSource->WriteChunk(writer, credits);
+
+                // Producer could stop because of cancellation, client should not see it as the end
+                if (end  ||  pToken->Cancelled())
+                {
+                    GetStreams()->Remove(id);
+                }
+
+                pToken->ThrowIfCancelled();
+            }
+        };
+
+        struct CancelCaller: public Caller
+        {
+            void Call(const FrameHeader& header, Serializer&, Serializer& reader) override
+            {
+                std::string id;
+                reader >> id;
+
+                GetStreams()->Cancel(id, header.clientId_);
+            }
+        };
+
+        // Producer running in another thread sees cancellation
+        void Cancel(const std::string& id, const std::string& clientId)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            Reap(std::chrono::steady_clock::now());
+
+            auto it = mapIdStream_.find(id);
+            if (it == mapIdStream_.end()  ||  clientId != it->second.clientId_)
+                return;
+
+            it->second.pToken_->Cancel();
+
+            mapIdStream_.erase(it);
+        }
+
+        // Removes streams abandoned by clients which exited without cancelling, at most once per 'reapInterval' (under lock)
+        void Reap(std::chrono::steady_clock::time_point now)
+        {
+            const auto reapInterval = std::chrono::seconds(1);
+
+            if (now - lastReap_ < reapInterval)
+                return;
+
+            lastReap_ = now;
+
+            for (auto it = mapIdStream_.begin(); it != mapIdStream_.end();)
+            {
+                if (now - it->second.lastAccess_ > idleTimeout_)
+                {
+                    it->second.pToken_->Cancel();
+                    it = mapIdStream_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        struct Entry
+        {
+            std::shared_ptr<StreamSource> pSource_;
+            std::shared_ptr<CancellationToken> pToken_;
+            std::string clientId_;
+            std::chrono::steady_clock::time_point lastAccess_;
+        };
+
+        std::map<std::string, Entry> mapIdStream_;
+        std::chrono::steady_clock::time_point lastReap_;
+        std::chrono::milliseconds idleTimeout_ = std::chrono::minutes(10);
+        std::mutex locker_;
+    };
+
+    inline Streams* GetStreams()
+    {
+        static Streams s_streams; return &s_streams;
+    }
+
+
+    inline Callers* FunctionCallers()
+    {
+        static Callers s_functionCallers = []()
+        {
+            Callers callers;
+            callers.AddCaller("~InvalidateCache", new InvalidateCacheCaller);
+            callers.AddCaller("~NodeTag", new NodeTagCaller);
+            callers.AddCaller("~Cancel", new CancelCaller);
+            callers.AddCaller("~Batch", new BatchCaller);
+            callers.AddCaller("~Delete", new DeleteCaller);
+            callers.AddCaller("~Session", new SessionCaller);
+            callers.AddCaller("~StreamNext", new Streams::NextCaller);
+            callers.AddCaller("~StreamCancel", new Streams::CancelCaller);
+            callers.AddCaller("~UploadChunk", new DetachedCalls::ChunkCaller);
+            callers.AddCaller("~UploadCancel", new DetachedCalls::CancelCaller);
+
+            return callers;
+        }();
+
+        return &s_functionCallers;
+    }
+
+    inline void Invoke(Caller* pCaller, const std::string& name, const FrameHeader& header, Serializer& writer, Serializer& reader)
+    {
+        if (pCaller->Detached())
+        {
+            GetDetachedCalls()->Invoke(pCaller, name, header, writer, reader);
+        }
+        else
+        {
+            pCaller->Call(header, writer, reader);
+        }
+    }
+
+
+    // Reply starts with 'prefixSize' bytes reserved for its prefixes
+    inline std::vector<char> ProcessFunctionCall(const FrameHeader& header, const std::string& func, Serializer& reader, size_t prefixSize = 0)
+    {
+        Serializer writer;
+        writer.ReservePrefix(prefixSize);
+
+        auto pFunctionCaller = FunctionCallers()->GetCaller(func);
+
+        if (pFunctionCaller)
+        {
+            try 
+            {
+                writer << NoException();
+
+                if (AsyncReply::Current())
+                {
+                    AsyncReply::Current()->name_ = func;
+                }
+
+                Invoke(pFunctionCaller, func, header, writer, reader);
+            }
+            catch (const std::exception& e) 
+            {
+                writer.clear();
+
+                if (!WriteCancellation(writer, e))
+                {
+                    writer << Exception(Exception::ServerError, ToString() << "Server exception in " << func << " \"" << e.what() << "\".");
+                }
+            }
+        }
+        else
+        {
+            writer << Exception(Exception::InvalidFunction, ToString() << "Function " << func << " is not implemented.");
+        }
+
+        return writer;
+    }
+
+
+    // MethodCaller
+    template <typename C, typename M>
+    struct MethodCaller : public Caller
+    {
+        MethodCaller(C* pC, M m)
+            :pC_(pC), m_(m)
+        {};
+
+        template <typename Ret, typename ...Args>
+        Ret Call(Args&...args)
+        {
+	    struct AutoCounter
+	    {
+	        RemoteInterface* pInterface_;
+
+	        AutoCounter(RemoteInterface* pInterface)
+		    : pInterface_(pInterface)
+		{
+		    pInterface_->IncCounter();
+		}
+
+		~AutoCounter()
+		{
+		    pInterface_->DecCounter();
+		}
+	    };
+
+	    AutoCounter autoCounter(pC_);
+
+	    return ((*pC_).*(m_))(args...);
+        }
+
+        void Call(const FrameHeader& header, Serializer& writer, Serializer& reader) override
+        {
+            Call(header, pC_, m_, writer, reader);
+        };
+
+        bool Detached() const override
+        {
+            return HasChunkedParam(m_);
+        }
+
+        template <typename O, typename Ret, typename ...Args>
+        void Call(const FrameHeader& header, O* pC, Ret(O::*)(Args...), Serializer& writer, Serializer& reader)
+        {
+            ProcessCallArgs<Ret, Args...>(header, this, writer, reader);
+        }
+
+    private:
+        C* pC_;
+        M m_;
+    };
+
+    template <typename C, typename M>
+    bool RegisterMethod(C* pC, const std::string& method, M m)
+    {
+        GetClassInstances()->AddMethodCaller(pC, method, new MethodCaller<C, M>(pC, m));
+
+        return true;
+    }
+
+
+    inline std::vector<char> ProcessClassCall(const FrameHeader& header, const std::string& instanceId, const std::string& method, Serializer& reader, 
+        size_t prefixSize = 0)
+    {
+        Serializer writer;
+        writer.ReservePrefix(prefixSize);
+
+        if (DeleteCall == header.kind_)
+        {
+            auto pInterface = GetClassInstances()->RemoveInterface(instanceId);
+            if (pInterface)
+            {
+                writer << NoException();
+
+                GetClientClassInstances()->Remove(header.clientId_, pInterface);
+
+                pInterface->Dispose();
+            }
+            else
+            {
+                writer << Exception(Exception::InvalidClassInstance, ToString() << "Invalid class instance " << instanceId << '.');
+            }
+        }
+        else
+        {
+            do
+            {
+                auto pMethodCallers = GetClassInstances()->GeMethodCallers(instanceId);
+                if (!pMethodCallers)
+                {
+                    writer << Exception(Exception::InvalidClassInstance, ToString() << "Invalid class instance " << instanceId << '.');
+                    break;
+                }
+
+                auto pMethodCaller = pMethodCallers->GetCaller(method);
+                if (!pMethodCaller)
+                {
+                    writer << "Method " << method << " is not implemented.";
+                    break;
+                }
+
+                try 
+                {
+                    writer << NoException();
+
+                    if (AsyncReply::Current())
+                    {
+                        AsyncReply::Current()->name_ = method;
+                    }
+
+                    Invoke(pMethodCaller, method, header, writer, reader);
+                }
+                catch (const std::exception& e) 
+                {
+                    writer.clear();
+
+                    if (!WriteCancellation(writer, e))
+                    {
+                        writer << Exception(Exception::ServerError, ToString() << "Exception in " << method << " \"" << e.what() << "\".");
+                    }
+                }
+            } while (false);
+        }
+
+        return writer;
+    }
+
+	
+    // Called with the reply of a call, by the thread which processes it, or later by the thread which completes Async result of its handler
+    typedef std::function<void(std::vector<char>&& vOut)> Completion;
+
+    // Call read from its frame, it is processed when it is admitted
+    struct ReceivedCall
+    {
+        Serializer reader_;
+        FrameHeader header_;
+
+        // Instance id (of class call) and call name, they can be interned in the session
+        std::string instanceId_, callName_;
+
+        // Reply is compressed by the codec of the session
+        uint8_t codec_ = NoCodec;
+        size_t compressionThreshold_ = 0;
+
+        std::shared_ptr<CancellationToken> pToken_;
+        int peerPid_ = 0;
+
+        // Reply has checksum: the frame has it, or it is required by the session
+        bool sealed_ = false;
+
+        Completion completion_;
+    };
+
+    // Admitted call leaves admission when it is done, its service time adjusts the admission limit
+    struct AdmittedCall
+    {
+        bool admitted_ = false;
+        std::chrono::steady_clock::time_point start_;
+
+        ~AdmittedCall()
+        {
+            if (admitted_)
+            {
+                GetAdmission()->Leave(std::chrono::steady_clock::now() - start_);
+            }
+        }
+    };
+
+    // Size of the prefixes of the reply (correlation id, checksum), its writer reserves them
+    inline size_t ReplyPrefixSize(const ReceivedCall& call)
+    {
+        return (call.header_.correlationId_? CorrelatedPrefixSize: 0) + (call.sealed_? SealedPrefixSize: 0);
+    }
+
+    // Writes the prefixes of the reply in the space reserved for them, compresses it by the codec of the session
+    inline void FinishReply(std::vector<char>& vOut, size_t prefixSize, uint32_t correlationId, uint8_t codec, size_t compressionThreshold, bool sealed)
+    {
+        size_t start = prefixSize;
+
+        CorrelateReply(vOut, start, correlationId);
+
+        if (codec)
+        {
+            CompressReply(vOut, start, codec, compressionThreshold, sealed? SealedPrefixSize: 0);
+        }
+
+        if (sealed)
+        {
+            SealReply(vOut, start);
+        }
+    }
+
+    // Executes admitted call, 'complete' is called with its reply (which starts with 'prefixSize' reserved bytes) when the handler returns, 
+    // or when its Async result is ready
+    inline void ExecuteCall(const std::shared_ptr<ReceivedCall>& pCall, const std::shared_ptr<AdmittedCall>& pAdmitted, size_t prefixSize, 
+        const Completion& complete)
+    {
+        auto& header = pCall->header_;
+        auto pToken = pCall->pToken_;
+
+        CancellationScope scope(pToken);
+        ClientIdScope clientIdScope(header.clientId_);
+        PeerScope peerScope(pCall->peerPid_);
+
+        std::vector<char> vOut;
+        AsyncReply reply;
+        AsyncReplyScope replyScope(&reply);
+
+        // Parameters of std::pmr types are created in the call arena
+        CallArenaScope arenaScope;
+
+        if (FunctionCall != header.kind_)
+        {
+            vOut = ProcessClassCall(header, pCall->instanceId_, pCall->callName_, pCall->reader_, prefixSize);
+        }
+        else
+        {
+            vOut = ProcessFunctionCall(header, pCall->callName_, pCall->reader_, prefixSize);
+        }
+
+        if (!reply.then_)
+        {
+            complete(std::move(vOut));
+            return;
+        }
+
+        // Call stays admitted and cancellable until its result is ready
+        auto write = reply.write_;
+        auto name = reply.name_;
+        auto clientId = header.clientId_;
+
+        reply.then_([vOut, prefixSize, write, name, complete, pAdmitted, pToken, clientId]()
+        {
+            ClientIdScope clientIdScope(clientId);
+
+            Serializer writer(vOut);
+            writer.ReservePrefix(prefixSize);
+
+            try
+            {
+                write(writer);
+            }
+            catch (const std::exception& e)
+            {
+                writer.clear();
+
+                if (!WriteCancellation(writer, e))
+                {
+                    writer << Exception(Exception::ServerError, ToString() << "Server exception in " << name << " \"" << e.what() << "\".");
+                }
+            }
+
+            complete(writer);
+        });
+    }
+
+    inline void ProcessAdmittedCall(const std::shared_ptr<ReceivedCall>& pCall, const std::shared_ptr<AdmittedCall>& pAdmitted, 
+        bool (*clientRunning)(const std::string& clientId))
+    {
+        auto& header = pCall->header_;
+        auto& completion = pCall->completion_;
+
+        Completion complete = completion;
+        auto prefixSize = ReplyPrefixSize(*pCall);
+        if (pCall->codec_  ||  prefixSize)
+        {
+            auto codec = pCall->codec_;
+            auto compressionThreshold = pCall->compressionThreshold_;
+            auto correlationId = header.correlationId_;
+            bool sealed = pCall->sealed_;
+
+            complete = [completion, prefixSize, codec, compressionThreshold, sealed, correlationId](std::vector<char>&& vOut)
+            {
+                FinishReply(vOut, prefixSize, correlationId, codec, compressionThreshold, sealed);
+
+                completion(std::move(vOut));
+            };
+        }
+
+	GetClientClassInstances()->Clear(clientRunning);
+        GetSessions()->Clear(clientRunning);
+
+        if (header.idempotencyKey_.empty())
+        {
+            ExecuteCall(pCall, pAdmitted, prefixSize, complete);
+            return;
+        }
+
+        // Reply is stored by idempotency key before it is correlated, compressed and sealed, only succeeded reply (it starts with 
+        // empty NoException string): failed, cancelled or waiting for InputStream chunks call can be retried.
+        // Stored reply completes retries whose prefixes differ, it has no reserved space, it is copied after the space of each call.
+        auto name = FunctionCall != header.kind_? pCall->instanceId_ + '.' + pCall->callName_: pCall->callName_;
+
+        GetResponseCache()->Process(header.clientId_, name, header.idempotencyKey_, 
+            [pCall, pAdmitted](const Completion& done) { ExecuteCall(pCall, pAdmitted, 0, done); }, 
+            [](const std::vector<char>& vOut) { return !vOut.empty()  &&  0 == vOut[0]; }, 
+            [complete, prefixSize](std::vector<char>&& vOut)
+            {
+                if (!prefixSize)
+                {
+                    complete(std::move(vOut));
+                    return;
+                }
+
+                std::vector<char> reply(prefixSize);
+                reply.insert(reply.end(), vOut.begin(), vOut.end());
+
+                complete(std::move(reply));
+            });
+    }
+
+    // Error reply of the call which is not executed
+    inline void CompleteWithError(const ReceivedCall& call, const Exception& e)
+    {
+        auto prefixSize = ReplyPrefixSize(call);
+
+        Serializer writer;
+        writer.ReservePrefix(prefixSize);
+        writer << e;
+
+        std::vector<char> vOut = writer;
+        FinishReply(vOut, prefixSize, call.header_.correlationId_, NoCodec, 0, call.sealed_);
+
+        call.completion_(std::move(vOut));
+    }
+
+    inline void ProcessCall(const std::vector<char>& vIn, const Completion& completion, bool (*clientRunning)(const std::string& clientId) = nullptr)
+    {
+        auto pCall = std::make_shared<ReceivedCall>();
+        pCall->completion_ = completion;
+        pCall->peerPid_ = CurrentPeerPid();
+        pCall->sealed_ = 0 != (FrameFlagsOf(vIn.data(), vIn.size()) & HasChecksum);
+
+        auto& header = pCall->header_;
+
+        // Call which client does not wait for anymore, or which is not admitted, is rejected before its parameters are read.
+        // Internal calls (for instance next chunks of admitted call, or '~Cancel') are not queued.
+        bool admission = false;
+        try
+        {
+            // Checksum covers the frame as it was sent, after compression. It is verified in place, the reader takes the frame 
+            // without it (with its length).
+            auto& reader = pCall->reader_;
+
+            size_t size = vIn.size();
+            if (CheckFrame(vIn, size))
+            {
+                reader = std::vector<char>(vIn.begin(), vIn.begin() + size);
+                reader.WriteAt(FrameLengthOffset, (uint32_t)(size - FramePrefixSize));
+            }
+            else
+            {
+                reader = vIn;
+            }
+
+            std::vector<char> decompressed;
+            if (DecompressFrame(reader.Data(), reader.Size(), decompressed))
+            {
+                reader = std::move(decompressed);
+            }
+
+            reader >> header;
+
+            std::shared_ptr<Session> pSession;
+            if (header.flags_ & HasSession)
+            {
+                pSession = GetSessions()->Get(header.sessionId_);
+                if (!pSession)
+                    throw Exception(Exception::InvalidSession, "Session is not found.");
+
+                header.clientId_ = pSession->clientId_;
+
+                // Flag of the frame does not decide if it has checksum
+                if (pSession->checksums_  &&  !(header.flags_ & HasChecksum))
+                {
+                    pCall->sealed_ = true;
+                    throw Exception(Exception::InvalidFrame, "Frame of the session has no checksum.");
+                }
+
+                pCall->codec_ = pSession->codec_;
+                pCall->compressionThreshold_ = pSession->compressionThreshold_;
+            }
+
+            if ((header.flags_ & NativeArgs)  &&  !(pSession  &&  pSession->native_))
+                throw Exception(Exception::InvalidFrame, "Native arguments without session of the same ABI.");
+
+            if (FunctionCall != header.kind_)
+            {
+                pCall->instanceId_ = ReadName(reader, pSession.get());
+            }
+
+            auto& callName = pCall->callName_;
+            if (DeleteCall != header.kind_)
+            {
+                callName = ReadName(reader, pSession.get());
+            }
+
+            if (NoDeadline() != header.deadline_  ||  !header.cancelId_.empty())
+            {
+                pCall->pToken_ = GetCancellations()->Start(header.clientId_, header.cancelId_, header.deadline_);
+                pCall->pToken_->ThrowIfCancelled();
+            }
+
+            admission = GetAdmission()->Enabled()  &&  !(FunctionCall == header.kind_  &&  !callName.empty()  &&  '~' == callName[0]);
+        }
+        catch (const Exception& e)
+        {
+            CompleteWithError(*pCall, e);
+            return;
+        }
+
+        if (!admission)
+        {
+            ProcessAdmittedCall(pCall, std::make_shared<AdmittedCall>(), clientRunning);
+            return;
+        }
+
+        // Call which waits for admission does not block this thread, it is processed by the thread which admits it
+        auto resume = [pCall, clientRunning](std::exception_ptr pError)
+        {
+            auto pAdmitted = std::make_shared<AdmittedCall>();
+            pAdmitted->admitted_ = !pError;
+            pAdmitted->start_ = std::chrono::steady_clock::now();
+
+            try
+            {
+                if (pError)
+                    std::rethrow_exception(pError);
+
+                // It could be cancelled while it waited
+                if (pCall->pToken_)
+                {
+                    pCall->pToken_->ThrowIfCancelled();
+                }
+            }
+            catch (const Exception& e)
+            {
+                CompleteWithError(*pCall, e);
+                return;
+            }
+
+            ProcessAdmittedCall(pCall, pAdmitted, clientRunning);
+        };
+
+        try
+        {
+            if (!GetAdmission()->Enter(header, resume))
+                return;
+        }
+        catch (const Exception& e)
+        {
+            CompleteWithError(*pCall, e);
+            return;
+        }
+
+        resume(nullptr);
+    }
+
+    // Waits for the reply if the handler returns Async which is not completed yet
+    inline void ProcessCall(const std::vector<char>& vIn, std::vector<char>& vOut, bool (*clientRunning)(const std::string& clientId) = nullptr)
+    {
+        struct Wait
+        {
+            explicit Wait(std::vector<char>& vOut)
+                : vOut_(vOut)
+            {}
+
+            std::vector<char>& vOut_;
+            bool done_ = false;
+            std::mutex locker_;
+            std::condition_variable cv_;
+        };
+
+        Wait wait(vOut);
+
+        ProcessCall(vIn, [&wait](std::vector<char>&& vOut)
+        {
+            std::lock_guard<std::mutex> lock(wait.locker_);
+
+            wait.vOut_ = std::move(vOut);
+            wait.done_ = true;
+
+            wait.cv_.notify_one();
+        }, clientRunning);
+
+        std::unique_lock<std::mutex> lock(wait.locker_);
+
+        wait.cv_.wait(lock, [&wait] { return wait.done_; });
+    }
+
+    // Processes frame received by client from server: callback, or '~Batch' of callbacks sent by CallbackQueue
+    inline void ProcessCallback(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        BatchCaller::Scope scope(BatchCaller::Callback);
+
+        ProcessCall(vIn, vOut);
+    }
+
+    inline void BatchCaller::Call(const FrameHeader&, Serializer&, Serializer& reader)
+    {
+        if (Batched == Current())
+            throw Exception(Exception::InvalidFrame, "~Batch inside ~Batch.");
+
+        if (Callback != Current())
+            throw Exception(Exception::InvalidFrame, "~Batch is accepted only in callbacks.");
+
+        auto pBatch = std::make_shared<Batch>();
+        reader >> pBatch->frames_;
+        pBatch->pCache_ = ResultCache::Current();
+
+        Process(pBatch);
+    }
+
+    inline void BatchCaller::Process(const std::shared_ptr<Batch>& pBatch)
+    {
+        Scope scope(Batched);
+        ResultCache::Scope cacheScope(pBatch->pCache_);
+
+        while (pBatch->next_ < pBatch->frames_.size())
+        {
+            auto& frame = pBatch->frames_[pBatch->next_++];
+
+            // Batch is continued by this loop if the call is completed before ProcessCall returns, otherwise by its completion
+            auto pCompleted = std::make_shared<std::atomic<bool>>(false);
+
+            ProcessCall(frame, [pBatch, pCompleted](std::vector<char>&&)
+            {
+                if (pCompleted->exchange(true))
+                {
+                    Process(pBatch);
+                }
+            });
+
+            if (!pCompleted->exchange(true))
+                return;
+        }
+    }
+
+    inline void AddInterface(RemoteInterface* pInterface)
+    {
+        GetClassInstances()->AddInterface(pInterface);
+    }
 
     inline void RemoveInterface(RemoteInterface* pInterface)
     {
@@ -496,10 +1984,21 @@ namespace RemoteCall
 
     inline auto Delete(RemoteInterface* pInterface)
     {
-        auto instanceId = GetClassInstances()->RemoveInterface(pInterface);
+        // Reference of the proxy is released, its instance is deleted by server with the last one
+        if (pInterface->proxy_)
+        {
+            RemoteCall::MethodInfo<false, void> deleteInfo(pInterface->instanceId_, "~");
+            deleteInfo.kind_ = DeleteCall;
+            deleteInfo.local_ = !GetProxies()->Release(pInterface);
+
+            return deleteInfo;
+        }
+
+        RemoteCall::MethodInfo<false, void> deleteInfo(GetClassInstances()->RemoveInterface(pInterface), "~");
+        deleteInfo.kind_ = DeleteCall;
 
 	pInterface->DecCounter();
 
-	return RemoteCall::MethodInfo<false, void>(instanceId, "~");
+	return deleteInfo;
     }
 }
@@ -0,0 +1,359 @@
+// Session - binds client id to a transport once, so frames carry 8 bytes session id instead of the client id.
+// Call names and instance ids are interned into the dictionary of the session: the first frames with a string define
+// its index, frames sent after the server confirmed it (replied to a call which defined it) contain the index only.
+// Confirmations and resets carry the session id of the frame, so replies of a previous session do not change the current one.
+// Transport opens the session on the first call if its UseSession() returns true.
+
+#pragma once
+
+#include "RemoteCallUtils.h"
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <string>
+#include <cstdint>
+
+namespace RemoteCall
+{
+    // Interned string on the wire: marker, index, and the string if it is defined. Plain strings do not start with them.
+    enum SessionString: uint8_t
+    {
+        StringRef = 1,
+        StringDef = 2
+    };
+
+    enum
+    {
+        // Strings in the dictionary of a session
+        MaxSessionStrings = 4096,
+
+        // Shorter strings are written as they are, they are not longer than the reference
+        MinInternedSize = 4
+    };
+
+
+    // ClientSession - session of a transport
+    struct ClientSession
+    {
+        ClientSession() {}
+
+        // Copy of transport opens its own session
+        ClientSession(const ClientSession&) {}
+
+        void operator = (const ClientSession&) {}
+
+        uint64_t Id() const
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return id_;
+        }
+
+        // 'codec' compresses frames of the session (server accepted it), 'native' - server has the same ABI
+        void Open(uint64_t id, uint8_t codec = 0, bool native = false)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            id_ = id;
+            codec_ = codec;
+            native_ = native;
+            strings_.clear();
+        }
+
+        uint8_t Codec() const
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return codec_;
+        }
+
+        bool Native() const
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return native_;
+        }
+
+        // Server does not know session 'id' (it was restarted, or the session expired), it is reset if it is still the current one
+        void Reset(uint64_t id)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            if (id != id_)
+                return;
+
+            id_ = 0;
+            codec_ = 0;
+            native_ = false;
+            strings_.clear();
+        }
+
+        // Writes index of the confirmed string, the definition of a new one, or the string itself without session
+        void WriteName(Serializer& writer, const std::string& s)
+        {
+            std::unique_lock<std::mutex> lock(locker_);
+
+            if (!id_  ||  s.size() < MinInternedSize)
+            {
+                lock.unlock();
+
+                writer << s;
+                return;
+            }
+
+            auto it = strings_.find(s);
+            if (strings_.end() == it)
+            {
+                if (strings_.size() >= MaxSessionStrings)
+                {
+                    lock.unlock();
+
+                    writer << s;
+                    return;
+                }
+
+                it = strings_.insert(std::make_pair(s, Entry{ (uint16_t)strings_.size(), false })).first;
+            }
+
+            if (it->second.confirmed_)
+            {
+                writer << (uint8_t)StringRef << it->second.index_;
+            }
+            else
+            {
+                writer << (uint8_t)StringDef << it->second.index_ << s;
+            }
+        }
+
+        // Called when server replied to a call with the string sent in session 'id', frames sent later reference it by index.
+        // Frames can be processed by server in any order, so it is defined by each frame until then.
+        void Confirm(uint64_t id, const std::string& s)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            // Reply of the previous session, its dictionary is not the current one
+            if (id != id_)
+                return;
+
+            auto it = strings_.find(s);
+            if (strings_.end() != it)
+            {
+                it->second.confirmed_ = true;
+            }
+        }
+
+        // Serializes handshakes of threads
+        std::mutex openLocker_;
+
+    private:
+        struct Entry
+        {
+            uint16_t index_;
+            bool confirmed_;
+        };
+
+        uint64_t id_ = 0;
+        uint8_t codec_ = 0;
+        bool native_ = false;
+        std::map<std::string, Entry> strings_;
+        mutable std::mutex locker_;
+    };
+
+
+    inline void WriteName(Serializer& writer, ClientSession* pSession, const std::string& s)
+    {
+        if (pSession)
+        {
+            pSession->WriteName(writer, s);
+        }
+        else
+        {
+            writer << s;
+        }
+    }
+
+
+    // Session - server side of a session
+    struct Session
+    {
+        Session(const std::string& clientId, uint8_t codec, size_t compressionThreshold, bool native, bool checksums = false)
+            : clientId_(clientId), codec_(codec), compressionThreshold_(compressionThreshold), native_(native), checksums_(checksums)
+        {}
+
+        const std::string clientId_;
+
+        // Replies of at least 'compressionThreshold_' bytes are compressed by 'codec_' (if it is not 0)
+        const uint8_t codec_;
+        const size_t compressionThreshold_;
+
+        // Client has the same ABI, its frames can contain NativeArgs
+        const bool native_;
+
+        // Frames of the session have checksum, frame without it is rejected (its flag could be corrupted)
+        const bool checksums_;
+
+        void Define(uint16_t index, const std::string& s)
+        {
+            if (index >= MaxSessionStrings)
+                throw Exception(Exception::InvalidSession, ToString() << "Invalid string index " << index << '.');
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            strings_[index] = s;
+        }
+
+        std::string Lookup(uint16_t index)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = strings_.find(index);
+            if (strings_.end() == it)
+                throw Exception(Exception::InvalidSession, ToString() << "Unknown string index " << index << '.');
+
+            return it->second;
+        }
+
+    private:
+        std::map<uint16_t, std::string> strings_;
+        std::mutex locker_;
+    };
+
+
+    // Sessions - sessions opened by clients. Session ids are random, so a session of restarted server is not found.
+    struct Sessions
+    {
+        // The oldest sessions are removed above it, their clients open new ones
+        enum { MaxSessions = 64 * 1024 };
+
+        uint64_t Open(const std::string& clientId, uint8_t codec = 0, size_t compressionThreshold = 0, bool native = false, bool checksums = false)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            uint64_t id;
+            do
+            {
+                id = random_();
+            } while (!id  ||  sessions_.count(id));
+
+            sessions_[id] = Entry{ ++opened_, std::make_shared<Session>(clientId, codec, compressionThreshold, native, checksums) };
+            order_[opened_] = id;
+
+            if (sessions_.size() > MaxSessions)
+            {
+                sessions_.erase(order_.begin()->second);
+                order_.erase(order_.begin());
+            }
+
+            return id;
+        }
+
+        std::shared_ptr<Session> Get(uint64_t id)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto it = sessions_.find(id);
+            if (sessions_.end() == it)
+                return nullptr;
+
+            return it->second.pSession_;
+        }
+
+        // Removes sessions of clients which are not running
+        void Clear(bool (*clientRunning)(const std::string& clientId))
+        {
+            if (!clientRunning)
+                return;
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            for (auto it = sessions_.begin(); it != sessions_.end();)
+            {
+                auto& clientId = it->second.pSession_->clientId_;
+
+                if (!clientId.empty()  &&  !clientRunning(clientId))
+                {
+                    order_.erase(it->second.opened_);
+                    it = sessions_.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        size_t Count()
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            return sessions_.size();
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t opened_;
+            std::shared_ptr<Session> pSession_;
+        };
+
+        std::map<uint64_t, Entry> sessions_;
+        std::map<uint64_t, uint64_t> order_;
+        uint64_t opened_ = 0;
+        std::mt19937_64 random_{ std::random_device{}() ^ ((unsigned long long)std::random_device{}() << 32) };
+        std::mutex locker_;
+    };
+
+    inline Sessions* GetSessions()
+    {
+        static Sessions s_sessions; return &s_sessions;
+    }
+
+
+    // Reads call name or instance id written by ClientSession::WriteName
+    // Skips name written by WriteName, without session
+    inline void SkipName(Serializer& reader)
+    {
+        auto marker = (uint8_t)reader.GetCurrent();
+        if (StringRef == marker  ||  StringDef == marker)
+        {
+            uint16_t index;
+            reader >> marker >> index;
+
+            if (StringRef == marker)
+                return;
+        }
+
+        std::string s;
+        reader >> s;
+    }
+
+    inline std::string ReadName(Serializer& reader, Session* pSession)
+    {
+        std::string s;
+
+        auto marker = (uint8_t)reader.GetCurrent();
+        if (StringRef != marker  &&  StringDef != marker)
+        {
+            reader >> s;
+            return s;
+        }
+
+        if (!pSession)
+            throw Exception(Exception::InvalidSession, "Interned string without session.");
+
+        uint16_t index;
+        reader >> marker >> index;
+
+        if (StringRef == marker)
+            return pSession->Lookup(index);
+
+        reader >> s;
+        pSession->Define(index, s);
+
+        return s;
+    }
+}
@@ -0,0 +1,209 @@
+// SharedBlob (Linux) - parameter type for big buffers passed to a server on the same host without copying.
+// Client fills memfd backed memory, only handle, offset and size are serialized, server maps the same memory.
+
+#pragma once
+
+#include "RemoteCallSerializer.h"
+#include "RemoteCallException.h"
+#include "RemoteCallFrame.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <climits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace RemoteCall
+{
+    // 'const SharedBlob&' (or 'SharedBlob') parameter is mapped by server read-only, 'SharedBlob&' read-write.
+    // Memory is valid while any copy of SharedBlob exists: on client while the blob is alive,
+    // on server during the call, or longer if the blob is copied (for instance stored in a class instance).
+    // Server opens client memory via /proc/<pid>/fd/<fd>, so it should run as the same user as client. It accepts only memfd 
+    // of the client process which sent the frame (CurrentPeerPid, RemoteCallFrame.h), and only the range inside it.
+    class SharedBlob
+    {
+    public:
+        SharedBlob() {}
+
+        // Creates blob of 'size' bytes, mapped read-write
+        explicit SharedBlob(size_t size)
+            : offset_(0), size_(size)
+        {
+            int fd = memfd_create("RemoteCall::SharedBlob", MFD_CLOEXEC);
+            if (-1 == fd)
+                throw Exception(Exception::TransportError, "Cannot create shared blob.");
+
+            if (ftruncate(fd, size))
+            {
+                close(fd);
+                throw Exception(Exception::TransportError, "Cannot resize shared blob.");
+            }
+
+            handle_ = ToString() << "/proc/" << getpid() << "/fd/" << fd;
+
+            pRegion_ = std::make_shared<Region>(fd, 0, size, true, true);
+        }
+
+        // Blob referencing part of this blob, it shares memory and lifetime
+        SharedBlob Slice(size_t offset, size_t size) const
+        {
+            if (offset > size_  ||  size > size_ - offset)
+                throw Exception(Exception::ServerError, "Shared blob slice is out of range.");
+
+            SharedBlob blob(*this);
+            blob.offset_ = offset_ + offset;
+            blob.size_ = size;
+
+            return blob;
+        }
+
+        // Server maps blob read-only on first access if it was not mapped as parameter
+        char* Data()
+        {
+            if (!pRegion_  &&  !handle_.empty())
+            {
+                Map(false);
+            }
+
+            return pRegion_? pRegion_->p_ + (offset_ - pRegion_->offset_): nullptr;
+        }
+
+        const char* Data() const
+        {
+            return const_cast<SharedBlob*>(this)->Data();
+        }
+
+        size_t Size() const
+        {
+            return size_;
+        }
+
+        bool Writable() const
+        {
+            return pRegion_  &&  pRegion_->writable_;
+        }
+
+        // Maps range of the blob received from client
+        void Map(bool writable)
+        {
+            if (pRegion_)
+                return;
+
+            int pid = 0, n = 0, end = 0;
+            if (2 != sscanf(handle_.c_str(), "/proc/%d/fd/%d%n", &pid, &n, &end)  ||  end != (int)handle_.size()  ||  
+                !CurrentPeerPid()  ||  pid != CurrentPeerPid())
+                throw Exception(Exception::ServerError, ToString() << "Shared blob " << handle_ << " does not belong to the client.");
+
+            int fd = open(handle_.c_str(), (writable? O_RDWR: O_RDONLY) | O_CLOEXEC);
+            if (-1 == fd)
+                throw Exception(Exception::ServerError, ToString() << "Cannot open shared blob " << handle_ << '.');
+
+            // Descriptor can refer to any file opened by client, only its memfd is accepted
+            std::string path = ToString() << "/proc/self/fd/" << fd;
+
+            char link[PATH_MAX] = {};
+            struct stat st;
+            bool valid = readlink(path.c_str(), link, sizeof(link) - 1) > 0  &&  
+                0 == strncmp(link, "/memfd:", 7)  &&  !fstat(fd, &st)  &&  offset_ <= (size_t)st.st_size  &&  size_ <= (size_t)st.st_size - offset_;
+
+            if (!valid)
+            {
+                close(fd);
+                throw Exception(Exception::ServerError, ToString() << "Shared blob " << handle_ << " is not valid.");
+            }
+
+            pRegion_ = std::make_shared<Region>(fd, offset_, size_, writable, false);
+        }
+
+        friend Serializer& operator << (Serializer& writer, const SharedBlob& blob)
+        {
+            return writer << blob.handle_ << (uint64_t)blob.offset_ << (uint64_t)blob.size_;
+        }
+
+        friend Serializer& operator >> (Serializer& reader, SharedBlob& blob)
+        {
+            std::string handle;
+            uint64_t offset, size;
+            reader >> handle >> offset >> size;
+
+            // Client reading back in/out parameter keeps its own memory, server already changed it in place
+            if (blob.pRegion_  &&  blob.handle_ == handle)
+                return reader;
+
+            blob = SharedBlob();
+            blob.handle_ = handle;
+            blob.offset_ = (size_t)offset;
+            blob.size_ = (size_t)size;
+
+            return reader;
+        }
+
+    private:
+        // Mapped memory, unmapped when the last blob referencing it is destroyed
+        struct Region
+        {
+            // Client keeps descriptor ('keepFd'), since it is opened by server, server needs only the mapping
+            Region(int fd, size_t offset, size_t size, bool writable, bool keepFd)
+                : writable_(writable)
+            {
+                // mmap offset should be page aligned
+                size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+                offset_ = offset / page * page;
+                size_ = size + (offset - offset_);
+
+                void* p = size_? mmap(nullptr, size_, writable? PROT_READ | PROT_WRITE: PROT_READ, MAP_SHARED, fd, offset_): nullptr;
+
+                if (MAP_FAILED == p  ||  !keepFd)
+                {
+                    close(fd);
+                }
+                else
+                {
+                    fd_ = fd;
+                }
+
+                if (MAP_FAILED == p)
+                    throw Exception(Exception::ServerError, "Cannot map shared blob.");
+
+                p_ = (char*)p;
+            }
+
+            ~Region()
+            {
+                if (p_)
+                {
+                    munmap(p_, size_);
+                }
+
+                if (-1 != fd_)
+                {
+                    close(fd_);
+                }
+            }
+
+            char* p_ = nullptr;
+            size_t offset_ = 0;
+            size_t size_ = 0;
+            bool writable_;
+            int fd_ = -1;
+        };
+
+        std::string handle_;
+        size_t offset_ = 0;
+        size_t size_ = 0;
+        std::shared_ptr<Region> pRegion_;
+    };
+
+    // Server maps blob parameter according to its declaration
+    inline void PrepareParam(SharedBlob& blob, bool out)
+    {
+        blob.Map(out);
+    }
+}
@@ -0,0 +1,574 @@
+// Shared memory transport for same-host IPC (Linux).
+// Client and server exchange frames through two single producer/single consumer rings (requests and replies)
+// placed in one memfd or POSIX shared memory region. Frames are reserved and read in place, waiting side sleeps on futex.
+
+#pragma once
+
+#include "RemoteCallClient.h"
+#include "RemoteCallServer.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace RemoteCall
+{
+    // Futex helpers, futexes are not private since they are shared between processes
+    inline void FutexWait(std::atomic<uint32_t>& word, uint32_t value, int timeoutMs)
+    {
+        static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Futex word should be 32 bit");
+
+        timespec ts = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+
+        syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAIT, value, timeoutMs < 0? nullptr: &ts, nullptr, 0);
+    }
+
+    inline void FutexWake(std::atomic<uint32_t>& word)
+    {
+        syscall(SYS_futex, (uint32_t*)&word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+
+    // SharedMemoryRing - view of a ring of frames in shared memory, one writer and one reader.
+    // Frame is 16 bytes header (size, flags, id) followed by data padded to 8 bytes, a frame never wraps around the end of the ring.
+    struct SharedMemoryRing
+    {
+        struct Header
+        {
+            alignas(64) std::atomic<uint64_t> head;
+            alignas(64) std::atomic<uint64_t> tail;
+            alignas(64) std::atomic<uint32_t> dataSeq;
+            std::atomic<uint32_t> dataWaiters;
+            alignas(64) std::atomic<uint32_t> spaceSeq;
+            std::atomic<uint32_t> spaceWaiters;
+        };
+
+        struct FrameHeader
+        {
+            uint32_t size;
+            uint32_t flags;
+            uint64_t id;
+        };
+
+        static constexpr uint32_t WrapMarker = 0xFFFFFFFF;
+
+        static size_t Align(size_t size)
+        {
+            return (size + 7) & ~size_t(7);
+        }
+
+        // Header and data of a ring, and the region of the next ring, start at a cache line
+        static size_t AlignRegion(size_t size)
+        {
+            return (size + alignof(Header) - 1) & ~(alignof(Header) - 1);
+        }
+
+        static size_t RegionSize(size_t capacity)
+        {
+            return sizeof(Header) + AlignRegion(capacity);
+        }
+
+        SharedMemoryRing() {}
+
+        SharedMemoryRing(char* pRegion, size_t capacity, bool init)
+            : pHeader_((Header*)pRegion), pData_(pRegion + sizeof(Header)), capacity_(capacity)
+        {
+            if (init)
+            {
+                new (pHeader_) Header();
+            }
+        }
+
+        // Maximal frame data size which fits in the ring
+        size_t MaxFrameSize() const
+        {
+            return capacity_ / 2 - sizeof(FrameHeader);
+        }
+
+        // Returns pointer where 'size' bytes of the frame can be written in place, or nullptr if there is no space
+        char* Reserve(size_t size)
+        {
+            auto head = pHeader_->head.load(std::memory_order_relaxed);
+            auto tail = pHeader_->tail.load(std::memory_order_acquire);
+
+            auto pos = head % capacity_;
+            auto need = sizeof(FrameHeader) + Align(size);
+            auto padding = pos + need > capacity_? capacity_ - pos: 0;
+
+            if (head - tail + padding + need > capacity_)
+                return nullptr;
+
+            if (padding)
+            {
+                ((FrameHeader*)(pData_ + pos))->size = WrapMarker;
+                pos = 0;
+            }
+
+            reservedPadding_ = padding;
+
+            return pData_ + pos + sizeof(FrameHeader);
+        }
+
+        // Publishes frame previously reserved by Reserve
+        void Commit(size_t size, uint32_t flags = 0, uint64_t id = 0)
+        {
+            auto head = pHeader_->head.load(std::memory_order_relaxed) + reservedPadding_;
+
+            auto pFrameHeader = (FrameHeader*)(pData_ + head % capacity_);
+            pFrameHeader->size = (uint32_t)size;
+            pFrameHeader->flags = flags;
+            pFrameHeader->id = id;
+
+            pHeader_->head.store(head + sizeof(FrameHeader) + Align(size), std::memory_order_release);
+
+            pHeader_->dataSeq.fetch_add(1);
+            if (pHeader_->dataWaiters.load())
+            {
+                FutexWake(pHeader_->dataSeq);
+            }
+        }
+
+        // Returns pointer to the data of the oldest frame in place, or nullptr if ring is empty
+        const char* Peek(size_t& size, uint32_t& flags, uint64_t& id)
+        {
+            while (true)
+            {
+                auto tail = pHeader_->tail.load(std::memory_order_relaxed);
+                if (tail == pHeader_->head.load(std::memory_order_acquire))
+                    return nullptr;
+
+                auto pos = tail % capacity_;
+                auto pFrameHeader = (const FrameHeader*)(pData_ + pos);
+
+                if (WrapMarker == pFrameHeader->size)
+                {
+                    pHeader_->tail.store(tail + capacity_ - pos, std::memory_order_release);
+                    continue;
+                }
+
+                size = pFrameHeader->size;
+                flags = pFrameHeader->flags;
+                id = pFrameHeader->id;
+
+                return (const char*)(pFrameHeader + 1);
+            }
+        }
+
+        // Releases frame returned by Peek
+        void Release()
+        {
+            auto tail = pHeader_->tail.load(std::memory_order_relaxed);
+            auto pFrameHeader = (const FrameHeader*)(pData_ + tail % capacity_);
+
+            pHeader_->tail.store(tail + sizeof(FrameHeader) + Align(pFrameHeader->size), std::memory_order_release);
+
+            pHeader_->spaceSeq.fetch_add(1);
+            if (pHeader_->spaceWaiters.load())
+            {
+                FutexWake(pHeader_->spaceSeq);
+            }
+        }
+
+        // Waits until a frame is available, returns false on timeout (timeoutMs < 0 waits forever)
+        bool WaitData(int timeoutMs, bool busyPoll)
+        {
+            return Wait(pHeader_->dataSeq, pHeader_->dataWaiters, timeoutMs, busyPoll, [this]()
+            {
+                return pHeader_->tail.load(std::memory_order_relaxed) != pHeader_->head.load(std::memory_order_acquire);
+            });
+        }
+
+        // Waits until a frame of 'size' bytes can be reserved, returns false on timeout
+        bool WaitSpace(size_t size, int timeoutMs, bool busyPoll)
+        {
+            return Wait(pHeader_->spaceSeq, pHeader_->spaceWaiters, timeoutMs, busyPoll, [this, size]()
+            {
+                auto used = pHeader_->head.load(std::memory_order_relaxed) - pHeader_->tail.load(std::memory_order_acquire);
+
+                // Worst case includes padding at the end of the ring
+                return used + 2 * (sizeof(FrameHeader) + Align(size)) <= capacity_;
+            });
+        }
+
+    private:
+        template <typename Ready>
+        static bool Wait(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiters, int timeoutMs, bool busyPoll, Ready ready)
+        {
+            const unsigned spinCount = 4096;
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+            // Unsigned counter wraps around when busy polling forever
+            for (unsigned i = 0; busyPoll  ||  i < spinCount; i++)
+            {
+                if (ready())
+                    return true;
+
+                if (busyPoll  &&  timeoutMs >= 0  &&  !(i % spinCount)  &&  std::chrono::steady_clock::now() > deadline)
+                    return false;
+            }
+
+            while (true)
+            {
+                auto value = seq.load();
+
+                waiters.fetch_add(1);
+
+                if (ready())
+                {
+                    waiters.fetch_sub(1);
+                    return true;
+                }
+
+                int waitMs = -1;
+                if (timeoutMs >= 0)
+                {
+                    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    if (left <= 0)
+                    {
+                        waiters.fetch_sub(1);
+                        return false;
+                    }
+
+                    waitMs = (int)left;
+                }
+
+                FutexWait(seq, value, waitMs);
+
+                waiters.fetch_sub(1);
+            }
+        }
+
+    private:
+        Header* pHeader_ = nullptr;
+        char* pData_ = nullptr;
+        size_t capacity_ = 0;
+        size_t reservedPadding_ = 0;
+    };
+
+
+    // SharedMemoryChannel - shared memory region with request and reply rings.
+    // Created by server either with a name (POSIX shared memory, opened by client by name),
+    // or without a name (memfd, its descriptor 'Fd()' should be passed to client process, for instance inherited or sent via socket).
+    struct SharedMemoryChannel
+    {
+        enum FrameFlags { ReplyExpected = 1 };
+
+        // Creates channel
+        SharedMemoryChannel(const std::string& name, size_t capacity)
+            : name_(name)
+        {
+            capacity = SharedMemoryRing::AlignRegion(capacity);
+
+            if (name_.empty())
+            {
+                fd_ = memfd_create("RemoteCall", 0);
+            }
+            else
+            {
+                fd_ = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            }
+
+            if (-1 == fd_)
+                throw Exception(Exception::TransportError, ToString() << "Cannot create shared memory " << name_ << '.');
+
+            owner_ = true;
+
+            size_ = sizeof(Header) + 2 * SharedMemoryRing::RegionSize(capacity);
+
+            if (ftruncate(fd_, size_))
+                throw Exception(Exception::TransportError, ToString() << "Cannot resize shared memory " << name_ << '.');
+
+            Map(true, capacity);
+        }
+
+        // Opens channel created by server by name
+        explicit SharedMemoryChannel(const std::string& name)
+            : SharedMemoryChannel(shm_open(name.c_str(), O_RDWR, 0))
+        {}
+
+        // Opens channel created by server from descriptor
+        explicit SharedMemoryChannel(int fd)
+            : fd_(fd)
+        {
+            struct stat st;
+            if (-1 == fd_  ||  fstat(fd_, &st)  ||  st.st_size < (off_t)sizeof(Header))
+                throw Exception(Exception::TransportError, "Cannot open shared memory.");
+
+            size_ = st.st_size;
+
+            Map(false, 0);
+        }
+
+        ~SharedMemoryChannel()
+        {
+            if (pRegion_)
+            {
+                munmap(pRegion_, size_);
+            }
+
+            if (-1 != fd_)
+            {
+                close(fd_);
+            }
+
+            if (owner_  &&  !name_.empty())
+            {
+                shm_unlink(name_.c_str());
+            }
+        }
+
+        SharedMemoryChannel(const SharedMemoryChannel&) = delete;
+        void operator = (const SharedMemoryChannel&) = delete;
+
+        int Fd() const
+        {
+            return fd_;
+        }
+
+        SharedMemoryRing& Requests()
+        {
+            return requests_;
+        }
+
+        SharedMemoryRing& Replies()
+        {
+            return replies_;
+        }
+
+        // Writes frame to the ring, waiting for space if the reader is behind
+        static bool Write(SharedMemoryRing& ring, const std::vector<char>& v, uint32_t flags, uint64_t id, int timeoutMs, bool busyPoll)
+        {
+            iovec iov = { (void*)v.data(), v.size() };
+
+            return Write(ring, &iov, 1, flags, id, timeoutMs, busyPoll);
+        }
+
+        // Writes frame segments directly to the reserved place in the ring
+        static bool Write(SharedMemoryRing& ring, const iovec* pIov, size_t count, uint32_t flags, uint64_t id, int timeoutMs, bool busyPoll)
+        {
+            size_t size = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                size += pIov[i].iov_len;
+            }
+
+            if (size > ring.MaxFrameSize())
+                return false;
+
+            char* p = ring.Reserve(size);
+            if (!p)
+            {
+                if (!ring.WaitSpace(size, timeoutMs, busyPoll))
+                    return false;
+
+                p = ring.Reserve(size);
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                memcpy(p, pIov[i].iov_base, pIov[i].iov_len);
+                p += pIov[i].iov_len;
+            }
+
+            ring.Commit(size, flags, id);
+
+            return true;
+        }
+
+        // Reads frame from the ring, waiting for it if the ring is empty
+        static bool Read(SharedMemoryRing& ring, std::vector<char>& v, uint32_t& flags, uint64_t& id, int timeoutMs, bool busyPoll)
+        {
+            size_t size;
+            const char* p = ring.Peek(size, flags, id);
+            if (!p)
+            {
+                if (!ring.WaitData(timeoutMs, busyPoll))
+                    return false;
+
+                p = ring.Peek(size, flags, id);
+            }
+
+            v.assign(p, p + size);
+            ring.Release();
+
+            return true;
+        }
+
+    private:
+        // Padded to the alignment of the ring headers which follow it
+        struct alignas(alignof(SharedMemoryRing::Header)) Header
+        {
+            uint64_t magic;
+            uint64_t capacity;
+        };
+
+        static constexpr uint64_t Magic = 0x52656d6f746543ULL;
+
+        void Map(bool init, size_t capacity)
+        {
+            pRegion_ = (char*)mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+            if (MAP_FAILED == pRegion_)
+            {
+                pRegion_ = nullptr;
+                throw Exception(Exception::TransportError, "Cannot map shared memory.");
+            }
+
+            auto pHeader = (Header*)pRegion_;
+
+            if (init)
+            {
+                pHeader->capacity = capacity;
+            }
+            else
+            {
+                if (Magic != ((std::atomic<uint64_t>*)&pHeader->magic)->load(std::memory_order_acquire))
+                    throw Exception(Exception::TransportError, "Shared memory is not initialized.");
+
+                capacity = pHeader->capacity;
+
+                // Both rings should be inside the mapped region, it is checked before they are accessed
+                if (!capacity  ||  capacity != SharedMemoryRing::AlignRegion(capacity)  ||  capacity > size_  ||
+                    size_ < sizeof(Header) + 2 * SharedMemoryRing::RegionSize(capacity))
+                    throw Exception(Exception::TransportError, "Shared memory is smaller than its rings.");
+            }
+
+            char* pRings = pRegion_ + sizeof(Header);
+            requests_ = SharedMemoryRing(pRings, capacity, init);
+            replies_ = SharedMemoryRing(pRings + SharedMemoryRing::RegionSize(capacity), capacity, init);
+
+            if (init)
+            {
+                ((std::atomic<uint64_t>*)&pHeader->magic)->store(Magic, std::memory_order_release);
+            }
+        }
+
+    private:
+        std::string name_;
+        int fd_ = -1;
+        bool owner_ = false;
+        size_t size_ = 0;
+        char* pRegion_ = nullptr;
+        SharedMemoryRing requests_;
+        SharedMemoryRing replies_;
+    };
+
+
+    // SharedMemoryTransport - client transport over SharedMemoryChannel.
+    // One channel serves one client process, calls from several threads are serialized.
+    // Each request has an id which server copies to its reply, a late reply to a call which timed out is dropped by the next call.
+    struct SharedMemoryTransport: public Transport<SharedMemoryTransport>
+    {
+        // timeoutMs - reply timeout (< 0 waits forever), busyPoll - spin instead of sleeping on futex (lowest latency, burns a core)
+        SharedMemoryTransport(const std::string& name, int timeoutMs = -1, bool busyPoll = false)
+            : channel_(name), timeoutMs_(timeoutMs), busyPoll_(busyPoll)
+        {}
+
+        SharedMemoryTransport(int fd, int timeoutMs = -1, bool busyPoll = false)
+            : channel_(fd), timeoutMs_(timeoutMs), busyPoll_(busyPoll)
+        {}
+
+        bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+        {
+            iovec iov = { (void*)vIn.data(), vIn.size() };
+
+            return SendReceiveV(&iov, 1, vOut);
+        }
+
+        // Frame segments, including arguments referenced in place, are copied once, directly to the ring
+        bool SendReceiveV(const iovec* pIov, size_t count, std::vector<char>& vOut)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            auto id = ++lastId_;
+
+            if (!SharedMemoryChannel::Write(channel_.Requests(), pIov, count, SharedMemoryChannel::ReplyExpected, id, timeoutMs_, busyPoll_))
+                return false;
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs_);
+
+            while (true)
+            {
+                int timeoutMs = timeoutMs_;
+                if (timeoutMs_ >= 0)
+                {
+                    timeoutMs = (int)std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count());
+                }
+
+                uint32_t flags;
+                uint64_t replyId;
+                if (!SharedMemoryChannel::Read(channel_.Replies(), vOut, flags, replyId, timeoutMs, busyPoll_))
+                    return false;
+
+                if (replyId == id)
+                    return true;
+            }
+        }
+
+    private:
+        SharedMemoryChannel channel_;
+        int timeoutMs_;
+        bool busyPoll_;
+        uint64_t lastId_ = 0;
+        std::mutex locker_;
+    };
+
+
+    // SharedMemoryServer - creates channel and serves requests from it via ProcessCall
+    struct SharedMemoryServer
+    {
+        // name - POSIX shared memory name ("/name"), or empty for memfd
+        SharedMemoryServer(const std::string& name, size_t capacity = 4 * 1024 * 1024, bool busyPoll = false)
+            : channel_(name, capacity), busyPoll_(busyPoll)
+        {}
+
+        SharedMemoryChannel& Channel()
+        {
+            return channel_;
+        }
+
+        // Processes one request, returns false if there was no request during timeoutMs
+        bool ProcessOne(int timeoutMs = -1)
+        {
+            uint32_t flags;
+            uint64_t id;
+            if (!SharedMemoryChannel::Read(channel_.Requests(), vIn_, flags, id, timeoutMs, busyPoll_))
+                return false;
+
+            vOut_.clear();
+            ProcessCall(vIn_, vOut_);
+
+            if (flags & SharedMemoryChannel::ReplyExpected)
+            {
+                SharedMemoryChannel::Write(channel_.Replies(), vOut_, 0, id, -1, busyPoll_);
+            }
+
+            return true;
+        }
+
+        // Serves requests until 'stop' is set, 'stop' is checked at least every pollMs
+        void Run(const std::atomic<bool>& stop, int pollMs = 100)
+        {
+            while (!stop)
+            {
+                ProcessOne(pollMs);
+            }
+        }
+
+    private:
+        SharedMemoryChannel channel_;
+        bool busyPoll_;
+        std::vector<char> vIn_;
+        std::vector<char> vOut_;
+    };
+}
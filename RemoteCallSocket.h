@@ -0,0 +1,1216 @@
+// Socket transports (Linux): io_uring or epoll based server and client transport over TCP or Unix domain sockets.
+// Frame on the wire is 4 bytes data length followed by data passed to ProcessCall or returned by it.
+
+#pragma once
+
+#include "RemoteCallClient.h"
+#include "RemoteCallServer.h"
+#include "RemoteCallUring.h"
+#include "RemoteCallSharedBlob.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace RemoteCall
+{
+    typedef uint32_t FrameLength;
+
+    // SocketAddress - "unix:/path" or "/path" for Unix domain socket, "host:port" for TCP
+    struct SocketAddress
+    {
+        explicit SocketAddress(const std::string& address)
+        {
+            std::string path = 0 == address.compare(0, 5, "unix:")? address.substr(5): address;
+
+            if (!path.empty()  &&  '/' == path[0])
+            {
+                sockaddr_un un = {};
+                if (path.size() >= sizeof(un.sun_path))
+                    throw Exception(Exception::TransportError, ToString() << "Invalid address " << address << '.');
+
+                un.sun_family = AF_UNIX;
+                memcpy(un.sun_path, path.c_str(), path.size() + 1);
+
+                memcpy(&addr_, &un, sizeof(un));
+                len_ = sizeof(un);
+                path_ = path;
+
+                return;
+            }
+
+            auto pos = address.rfind(':');
+            if (std::string::npos == pos)
+                throw Exception(Exception::TransportError, ToString() << "Invalid address " << address << '.');
+
+            std::string host = address.substr(0, pos);
+            std::string port = address.substr(pos + 1);
+
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            hints.ai_flags = AI_PASSIVE;
+
+            addrinfo* pInfo = nullptr;
+            if (getaddrinfo(host.empty()? nullptr: host.c_str(), port.c_str(), &hints, &pInfo)  ||  !pInfo)
+                throw Exception(Exception::TransportError, ToString() << "Cannot resolve address " << address << '.');
+
+            memcpy(&addr_, pInfo->ai_addr, pInfo->ai_addrlen);
+            len_ = pInfo->ai_addrlen;
+
+            freeaddrinfo(pInfo);
+        }
+
+        int Family() const
+        {
+            return addr_.ss_family;
+        }
+
+        const sockaddr* Addr() const
+        {
+            return (const sockaddr*)&addr_;
+        }
+
+        socklen_t Length() const
+        {
+            return len_;
+        }
+
+        const std::string& Path() const
+        {
+            return path_;
+        }
+
+    private:
+        sockaddr_storage addr_ = {};
+        socklen_t len_ = 0;
+        std::string path_;
+    };
+
+
+    // Writes all iovecs, retrying on partial writes (blocking socket), 'sent' is set to number of bytes written
+    inline bool SendAll(int fd, iovec* pIov, int count, size_t& sent)
+    {
+        sent = 0;
+
+        while (count)
+        {
+            msghdr msg = {};
+            msg.msg_iov = pIov;
+            msg.msg_iovlen = count < IOV_MAX? count: IOV_MAX;
+
+            auto n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (n < 0)
+            {
+                if (EINTR == errno)
+                    continue;
+
+                return false;
+            }
+
+            sent += n;
+
+            while (count  &&  (size_t)n >= pIov->iov_len)
+            {
+                n -= pIov->iov_len;
+                pIov++;
+                count--;
+            }
+
+            if (count)
+            {
+                pIov->iov_base = (char*)pIov->iov_base + n;
+                pIov->iov_len -= n;
+            }
+        }
+
+        return true;
+    }
+
+    // Reads exactly 'size' bytes (blocking socket), 'received' is set to number of bytes read
+    inline bool ReceiveAll(int fd, char* p, size_t size, size_t& received)
+    {
+        received = 0;
+
+        while (received < size)
+        {
+            auto n = recv(fd, p + received, size - received, 0);
+            if (n <= 0)
+            {
+                if (n < 0  &&  EINTR == errno)
+                    continue;
+
+                return false;
+            }
+
+            received += n;
+        }
+
+        return true;
+    }
+
+
+    // SocketTransport - client transport, connections are reused between calls and created on demand for concurrent calls.
+    // A call is resent on a new connection only if a reused connection failed before any byte of the frame was written,
+    // or if the call has idempotency key and its connection was closed without reply (not on timeout).
+    struct SocketTransport: public Transport<SocketTransport>
+    {
+        // timeoutMs - send/receive timeout (< 0 waits forever)
+        SocketTransport(const std::string& address, int timeoutMs = -1)
+            : address_(address), timeoutMs_(timeoutMs)
+        {}
+
+        ~SocketTransport()
+        {
+            for (auto fd: idle_)
+            {
+                close(fd);
+            }
+        }
+
+        SocketTransport(const SocketTransport&) = delete;
+        void operator = (const SocketTransport&) = delete;
+
+        bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+        {
+            iovec iov = { (void*)vIn.data(), vIn.size() };
+
+            return SendReceiveV(&iov, 1, vOut);
+        }
+
+        // Length prefix and frame segments are sent by one gather write
+        bool SendReceiveV(const iovec* pIov, size_t count, std::vector<char>& vOut)
+        {
+            FrameLength requestLength = 0;
+
+            std::vector<iovec> iov(1 + count);
+            for (size_t i = 0; i < count; i++)
+            {
+                requestLength += (FrameLength)pIov[i].iov_len;
+                iov[1 + i] = pIov[i];
+            }
+
+            bool idempotent = !!(FrameFlagsOf(pIov, count) & HasIdempotencyKey);
+
+            for (int attempt = 0; attempt < 2; attempt++)
+            {
+                bool reused;
+                int fd = Acquire(reused);
+                if (-1 == fd)
+                    return false;
+
+                iov[0] = iovec{ &requestLength, sizeof(requestLength) };
+
+                // SendAll modifies iovecs on partial write
+                auto iovSend = iov;
+
+                FrameLength length;
+                size_t sent = 0;
+                size_t received = 0;
+                bool timedOut = false;
+
+                if (SendAll(fd, iovSend.data(), (int)iovSend.size(), sent))
+                {
+                    if (ReceiveAll(fd, (char*)&length, sizeof(length), received))
+                    {
+                        size_t receivedData;
+
+                        if (length <= maxFrameSize_)
+                        {
+                            vOut.resize(length);
+                            if (ReceiveAll(fd, vOut.data(), length, receivedData))
+                            {
+                                Release(fd);
+                                return true;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        timedOut = EAGAIN == errno  ||  EWOULDBLOCK == errno;
+                    }
+                }
+
+                close(fd);
+
+                // Pooled connection closed by server before the request was sent, or server which closed the connection 
+                // without reply executes the call once for its idempotency key, otherwise the call could be executed twice
+                if (!reused  ||  received  ||  (sent  &&  (!idempotent  ||  timedOut)))
+                    return false;
+            }
+
+            return false;
+        }
+
+        // Maximal accepted reply size, connection receiving bigger reply is closed and the call fails
+        void SetMaxFrameSize(size_t maxFrameSize)
+        {
+            maxFrameSize_ = maxFrameSize;
+        }
+
+    private:
+        static uint16_t FrameFlagsOf(const iovec* pIov, size_t count)
+        {
+            char prefix[FramePrefixSize];
+            size_t size = 0;
+
+            for (size_t i = 0; i < count  &&  size < sizeof(prefix); i++)
+            {
+                auto n = std::min(pIov[i].iov_len, sizeof(prefix) - size);
+                memcpy(prefix + size, pIov[i].iov_base, n);
+                size += n;
+            }
+
+            uint16_t flags = 0;
+            if (size == sizeof(prefix)  &&  FrameMagic == (uint8_t)prefix[0])
+            {
+                memcpy(&flags, prefix + FrameFlagsOffset, sizeof(flags));
+            }
+
+            return flags;
+        }
+
+        int Acquire(bool& reused)
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (!idle_.empty())
+                {
+                    int fd = idle_.back();
+                    idle_.pop_back();
+
+                    reused = true;
+                    return fd;
+                }
+            }
+
+            reused = false;
+
+            int fd = socket(address_.Family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (-1 == fd)
+                return -1;
+
+            if (timeoutMs_ >= 0)
+            {
+                timeval tv = { timeoutMs_ / 1000, (timeoutMs_ % 1000) * 1000 };
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+            }
+
+            if (AF_UNIX != address_.Family())
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+
+            if (connect(fd, address_.Addr(), address_.Length()))
+            {
+                close(fd);
+                return -1;
+            }
+
+            return fd;
+        }
+
+        void Release(int fd)
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            idle_.push_back(fd);
+        }
+
+    private:
+        SocketAddress address_;
+        int timeoutMs_;
+        size_t maxFrameSize_ = 64 * 1024 * 1024;
+        std::vector<int> idle_;
+        std::mutex locker_;
+    };
+
+
+    // SocketServer - non-blocking server multiplexing connections via io_uring, or via epoll if io_uring is not available.
+    // Complete frames are processed by 'handler' (ProcessCall by default) in the event loop, or in a pool of 'workers' threads.
+    // Frames of one connection are processed in order, one at a time. By default a thread is not blocked by handler 
+    // returning Async, the reply is sent when its result is ready.
+    struct SocketServer
+    {
+        typedef std::function<void(const std::vector<char>& vIn, std::vector<char>& vOut)> Handler;
+
+        enum Engine { Auto, Epoll, IoUring };
+
+        SocketServer(const std::string& address, int workers = 0, Handler handler = Handler(), Engine engine = Auto)
+            : address_(address), pReplies_(std::make_shared<Replies>())
+        {
+            if (handler)
+            {
+                handler_ = [handler](const std::vector<char>& vIn, const Completion& completion) 
+                { 
+                    std::vector<char> vOut;
+                    handler(vIn, vOut);
+
+                    completion(std::move(vOut));
+                };
+            }
+            else
+            {
+                handler_ = [](const std::vector<char>& vIn, const Completion& completion) { ProcessCall(vIn, completion); };
+            }
+
+            listen_ = socket(address_.Family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+            int one = 1;
+            setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+            if (!address_.Path().empty())
+            {
+                unlink(address_.Path().c_str());
+            }
+
+            if (-1 == listen_  ||  bind(listen_, address_.Addr(), address_.Length())  ||  listen(listen_, SOMAXCONN))
+            {
+                Close();
+                throw Exception(Exception::TransportError, ToString() << "Cannot listen on " << address << '.');
+            }
+
+            if (Epoll != engine)
+            {
+                pUring_.reset(new Uring);
+
+                if (!pUring_->Init(UringEntries)  ||  !pUring_->InitBuffers(UringBufferCount, UringBufferSize, 0))
+                {
+                    pUring_.reset();
+                }
+            }
+
+            if (pUring_)
+            {
+                // io_uring doesn't wait on non-blocking descriptors, it completes with EAGAIN
+                fcntl(listen_, F_SETFL, fcntl(listen_, F_GETFL) & ~O_NONBLOCK);
+
+                event_ = eventfd(0, EFD_CLOEXEC);
+            }
+            else
+            {
+                event_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                epoll_ = epoll_create1(EPOLL_CLOEXEC);
+
+                Watch(listen_, ListenId, EPOLLIN, EPOLL_CTL_ADD);
+                Watch(event_, EventId, EPOLLIN, EPOLL_CTL_ADD);
+            }
+
+            pReplies_->event_ = event_;
+
+            for (int i = 0; i < workers; i++)
+            {
+                workers_.emplace_back([this]() { Work(); });
+            }
+        }
+
+        ~SocketServer()
+        {
+            Stop();
+
+            // Replies completed later are dropped
+            {
+                std::lock_guard<std::mutex> lock(pReplies_->locker_);
+                pReplies_->event_ = -1;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+                stopWorkers_ = true;
+            }
+            tasksReady_.notify_all();
+
+            for (auto& worker: workers_)
+            {
+                worker.join();
+            }
+
+            // Ring is closed first, it cancels pending operations which reference connections
+            pUring_.reset();
+
+            for (auto& el: connections_)
+            {
+                close(el.second->fd);
+            }
+
+            Close();
+        }
+
+        SocketServer(const SocketServer&) = delete;
+        void operator = (const SocketServer&) = delete;
+
+        // True if io_uring is used, false if epoll
+        bool UsesUring() const
+        {
+            return !!pUring_;
+        }
+
+        // False if kernel rejected multishot receive of io_uring, receive is submitted again after each completion
+        bool UsesMultishotReceive() const
+        {
+            return pUring_  &&  uringMultishot_;
+        }
+
+        // Runs event loop until Stop is called
+        void Run()
+        {
+            if (pUring_)
+            {
+                RunUring();
+            }
+            else
+            {
+                RunEpoll();
+            }
+        }
+
+        // Can be called from any thread
+        void Stop()
+        {
+            stop_ = true;
+
+            uint64_t value = 1;
+            if (-1 != event_  &&  write(event_, &value, sizeof(value))) {}
+        }
+
+        // Maximal accepted frame size, connection sending bigger frame is closed. It also limits buffers of a connection: its frames
+        // are not processed while its unsent replies exceed it, the connection is closed if its waiting frames exceed it.
+        void SetMaxFrameSize(size_t maxFrameSize)
+        {
+            maxFrameSize_ = maxFrameSize;
+        }
+
+    private:
+        enum { ListenId = 1, EventId = 2 };
+
+        enum { UringEntries = 4096, UringBufferCount = 1024, UringBufferSize = 16 * 1024 };
+
+        // Operation kind in the low bits of io_uring user data, connection id in the high bits
+        enum { AcceptOp, ReceiveOp, SendOp, EventOp, OpBits = 2 };
+
+        struct Connection
+        {
+            uint64_t id;
+            int fd;
+            pid_t peerPid = 0;
+            std::vector<char> in;
+            std::deque<std::vector<char>> requests;
+            std::deque<std::vector<char>> replies;
+            size_t requestsSize = 0;
+            size_t repliesSize = 0;
+            size_t replyOffset = 0;
+            bool busy = false;
+            bool writing = false;
+            bool closed = false;
+
+            // io_uring: operations in flight and send arguments, which should be valid until completion
+            bool receiving = false;
+            bool sending = false;
+            msghdr msg;
+            iovec iov[64];
+        };
+
+        void RunEpoll()
+        {
+            epoll_event events[256];
+
+            while (!stop_)
+            {
+                int count = epoll_wait(epoll_, events, 256, -1);
+
+                for (int i = 0; i < count; i++)
+                {
+                    auto id = events[i].data.u64;
+
+                    if (ListenId == id)
+                    {
+                        Accept();
+                    }
+                    else if (EventId == id)
+                    {
+                        uint64_t value;
+                        while (read(event_, &value, sizeof(value)) > 0) {}
+
+                        Complete();
+                    }
+                    else
+                    {
+                        auto pConnection = Find(id);
+                        if (!pConnection)
+                            continue;
+
+                        if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                        {
+                            Receive(pConnection);
+                        }
+
+                        if (!pConnection->closed  &&  (events[i].events & EPOLLOUT))
+                        {
+                            Flush(pConnection);
+                            Dispatch(pConnection);
+                        }
+
+                        if (pConnection->closed  &&  pConnection->busy)
+                        {
+                            // Removed when worker completes
+                            Watch(pConnection->fd, pConnection->id, 0, EPOLL_CTL_MOD);
+                        }
+
+                        RemoveIfClosed(pConnection);
+                    }
+                }
+            }
+        }
+
+        // All operations are queued and submitted in one system call per loop iteration,
+        // multishot accept and receive stay armed, received data is placed by kernel to registered buffers
+        void RunUring()
+        {
+            SubmitAccept();
+            SubmitEventRead();
+
+            while (!stop_)
+            {
+                pUring_->Submit(1);
+
+                pUring_->ForEachCqe([this](const io_uring_cqe& cqe)
+                {
+                    auto id = cqe.user_data >> OpBits;
+                    bool more = !!(cqe.flags & IORING_CQE_F_MORE);
+
+                    switch (cqe.user_data & ((1 << OpBits) - 1))
+                    {
+                    case AcceptOp:
+                        if (cqe.res >= 0)
+                        {
+                            AddConnection(cqe.res);
+                        }
+
+                        if (!more  &&  !stop_)
+                        {
+                            SubmitAccept();
+                        }
+                        break;
+
+                    case EventOp:
+                        Complete();
+
+                        if (!stop_)
+                        {
+                            SubmitEventRead();
+                        }
+                        break;
+
+                    case ReceiveOp:
+                        if (auto pConnection = Find(id))
+                        {
+                            OnUringReceive(pConnection, cqe, more);
+                        }
+                        break;
+
+                    case SendOp:
+                        if (auto pConnection = Find(id))
+                        {
+                            pConnection->sending = false;
+
+                            if (cqe.res < 0)
+                            {
+                                pConnection->closed = true;
+                            }
+                            else
+                            {
+                                Consume(pConnection, cqe.res);
+                                Flush(pConnection);
+                                Dispatch(pConnection);
+                            }
+
+                            Shutdown(pConnection);
+                        }
+                        break;
+                    }
+                });
+            }
+        }
+
+        void OnUringReceive(Connection* pConnection, const io_uring_cqe& cqe, bool more)
+        {
+            if (!more)
+            {
+                pConnection->receiving = false;
+            }
+
+            if (cqe.flags & IORING_CQE_F_BUFFER)
+            {
+                unsigned bufferId = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+                if (cqe.res > 0  &&  !pConnection->closed)
+                {
+                    OnReceived(pConnection, pUring_->Buffer(bufferId), cqe.res);
+                }
+
+                pUring_->RecycleBuffer(bufferId);
+            }
+
+            if (0 == cqe.res  ||  (cqe.res < 0  &&  -ENOBUFS != cqe.res  &&  -EINVAL != cqe.res))
+            {
+                pConnection->closed = true;
+            }
+            else if (-EINVAL == cqe.res)
+            {
+                // Kernel without multishot receive
+                if (!uringMultishot_)
+                {
+                    pConnection->closed = true;
+                }
+
+                uringMultishot_ = false;
+            }
+
+            if (!pConnection->receiving  &&  !pConnection->closed)
+            {
+                SubmitReceive(pConnection);
+            }
+
+            Shutdown(pConnection);
+        }
+
+        void SubmitAccept()
+        {
+            auto pSqe = pUring_->GetSqe();
+            pSqe->opcode = IORING_OP_ACCEPT;
+            pSqe->fd = listen_;
+            pSqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            pSqe->accept_flags = SOCK_CLOEXEC;
+            pSqe->user_data = AcceptOp;
+        }
+
+        void SubmitEventRead()
+        {
+            auto pSqe = pUring_->GetSqe();
+            pSqe->opcode = IORING_OP_READ;
+            pSqe->fd = event_;
+            pSqe->addr = (uint64_t)&eventValue_;
+            pSqe->len = sizeof(eventValue_);
+            pSqe->user_data = EventOp;
+        }
+
+        void SubmitReceive(Connection* pConnection)
+        {
+            auto pSqe = pUring_->GetSqe();
+            pSqe->opcode = IORING_OP_RECV;
+            pSqe->fd = pConnection->fd;
+            pSqe->ioprio = uringMultishot_? IORING_RECV_MULTISHOT: 0;
+
+            // Kernel rejects multishot receive waiting for all data with EINVAL, as it rejects multishot flag it does not know
+            if (uringMultishot_  &&  !GetUringSupport().multishotReceive_)
+            {
+                pSqe->msg_flags = MSG_WAITALL;
+            }
+
+            pSqe->flags = IOSQE_BUFFER_SELECT;
+            pSqe->buf_group = pUring_->BufferGroup();
+            pSqe->user_data = (pConnection->id << OpBits) | ReceiveOp;
+
+            pConnection->receiving = true;
+        }
+
+        void SubmitSend(Connection* pConnection)
+        {
+            int count = Gather(pConnection, pConnection->iov);
+
+            pConnection->msg = msghdr();
+            pConnection->msg.msg_iov = pConnection->iov;
+            pConnection->msg.msg_iovlen = count;
+
+            auto pSqe = pUring_->GetSqe();
+            pSqe->opcode = IORING_OP_SENDMSG;
+            pSqe->fd = pConnection->fd;
+            pSqe->addr = (uint64_t)&pConnection->msg;
+            pSqe->msg_flags = MSG_NOSIGNAL;
+            pSqe->user_data = (pConnection->id << OpBits) | SendOp;
+
+            pConnection->sending = true;
+        }
+
+        // Closed connection with receive in flight is shut down to complete the receive, it is removed when nothing is in flight
+        void Shutdown(Connection* pConnection)
+        {
+            if (pConnection->closed  &&  pConnection->receiving)
+            {
+                shutdown(pConnection->fd, SHUT_RDWR);
+            }
+
+            RemoveIfClosed(pConnection);
+        }
+
+        void Watch(int fd, uint64_t id, uint32_t events, int op)
+        {
+            epoll_event ev = {};
+            ev.events = events;
+            ev.data.u64 = id;
+
+            epoll_ctl(epoll_, op, fd, &ev);
+        }
+
+        Connection* Find(uint64_t id)
+        {
+            auto it = connections_.find(id);
+
+            return connections_.end() == it? nullptr: it->second.get();
+        }
+
+        void Accept()
+        {
+            while (true)
+            {
+                int fd = accept4(listen_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (-1 == fd)
+                    return;
+
+                AddConnection(fd);
+            }
+        }
+
+        void AddConnection(int fd)
+        {
+            if (AF_UNIX != address_.Family())
+            {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+
+            std::unique_ptr<Connection> pConnection(new Connection);
+            pConnection->id = nextId_++;
+            pConnection->fd = fd;
+
+            // Client process, SharedBlob parameters are mapped only from it
+            ucred credentials = {};
+            socklen_t length = sizeof(credentials);
+            if (AF_UNIX == address_.Family()  &&  !getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length))
+            {
+                pConnection->peerPid = credentials.pid;
+            }
+
+            if (pUring_)
+            {
+                SubmitReceive(pConnection.get());
+            }
+            else
+            {
+                Watch(fd, pConnection->id, EPOLLIN, EPOLL_CTL_ADD);
+            }
+
+            connections_.insert(std::make_pair(pConnection->id, std::move(pConnection)));
+        }
+
+        void Receive(Connection* pConnection)
+        {
+            const size_t readSize = 64 * 1024;
+
+            auto& in = pConnection->in;
+
+            // Received data is split to frames after each read, so a connection buffers at most one frame
+            while (!pConnection->closed)
+            {
+                auto used = in.size();
+                in.resize(used + readSize);
+
+                auto n = recv(pConnection->fd, in.data() + used, readSize, 0);
+
+                in.resize(used + (n > 0? n: 0));
+
+                if (n > 0)
+                {
+                    OnReceived(pConnection, nullptr, 0);
+                    continue;
+                }
+
+                if (0 == n  ||  (EAGAIN != errno  &&  EWOULDBLOCK != errno  &&  EINTR != errno))
+                {
+                    pConnection->closed = true;
+                }
+
+                break;
+            }
+        }
+
+        // Appends received data and splits it to frames
+        void OnReceived(Connection* pConnection, const char* p, size_t size)
+        {
+            auto& in = pConnection->in;
+            in.insert(in.end(), p, p + size);
+
+            size_t pos = 0;
+
+            while (in.size() - pos >= sizeof(FrameLength))
+            {
+                FrameLength length;
+                memcpy(&length, in.data() + pos, sizeof(length));
+
+                if (length > maxFrameSize_)
+                {
+                    pConnection->closed = true;
+                    break;
+                }
+
+                if (in.size() - pos - sizeof(length) < length)
+                    break;
+
+                // Client which sends frames without reading replies
+                pConnection->requestsSize += length;
+                if (pConnection->requestsSize > maxFrameSize_)
+                {
+                    pConnection->closed = true;
+                    break;
+                }
+
+                auto pFrame = in.data() + pos + sizeof(length);
+                pConnection->requests.emplace_back(pFrame, pFrame + length);
+
+                pos += sizeof(length) + length;
+            }
+
+            in.erase(in.begin(), in.begin() + pos);
+
+            Dispatch(pConnection);
+        }
+
+        void Dispatch(Connection* pConnection)
+        {
+            while (!pConnection->busy  &&  !pConnection->closed  &&  !pConnection->requests.empty()  &&  pConnection->repliesSize <= maxFrameSize_)
+            {
+                std::vector<char> vIn = std::move(pConnection->requests.front());
+                pConnection->requests.pop_front();
+
+                pConnection->requestsSize -= vIn.size();
+
+                pConnection->busy = true;
+
+                if (workers_.empty())
+                {
+                    std::vector<char> vOut;
+                    if (Process(pConnection, vIn, vOut))
+                    {
+                        pConnection->busy = false;
+
+                        Reply(pConnection, std::move(vOut));
+                    }
+                }
+                else
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(locker_);
+                        tasks_.push_back(Task{ pConnection->id, pConnection->peerPid, std::move(vIn) });
+                    }
+                    tasksReady_.notify_one();
+                }
+            }
+        }
+
+        void Reply(Connection* pConnection, std::vector<char>&& vOut)
+        {
+            FrameLength length = (FrameLength)vOut.size();
+
+            pConnection->repliesSize += sizeof(length) + vOut.size();
+
+            pConnection->replies.emplace_back((char*)&length, (char*)&length + sizeof(length));
+            pConnection->replies.emplace_back(std::move(vOut));
+
+            Flush(pConnection);
+        }
+
+        // Fills iovecs with pending replies, returns number of iovecs
+        int Gather(Connection* pConnection, iovec (&iov)[64])
+        {
+            int count = 0;
+
+            for (auto it = pConnection->replies.begin(); it != pConnection->replies.end()  &&  count < 64; ++it, ++count)
+            {
+                size_t offset = count? 0: pConnection->replyOffset;
+
+                iov[count].iov_base = it->data() + offset;
+                iov[count].iov_len = it->size() - offset;
+            }
+
+            return count;
+        }
+
+        // Removes 'sent' bytes from pending replies
+        void Consume(Connection* pConnection, size_t sent)
+        {
+            auto& replies = pConnection->replies;
+
+            pConnection->repliesSize -= sent;
+
+            sent += pConnection->replyOffset;
+            while (!replies.empty()  &&  sent >= replies.front().size())
+            {
+                sent -= replies.front().size();
+                replies.pop_front();
+            }
+
+            pConnection->replyOffset = sent;
+        }
+
+        void Flush(Connection* pConnection)
+        {
+            if (pUring_)
+            {
+                if (!pConnection->sending  &&  !pConnection->closed  &&  !pConnection->replies.empty())
+                {
+                    SubmitSend(pConnection);
+                }
+
+                return;
+            }
+
+            while (!pConnection->replies.empty())
+            {
+                iovec iov[64];
+
+                msghdr msg = {};
+                msg.msg_iov = iov;
+                msg.msg_iovlen = Gather(pConnection, iov);
+
+                auto sent = sendmsg(pConnection->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+                if (sent < 0)
+                {
+                    if (EAGAIN != errno  &&  EWOULDBLOCK != errno  &&  EINTR != errno)
+                    {
+                        pConnection->closed = true;
+                        return;
+                    }
+
+                    break;
+                }
+
+                Consume(pConnection, sent);
+            }
+
+            bool writing = !pConnection->replies.empty();
+            if (writing != pConnection->writing)
+            {
+                pConnection->writing = writing;
+
+                Watch(pConnection->fd, pConnection->id, writing? EPOLLIN | EPOLLOUT: EPOLLIN, EPOLL_CTL_MOD);
+            }
+        }
+
+        void RemoveIfClosed(Connection* pConnection)
+        {
+            if (!pConnection->closed  ||  pConnection->busy  ||  pConnection->receiving  ||  pConnection->sending)
+                return;
+
+            if (-1 != epoll_)
+            {
+                epoll_ctl(epoll_, EPOLL_CTL_DEL, pConnection->fd, nullptr);
+            }
+
+            close(pConnection->fd);
+
+            connections_.erase(pConnection->id);
+        }
+
+        // Worker thread
+        void Work()
+        {
+            while (true)
+            {
+                Task task;
+
+                {
+                    std::unique_lock<std::mutex> lock(locker_);
+                    tasksReady_.wait(lock, [this]() { return stopWorkers_  ||  !tasks_.empty(); });
+
+                    if (tasks_.empty())
+                        return;
+
+                    task = std::move(tasks_.front());
+                    tasks_.pop_front();
+                }
+
+                auto pReplies = pReplies_;
+                auto id = task.id;
+
+                PeerScope scope(task.peerPid);
+
+                handler_(task.vIn, [pReplies, id](std::vector<char>&& vOut) { pReplies->Add(id, std::move(vOut)); });
+            }
+        }
+
+        // Processes frame in the event loop, returns true if its reply is ready when the handler returns, 
+        // otherwise the reply is added to completed replies later
+        bool Process(Connection* pConnection, const std::vector<char>& vIn, std::vector<char>& vOut)
+        {
+            struct Inline
+            {
+                bool returned_ = false;
+                bool done_ = false;
+                std::vector<char> vOut_;
+                std::mutex locker_;
+            };
+
+            auto pInline = std::make_shared<Inline>();
+            auto pReplies = pReplies_;
+            auto id = pConnection->id;
+
+            PeerScope scope(pConnection->peerPid);
+
+            handler_(vIn, [pInline, pReplies, id](std::vector<char>&& vOut) 
+            { 
+                std::lock_guard<std::mutex> lock(pInline->locker_);
+
+                if (pInline->returned_)
+                {
+                    pReplies->Add(id, std::move(vOut));
+                }
+                else
+                {
+                    pInline->vOut_ = std::move(vOut);
+                    pInline->done_ = true;
+                }
+            });
+
+            std::lock_guard<std::mutex> lock(pInline->locker_);
+
+            pInline->returned_ = true;
+
+            if (!pInline->done_)
+                return false;
+
+            vOut = std::move(pInline->vOut_);
+
+            return true;
+        }
+
+        // Sends replies of frames processed by workers, or completed later
+        void Complete()
+        {
+            std::deque<std::pair<uint64_t, std::vector<char>>> completed;
+
+            {
+                std::lock_guard<std::mutex> lock(pReplies_->locker_);
+                completed.swap(pReplies_->completed_);
+            }
+
+            for (auto& el: completed)
+            {
+                auto pConnection = Find(el.first);
+                if (!pConnection)
+                    continue;
+
+                pConnection->busy = false;
+
+                if (!pConnection->closed)
+                {
+                    Reply(pConnection, std::move(el.second));
+                    Dispatch(pConnection);
+                }
+
+                if (pUring_)
+                {
+                    Shutdown(pConnection);
+                }
+                else
+                {
+                    RemoveIfClosed(pConnection);
+                }
+            }
+        }
+
+        void Close()
+        {
+            for (int* pFd: { &listen_, &epoll_, &event_ })
+            {
+                if (-1 != *pFd)
+                {
+                    close(*pFd);
+                    *pFd = -1;
+                }
+            }
+
+            if (!address_.Path().empty())
+            {
+                unlink(address_.Path().c_str());
+            }
+        }
+
+    private:
+        typedef std::function<void(const std::vector<char>& vIn, const Completion& completion)> AsyncHandler;
+
+        // Replies of processed frames, shared with completions of Async results which can outlive the server
+        struct Replies
+        {
+            void Add(uint64_t id, std::vector<char>&& vOut)
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (-1 == event_)
+                    return;
+
+                completed_.emplace_back(id, std::move(vOut));
+
+                uint64_t value = 1;
+                if (write(event_, &value, sizeof(value))) {}
+            }
+
+            std::deque<std::pair<uint64_t, std::vector<char>>> completed_;
+            int event_ = -1;
+            std::mutex locker_;
+        };
+
+        SocketAddress address_;
+        AsyncHandler handler_;
+        std::shared_ptr<Replies> pReplies_;
+        size_t maxFrameSize_ = 64 * 1024 * 1024;
+
+        int listen_ = -1;
+        int epoll_ = -1;
+        int event_ = -1;
+        std::atomic<bool> stop_{false};
+
+        std::unique_ptr<Uring> pUring_;
+        bool uringMultishot_ = true;
+        uint64_t eventValue_ = 0;
+
+        uint64_t nextId_ = EventId + 1;
+        std::map<uint64_t, std::unique_ptr<Connection>> connections_;
+
+        std::vector<std::thread> workers_;
+        // Frame processed by worker
+        struct Task
+        {
+            uint64_t id;
+            pid_t peerPid;
+            std::vector<char> vIn;
+        };
+
+        std::deque<Task> tasks_;
+        bool stopWorkers_ = false;
+        std::mutex locker_;
+        std::condition_variable tasksReady_;
+    };
+}
@@ -0,0 +1,493 @@
+// Stream<T> - return type for big results: server produces items on demand, client iterates them,
+// items are transferred in chunks, each chunk is requested by client with credits (maximum number of items).
+// InputStream<T> - parameter type for big inputs: client produces items, server handler reads them while they are received.
+
+#pragma once
+
+#include "RemoteCallClient.h"
+#include "RemoteCallServer.h"
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <functional>
+#include <iterator>
+#include <deque>
+#include <condition_variable>
+
+namespace RemoteCall
+{
+    // StreamProducer - calls producer for each item of the chunk
+    template <typename T>
+    struct StreamProducer: public StreamSource
+    {
+        StreamProducer(const std::function<bool(T&)>& produce, size_t chunkSize)
+            : produce_(produce), chunkSize_(chunkSize)
+        {}
+
+        bool WriteChunk(Serializer& writer, size_t credits) override
+        {
+            std::lock_guard<std::mutex> lock(locker_);
+
+            items_.clear();
+
+            size_t count = credits < chunkSize_? credits: chunkSize_;
+            while (!end_  &&  items_.size() < count)
+            {
+                T t;
+                if (produce_(t))
+                {
+                    items_.push_back(std::move(t));
+                }
+                else
+                {
+                    end_ = true;
+                }
+            }
+
+            // Items are valid until the next chunk, after the frame is sent
+            writer.WriteRef(items_);
+            writer << end_;
+
+            return end_;
+        }
+
+        size_t ChunkSize() const
+        {
+            return chunkSize_;
+        }
+
+    private:
+        std::function<bool(T&)> produce_;
+        size_t chunkSize_;
+        std::vector<T> items_;
+        bool end_ = false;
+        std::mutex locker_;
+    };
+
+
+
+    // StreamChunk - items and end flag received by client
+    template <typename T>
+    struct StreamChunk
+    {
+        std::vector<T> items_;
+        bool end_ = true;
+    };
+
+    template <typename T>
+    Serializer& operator >> (Serializer& reader, StreamChunk<T>& chunk)
+    {
+        return reader >> chunk.items_ >> chunk.end_;
+    }
+
+
+    // StreamIterator - input iterator of Stream or InputStream
+    template <typename S, typename T>
+    struct StreamIterator
+    {
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        S* pStream_;
+        T t_;
+
+        T& operator * () { return t_; }
+        T* operator -> () { return &t_; }
+
+        StreamIterator& operator ++ ()
+        {
+            if (!pStream_->Next(t_))
+            {
+                pStream_ = nullptr;
+            }
+
+            return *this;
+        }
+
+        bool operator != (const StreamIterator& it) const
+        {
+            return pStream_ != it.pStream_;
+        }
+    };
+
+
+    // Stream
+    //
+    // Server returns stream with a producer which is called for each item, it returns false when there are no more items:
+    //     return RemoteCall::Stream<Row>([pCursor](Row& row) { return pCursor->Next(row); });
+    // The first chunk is sent in the reply, the rest is produced when client requests it.
+    //
+    // Client iterates items via 'Next' or range-based for, next chunk is requested when received items are consumed.
+    // Transport used for the call should be valid while the stream is read.
+    // If stream is destroyed before the end or 'Cancel' is called, server stops producing and releases the producer.
+    template <typename T>
+    class Stream
+    {
+    public:
+        Stream() {}
+
+        // 'chunkSize' - maximum number of items in a chunk
+        Stream(const std::function<bool(T&)>& produce, size_t chunkSize = 256)
+            : pProducer_(std::make_shared<StreamProducer<T>>(produce, chunkSize))
+        {}
+
+        // Number of items requested in each next chunk (server can send less, if its chunk size is smaller)
+        void SetCredits(size_t credits)
+        {
+            if (pState_)
+            {
+                pState_->credits_ = credits? credits: 1;
+            }
+        }
+
+        bool Next(T& t)
+        {
+            if (!pState_)
+                return false;
+
+            auto& state = *pState_;
+
+            while (state.pos_ == state.chunk_.items_.size())
+            {
+                if (state.end_)
+                    return false;
+
+                state.Fetch();
+            }
+
+            t = std::move(state.chunk_.items_[state.pos_++]);
+
+            return true;
+        }
+
+        void Cancel()
+        {
+            if (pState_)
+            {
+                pState_->Cancel();
+            }
+        }
+
+        using Iterator = StreamIterator<Stream, T>;
+
+        Iterator begin()
+        {
+            Iterator it{ this, T() };
+            return ++it;
+        }
+
+        Iterator end()
+        {
+            return Iterator{ nullptr, T() };
+        }
+
+        // Server registers the stream and writes the first chunk
+        friend Serializer& operator << (Serializer& writer, const Stream& stream)
+        {
+            if (!stream.pProducer_)
+                return writer << "" << std::vector<T>() << true;
+
+            auto id = GetStreams()->Add(stream.pProducer_);
+
+            writer << id;
+
+            if (stream.pProducer_->WriteChunk(writer, stream.pProducer_->ChunkSize())  ||  CurrentCancellation().Cancelled())
+            {
+                GetStreams()->Remove(id);
+            }
+
+            CurrentCancellation().ThrowIfCancelled();
+
+            return writer;
+        }
+
+        friend Serializer& operator >> (Serializer& reader, Stream& stream)
+        {
+            stream.pState_ = std::make_shared<State>();
+
+            reader >> stream.pState_->id_ >> stream.pState_->chunk_;
+
+            stream.pState_->end_ = stream.pState_->chunk_.end_;
+
+            return reader;
+        }
+
+        template <typename X>
+        friend void AttachTransport(Stream& stream, const Transport<X>* pTransport)
+        {
+            if (!stream.pState_)
+                return;
+
+            stream.pState_->next_ = [pTransport](const std::string& id, size_t credits)
+            {
+                std::vector<Param> vPar = { ParamType<false>(id), ParamType<false>(credits) };
+
+                return (*pTransport)(FunctionInfo<true, StreamChunk<T>>("~StreamNext", vPar));
+            };
+
+            stream.pState_->cancel_ = [pTransport](const std::string& id)
+            {
+                std::vector<Param> vPar = { ParamType<false>(id) };
+
+                (*pTransport)(FunctionInfo<false, void>("~StreamCancel", vPar));
+            };
+        }
+
+    private:
+        // Client state, shared by copies of the stream
+        struct State
+        {
+            ~State()
+            {
+                try
+                {
+                    Cancel();
+                }
+                catch (...)
+                {
+                }
+            }
+
+            void Fetch()
+            {
+                if (!next_)
+                    throw Exception(Exception::TransportError, "Stream is not attached to transport.");
+
+                chunk_ = next_(id_, credits_);
+                pos_ = 0;
+                end_ = chunk_.end_;
+            }
+
+            void Cancel()
+            {
+                if (end_)
+                    return;
+
+                end_ = true;
+                chunk_.items_.clear();
+                pos_ = 0;
+
+                if (cancel_)
+                {
+                    cancel_(id_);
+                }
+            }
+
+            std::string id_;
+            StreamChunk<T> chunk_;
+            size_t pos_ = 0;
+            bool end_ = true;
+            size_t credits_ = 256;
+            std::function<StreamChunk<T>(const std::string&, size_t)> next_;
+            std::function<void(const std::string&)> cancel_;
+        };
+
+        std::shared_ptr<StreamProducer<T>> pProducer_;
+        std::shared_ptr<State> pState_;
+    };
+
+
+    // InputChunks - received chunks of InputStream
+    template <typename T>
+    struct InputChunks: public ChunkSink
+    {
+        // Number of received chunks which are not read by handler, when it is reached reply to the last chunk is delayed
+        static const size_t maxChunks = 4;
+
+        InputChunks(StreamChunk<T>& first)
+            : current_(std::move(first.items_)), end_(first.end_)
+        {}
+
+        bool Push(Serializer& reader) override
+        {
+            StreamChunk<T> chunk;
+            reader >> chunk;
+
+            std::lock_guard<std::mutex> lock(locker_);
+
+            if (!closed_)
+            {
+                chunks_.push_back(std::move(chunk.items_));
+                end_ = chunk.end_;
+
+                cv_.notify_all();
+            }
+
+            return end_  ||  closed_;
+        }
+
+        void WhenReady(std::function<void()> f) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                if (chunks_.size() >= maxChunks  &&  !closed_)
+                {
+                    ready_ = std::move(f);
+                    return;
+                }
+            }
+
+            f();
+        }
+
+        void Close(bool cancelled) override
+        {
+            std::function<void()> ready;
+            {
+                std::lock_guard<std::mutex> lock(locker_);
+
+                closed_ = true;
+                cancelled_ = cancelled;
+
+                ready.swap(ready_);
+
+                cv_.notify_all();
+            }
+
+            if (ready)
+            {
+                ready();
+            }
+        }
+
+        // Current chunk is used only by handler thread
+        bool Next(T& t)
+        {
+            while (pos_ == current_.size())
+            {
+                std::unique_lock<std::mutex> lock(locker_);
+
+                cv_.wait(lock, [&] { return !chunks_.empty()  ||  end_  ||  closed_; });
+
+                if (chunks_.empty())
+                {
+                    if (cancelled_)
+                        throw Exception(Exception::ServerError, "InputStream is cancelled.");
+
+                    return false;
+                }
+
+                current_ = std::move(chunks_.front());
+                chunks_.pop_front();
+                pos_ = 0;
+
+                // Reply to the last received chunk is completed
+                std::function<void()> ready;
+                ready.swap(ready_);
+
+                lock.unlock();
+
+                if (ready)
+                {
+                    ready();
+                }
+            }
+
+            t = std::move(current_[pos_++]);
+
+            return true;
+        }
+
+    private:
+        std::vector<T> current_;
+        size_t pos_ = 0;
+        std::deque<std::vector<T>> chunks_;
+        bool end_;
+        bool closed_ = false;
+        bool cancelled_ = false;
+        std::function<void()> ready_;
+        std::mutex locker_;
+        std::condition_variable cv_;
+    };
+
+
+    // InputStream
+    //
+    // Client passes input stream with a producer which is called for each item, it returns false when there are no more items:
+    //     transport(Ingest(RemoteCall::InputStream<Row>([&](Row& row) { return file.Read(row); })));
+    // The first chunk is sent in the call frame, the rest in next frames while the handler is running.
+    //
+    // Server handler reads items via 'Next' or range-based for, it waits until next chunk is received.
+    // Handler with InputStream parameter runs in its own thread, reply to a chunk is delayed while handler 
+    // did not read previous chunks, so memory is bounded on both sides. Only one InputStream parameter can be used.
+    template <typename T>
+    class InputStream
+    {
+    public:
+        InputStream() {}
+
+        // 'chunkSize' - number of items in a chunk
+        InputStream(const std::function<bool(T&)>& produce, size_t chunkSize = 256)
+            : pProducer_(std::make_shared<StreamProducer<T>>(produce, chunkSize))
+        {}
+
+        bool Next(T& t) const
+        {
+            return pChunks_? pChunks_->Next(t): false;
+        }
+
+        using Iterator = StreamIterator<const InputStream, T>;
+
+        Iterator begin() const
+        {
+            Iterator it{ this, T() };
+            return ++it;
+        }
+
+        Iterator end() const
+        {
+            return Iterator{ nullptr, T() };
+        }
+
+        // Client writes the first chunk
+        friend Serializer& operator << (Serializer& writer, const InputStream& stream)
+        {
+            if (!stream.pProducer_)
+                return writer << std::vector<T>() << true;
+
+            stream.pProducer_->WriteChunk(writer, (size_t)-1);
+
+            return writer;
+        }
+
+        // Server reads the first chunk, the call waits for next chunks if it is not the last one
+        friend Serializer& operator >> (Serializer& reader, InputStream& stream)
+        {
+            StreamChunk<T> chunk;
+            reader >> chunk;
+
+            bool end = chunk.end_;
+
+            stream.pChunks_ = std::make_shared<InputChunks<T>>(chunk);
+
+            if (!end)
+            {
+                auto pCall = DetachedCall::Current();
+                if (!pCall)
+                    throw Exception(Exception::ServerError, "InputStream is not received in detached call.");
+
+                pCall->Suspend(stream.pChunks_);
+            }
+
+            return reader;
+        }
+
+        friend StreamSource* ChunkSource(const InputStream& stream)
+        {
+            return stream.pProducer_.get();
+        }
+
+    private:
+        std::shared_ptr<StreamProducer<T>> pProducer_;
+        std::shared_ptr<InputChunks<T>> pChunks_;
+    };
+
+    template <typename T>
+    struct IsChunkedParam<InputStream<T>>: std::true_type {};
+}
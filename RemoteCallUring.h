@@ -0,0 +1,285 @@
+// io_uring (Linux) - minimal ring implementation via system calls: batched submission, completion iteration,
+// and provided buffer ring registered with the kernel for multishot receive.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+namespace RemoteCall
+{
+    // Kernel features used by the ring, tests disable them to check the fallbacks of kernels without them
+    struct UringSupport
+    {
+        // io_uring_setup fails, like with io_uring disabled by seccomp or sysctl
+        bool setup_ = true;
+
+        // Multishot receive is rejected with EINVAL, like before Linux 6.0
+        bool multishotReceive_ = true;
+    };
+
+    inline UringSupport& GetUringSupport()
+    {
+        static UringSupport s_support; return s_support;
+    }
+
+    struct Uring
+    {
+        Uring() {}
+
+        ~Uring()
+        {
+            if (pBufferRing_)
+            {
+                munmap(pBufferRing_, bufferRingSize_);
+                munmap(pBuffers_, bufferCount_ * bufferSize_);
+            }
+
+            if (pSqes_)
+            {
+                munmap(pSqes_, sqesSize_);
+            }
+
+            if (pCq_  &&  pCq_ != pSq_)
+            {
+                munmap(pCq_, cqSize_);
+            }
+
+            if (pSq_)
+            {
+                munmap(pSq_, sqSize_);
+            }
+
+            if (-1 != fd_)
+            {
+                close(fd_);
+            }
+        }
+
+        Uring(const Uring&) = delete;
+        void operator = (const Uring&) = delete;
+
+        // Returns false if io_uring is not available (old kernel, disabled by seccomp or sysctl)
+        bool Init(unsigned entries)
+        {
+            io_uring_params params = {};
+
+            fd_ = GetUringSupport().setup_? (int)syscall(SYS_io_uring_setup, entries, &params): -1;
+            if (fd_ < 0)
+            {
+                fd_ = -1;
+                return false;
+            }
+
+            sqSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP)
+            {
+                sqSize_ = cqSize_ = sqSize_ > cqSize_? sqSize_: cqSize_;
+            }
+
+            pSq_ = (char*)Map(sqSize_, IORING_OFF_SQ_RING);
+            pCq_ = (params.features & IORING_FEAT_SINGLE_MMAP)? pSq_: (char*)Map(cqSize_, IORING_OFF_CQ_RING);
+
+            sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+            pSqes_ = (io_uring_sqe*)Map(sqesSize_, IORING_OFF_SQES);
+
+            if (!pSq_  ||  !pCq_  ||  !pSqes_)
+                return false;
+
+            sqHead_ = (std::atomic<unsigned>*)(pSq_ + params.sq_off.head);
+            sqTail_ = (std::atomic<unsigned>*)(pSq_ + params.sq_off.tail);
+            sqMask_ = *(unsigned*)(pSq_ + params.sq_off.ring_mask);
+            sqEntries_ = params.sq_entries;
+            sqArray_ = (unsigned*)(pSq_ + params.sq_off.array);
+
+            cqHead_ = (std::atomic<unsigned>*)(pCq_ + params.cq_off.head);
+            cqTail_ = (std::atomic<unsigned>*)(pCq_ + params.cq_off.tail);
+            cqMask_ = *(unsigned*)(pCq_ + params.cq_off.ring_mask);
+            cqes_ = (io_uring_cqe*)(pCq_ + params.cq_off.cqes);
+
+            sqeTail_ = sqTail_->load(std::memory_order_relaxed);
+
+            return true;
+        }
+
+        // Registers 'count' (power of 2) buffers of 'size' bytes as buffer group 'group' for IOSQE_BUFFER_SELECT
+        bool InitBuffers(unsigned count, unsigned size, uint16_t group)
+        {
+            bufferCount_ = count;
+            bufferSize_ = size;
+            bufferGroup_ = group;
+
+            bufferRingSize_ = count * sizeof(io_uring_buf);
+
+            pBufferRing_ = (io_uring_buf_ring*)mmap(nullptr, bufferRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            pBuffers_ = (char*)mmap(nullptr, count * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (MAP_FAILED == (void*)pBufferRing_  ||  MAP_FAILED == (void*)pBuffers_)
+            {
+                if (MAP_FAILED != (void*)pBufferRing_)
+                {
+                    munmap(pBufferRing_, bufferRingSize_);
+                }
+
+                if (MAP_FAILED != (void*)pBuffers_)
+                {
+                    munmap(pBuffers_, count * size);
+                }
+
+                pBufferRing_ = nullptr;
+                return false;
+            }
+
+            io_uring_buf_reg reg = {};
+            reg.ring_addr = (uint64_t)pBufferRing_;
+            reg.ring_entries = count;
+            reg.bgid = group;
+
+            if (syscall(SYS_io_uring_register, fd_, IORING_REGISTER_PBUF_RING, &reg, 1))
+                return false;
+
+            for (unsigned id = 0; id < count; id++)
+            {
+                AddBuffer(id, id);
+            }
+            PublishBuffers(count);
+
+            return true;
+        }
+
+        uint16_t BufferGroup() const
+        {
+            return bufferGroup_;
+        }
+
+        char* Buffer(unsigned id)
+        {
+            return pBuffers_ + (size_t)id * bufferSize_;
+        }
+
+        // Returns buffer selected by the kernel back to the buffer ring
+        void RecycleBuffer(unsigned id)
+        {
+            AddBuffer(id, 0);
+            PublishBuffers(1);
+        }
+
+        // Returns cleared submission queue entry, submits queued entries if the queue is full
+        io_uring_sqe* GetSqe()
+        {
+            if (sqeTail_ - sqHead_->load(std::memory_order_acquire) >= sqEntries_)
+            {
+                Submit(0);
+            }
+
+            auto pSqe = &pSqes_[sqeTail_ & sqMask_];
+            memset(pSqe, 0, sizeof(*pSqe));
+
+            sqArray_[sqeTail_ & sqMask_] = sqeTail_ & sqMask_;
+            sqeTail_++;
+
+            return pSqe;
+        }
+
+        // Submits all queued entries in one system call and waits for at least 'waitCount' completions
+        int Submit(unsigned waitCount)
+        {
+            auto tail = sqTail_->load(std::memory_order_relaxed);
+            sqTail_->store(sqeTail_, std::memory_order_release);
+
+            unsigned flags = waitCount? IORING_ENTER_GETEVENTS: 0;
+
+            int ret;
+            do
+            {
+                ret = (int)syscall(SYS_io_uring_enter, fd_, sqeTail_ - tail, waitCount, flags, nullptr, 0);
+            } while (ret < 0  &&  EINTR == errno);
+
+            return ret;
+        }
+
+        // Calls f(const io_uring_cqe&) for all available completions
+        template <typename F>
+        unsigned ForEachCqe(F f)
+        {
+            auto head = cqHead_->load(std::memory_order_relaxed);
+            auto tail = cqTail_->load(std::memory_order_acquire);
+
+            for (auto i = head; i != tail; i++)
+            {
+                // Copy, since handler can submit new entries which can reuse completion slot after head is advanced
+                io_uring_cqe cqe = cqes_[i & cqMask_];
+
+                cqHead_->store(i + 1, std::memory_order_release);
+
+                f(cqe);
+            }
+
+            return tail - head;
+        }
+
+    private:
+        void* Map(size_t size, uint64_t offset)
+        {
+            void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+
+            return MAP_FAILED == p? nullptr: p;
+        }
+
+        void AddBuffer(unsigned id, unsigned offset)
+        {
+            auto tail = ((std::atomic<uint16_t>*)&pBufferRing_->tail)->load(std::memory_order_relaxed);
+
+            // Not 'bufs' member, in C++ its flexible array declaration is shifted by an empty struct
+            auto& buf = ((io_uring_buf*)pBufferRing_)[(tail + offset) & (bufferCount_ - 1)];
+            buf.addr = (uint64_t)Buffer(id);
+            buf.len = bufferSize_;
+            buf.bid = (uint16_t)id;
+        }
+
+        void PublishBuffers(unsigned count)
+        {
+            auto pTail = (std::atomic<uint16_t>*)&pBufferRing_->tail;
+
+            pTail->store((uint16_t)(pTail->load(std::memory_order_relaxed) + count), std::memory_order_release);
+        }
+
+    private:
+        int fd_ = -1;
+
+        char* pSq_ = nullptr;
+        char* pCq_ = nullptr;
+        io_uring_sqe* pSqes_ = nullptr;
+        size_t sqSize_ = 0;
+        size_t cqSize_ = 0;
+        size_t sqesSize_ = 0;
+
+        std::atomic<unsigned>* sqHead_ = nullptr;
+        std::atomic<unsigned>* sqTail_ = nullptr;
+        unsigned* sqArray_ = nullptr;
+        unsigned sqMask_ = 0;
+        unsigned sqEntries_ = 0;
+        unsigned sqeTail_ = 0;
+
+        std::atomic<unsigned>* cqHead_ = nullptr;
+        std::atomic<unsigned>* cqTail_ = nullptr;
+        io_uring_cqe* cqes_ = nullptr;
+        unsigned cqMask_ = 0;
+
+        io_uring_buf_ring* pBufferRing_ = nullptr;
+        size_t bufferRingSize_ = 0;
+        char* pBuffers_ = nullptr;
+        unsigned bufferCount_ = 0;
+        unsigned bufferSize_ = 0;
+        uint16_t bufferGroup_ = 0;
+    };
+}
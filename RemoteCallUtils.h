@@ -2,25 +2,57 @@
 
 #include <string>
 #include <sstream> 
+#include <type_traits>
+#include <random>
+#include <cstdio>
+#include <mutex>
 
 namespace RemoteCall
 {
     template<typename C, typename Ret, typename ...Args>
     auto MethodReturnType(Ret(C::*)(Args...)) -> Ret;
 
-    struct ToString: public std::stringstream
+    // Parameter type which is sent in several frames while the call is executed (InputStream)
+    template <typename T> struct IsChunkedParam: std::false_type {};
+
+    template <typename ...Args> struct AnyChunkedParam: std::false_type {};
+
+    template <typename Arg, typename ...Args>
+    struct AnyChunkedParam<Arg, Args...>
+    {
+        static constexpr bool value = IsChunkedParam<typename std::decay<Arg>::type>::value  ||  AnyChunkedParam<Args...>::value;
+    };
+
+    // Random 128 bit identifier as hex string
+    inline std::string CreateUniqueId()
+    {
+        static std::mutex s_locker;
+        static std::mt19937_64 s_random(std::random_device{}() ^ ((unsigned long long)std::random_device{}() << 32));
+
+        std::lock_guard<std::mutex> lock(s_locker);
+
+        char id[33];
+        snprintf(id, sizeof(id), "%016llx%016llx", (unsigned long long)s_random(), (unsigned long long)s_random());
+
+        return id;
+    }
+
+    struct ToString
     {
         template <typename T>
         ToString& operator << (const T& t)
         {
-            ((std::stringstream&)*this) << t;
+            stream_ << t;
 
             return *this;
         }
 
-        operator std::string()
+        operator std::string() const
         {
-            return ((std::stringstream&)(*this)).str();
+            return stream_.str();
         }
+
+    private:
+        std::stringstream stream_;
     };
 }
@@ -0,0 +1,174 @@
+// Tests of RemoteCallAdmission.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <thread>
+#include <future>
+
+using namespace std;
+
+static promise<void> s_release;
+
+void BlockRemoteFunction();
+void REMOTE_FUNCTION_DECL(Block)();
+
+void REMOTE_FUNCTION_IMPL(Block)()
+{
+    s_release.get_future().wait();
+}
+
+int EchoRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(Echo)(int n);
+
+int REMOTE_FUNCTION_IMPL(Echo)(int n)
+{
+    return n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct AdmissionTransport: public RemoteCall::Transport<AdmissionTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+};
+
+// Reply of a call processed via ProcessCall with completion
+struct Reply
+{
+    bool Done()
+    {
+        lock_guard<mutex> lock(locker_);
+
+        return done_;
+    }
+
+    // Error of the reply (NoError if it succeeded)
+    int Error()
+    {
+        lock_guard<mutex> lock(locker_);
+
+        // Reply starts with correlation id of the frame
+        RemoteCall::Serializer reader(vOut_);
+        reader.Skip(RemoteCall::CheckCorrelation(vOut_, correlationId_));
+
+        if (!reader.GetCurrent())
+            return RemoteCall::Exception::NoError;
+
+        RemoteCall::Exception e;
+        reader >> e;
+
+        return e.Error();
+    }
+
+    uint32_t correlationId_ = 0;
+    bool done_ = false;
+    std::vector<char> vOut_;
+    mutex locker_;
+};
+
+// Processes the call without waiting for its reply
+template <typename C>
+static shared_ptr<Reply> Start(AdmissionTransport& transport, const C& call)
+{
+    RemoteCall::Serializer writer;
+    transport.WriteFrame(call, writer, false);
+
+    auto pReply = make_shared<Reply>();
+    pReply->correlationId_ = RemoteCall::FrameCorrelationId(writer.Data(), writer.Size());
+
+    RemoteCall::ProcessCall(std::vector<char>(writer.Data(), writer.Data() + writer.Size()), [pReply](std::vector<char>&& vOut)
+    {
+        lock_guard<mutex> lock(pReply->locker_);
+
+        pReply->vOut_ = std::move(vOut);
+        pReply->done_ = true;
+    });
+
+    return pReply;
+}
+
+static void Wait(const shared_ptr<Reply>& pReply)
+{
+    while (!pReply->Done())
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+}
+
+
+int main()
+{
+    AdmissionTransport transport;
+
+    RemoteCall::AdmissionPolicy policy;
+    policy.initialLimit_ = policy.minLimit_ = policy.maxLimit_ = 1;
+    policy.queueSize_ = 1;
+
+    auto pAdmission = RemoteCall::GetAdmission();
+    pAdmission->Configure(policy);
+
+    thread blocked([&transport]() { transport(Block()); });
+
+    while (!pAdmission->InFlight())
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    // Waiting call is parked, this thread is not blocked
+    auto pParked = Start(transport, Echo(1));
+    TEST_CHECK(!pParked->Done());
+    TEST_CHECK(1 == pAdmission->Parked());
+
+    // Parked call whose deadline passed is rejected when another one is parked
+    auto pExpired = Start(transport, Echo(2).Priority(RemoteCall::PriorityHigh).Timeout(chrono::milliseconds(20)));
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    auto pLow = Start(transport, Echo(3).Priority(RemoteCall::PriorityLow));
+    TEST_CHECK(pExpired->Done()  &&  RemoteCall::Exception::DeadlineExceeded == pExpired->Error());
+    TEST_CHECK(2 == pAdmission->Parked());
+
+    // Full queue
+    auto pRejected = Start(transport, Echo(4));
+    TEST_CHECK(pRejected->Done()  &&  RemoteCall::Exception::Overloaded == pRejected->Error());
+
+    // Parked calls are resumed by the thread which leaves admission
+    s_release.set_value();
+    blocked.join();
+
+    TEST_CHECK(pParked->Done()  &&  RemoteCall::Exception::NoError == pParked->Error());
+    TEST_CHECK(pLow->Done()  &&  RemoteCall::Exception::NoError == pLow->Error());
+    TEST_CHECK(0 == pAdmission->Parked()  &&  0 == pAdmission->InFlight());
+
+    // Disable admits parked calls
+    s_release = promise<void>();
+    blocked = thread([&transport]() { transport(Block()); });
+
+    while (!pAdmission->InFlight())
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    pParked = Start(transport, Echo(5));
+    TEST_CHECK(!pParked->Done());
+
+    pAdmission->Disable();
+    TEST_CHECK(pParked->Done()  &&  RemoteCall::Exception::NoError == pParked->Error());
+
+    s_release.set_value();
+    blocked.join();
+
+    TEST_CHECK(0 == pAdmission->InFlight());
+
+    cout << "TestAdmission passed" << endl;
+
+    return 0;
+}
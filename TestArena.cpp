@@ -0,0 +1,151 @@
+// Tests of RemoteCallArena.h, built with TestServer.cpp. Prints heap allocations of server processing a call with std and std::pmr parameters.
+#include "TestRemoteCall.h"
+
+#include <new>
+#include <cstdlib>
+
+using namespace std;
+
+// Heap allocations of this thread while it counts them
+static thread_local bool t_counting = false;
+static thread_local size_t t_allocations = 0;
+
+void* operator new(size_t size)
+{
+    if (t_counting)
+    {
+        t_allocations++;
+    }
+
+    if (auto p = malloc(size? size: 1))
+        return p;
+
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+#ifdef REMOTE_CALL_PMR
+
+static bool s_inArena = false;
+
+size_t CountStdRemoteFunction(const vector<string>& words, const map<string, int>& m);
+size_t REMOTE_FUNCTION_DECL(CountStd)(const vector<string>& words, const map<string, int>& m);
+
+size_t REMOTE_FUNCTION_IMPL(CountStd)(const vector<string>& words, const map<string, int>& m)
+{
+    size_t count = 0;
+    for (auto& el: words)
+    {
+        count += el.size();
+    }
+
+    return count + m.size();
+}
+
+size_t CountPmrRemoteFunction(const pmr::vector<pmr::string>& words, const pmr::map<pmr::string, int>& m);
+size_t REMOTE_FUNCTION_DECL(CountPmr)(const pmr::vector<pmr::string>& words, const pmr::map<pmr::string, int>& m);
+
+size_t REMOTE_FUNCTION_IMPL(CountPmr)(const pmr::vector<pmr::string>& words, const pmr::map<pmr::string, int>& m)
+{
+    s_inArena = RemoteCall::CurrentArena() == words.get_allocator().resource()  &&
+        RemoteCall::CurrentArena() == words.front().get_allocator().resource()  &&
+        RemoteCall::CurrentArena() == m.begin()->first.get_allocator().resource()  &&
+        RemoteCall::CurrentArena() != pmr::get_default_resource();
+
+    size_t count = 0;
+    for (auto& el: words)
+    {
+        count += el.size();
+    }
+
+    return count + m.size();
+}
+
+#endif
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Counts allocations of server processing the frame
+struct ArenaTransport: public RemoteCall::Transport<ArenaTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        t_allocations = 0;
+        t_counting = true;
+
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        t_counting = false;
+        allocations_ = t_allocations;
+
+        return true;
+    }
+
+    size_t allocations_ = 0;
+};
+
+
+int main()
+{
+#ifdef REMOTE_CALL_PMR
+    ArenaTransport transport;
+
+    // Strings are longer than small string buffer
+    vector<string> words;
+    pmr::vector<pmr::string> pmrWords;
+    map<string, int> m;
+    pmr::map<pmr::string, int> pmrM;
+
+    for (int i = 0; i < 100; i++)
+    {
+        string word = RemoteCall::ToString() << "word of the call number " << i;
+
+        words.push_back(word);
+        pmrWords.push_back(pmr::string(word.begin(), word.end()));
+
+        if (i < 50)
+        {
+            m[word] = i;
+            pmrM[pmr::string(word.begin(), word.end())] = i;
+        }
+    }
+
+    auto expected = CountStdRemoteFunction(words, m);
+
+    // The first call creates the arena of the thread
+    TEST_CHECK(expected == transport(CountPmr(pmrWords, pmrM)));
+    TEST_CHECK(s_inArena);
+
+    TEST_CHECK(expected == transport(CountStd(words, m)));
+    auto stdAllocations = transport.allocations_;
+
+    s_inArena = false;
+    TEST_CHECK(expected == transport(CountPmr(pmrWords, pmrM)));
+    auto pmrAllocations = transport.allocations_;
+    TEST_CHECK(s_inArena);
+
+    cout << "Server heap allocations of a call with 100 strings and map of 50 strings: std " << stdAllocations <<
+        ", std::pmr " << pmrAllocations << endl;
+
+    // Elements of pmr parameters are not allocated from the heap, the rest is the same for both calls
+    TEST_CHECK(pmrAllocations + 150 <= stdAllocations);
+#endif
+
+    cout << "TestArena passed" << endl;
+
+    return 0;
+}
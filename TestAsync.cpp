@@ -0,0 +1,182 @@
+// Tests of RemoteCallAsync.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <thread>
+
+using namespace std;
+
+static atomic<int> s_executed{0};
+static RemoteCall::Async<int> s_pending;
+static weak_ptr<RemoteCall::AsyncValue<int>> s_pState;
+
+// Completed later via s_pending, unless 'n' is negative: then it is dropped without completing
+RemoteCall::Async<int> ComputeRemoteFunction(int n);
+RemoteCall::Async<int> REMOTE_FUNCTION_DECL(Compute)(int n);
+
+RemoteCall::Async<int> REMOTE_FUNCTION_IMPL(Compute)(int n)
+{
+    RemoteCall::Async<int> result;
+    s_pState = result.GetState();
+
+    if (n >= 0)
+    {
+        s_pending = result;
+    }
+
+    s_executed++;
+
+    return result;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct AsyncTransport: public RemoteCall::Transport<AsyncTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+};
+
+// Reply of a call processed via ProcessCall with completion
+struct Reply
+{
+    bool Done()
+    {
+        lock_guard<mutex> lock(locker_);
+
+        return done_;
+    }
+
+    // Returns the result, or -error if it failed
+    int Result()
+    {
+        lock_guard<mutex> lock(locker_);
+
+        // Reply starts with correlation id of the frame
+        RemoteCall::Serializer reader(vOut_);
+        reader.Skip(RemoteCall::CheckCorrelation(vOut_, correlationId_));
+
+        if (reader.GetCurrent())
+        {
+            RemoteCall::Exception e;
+            reader >> e;
+
+            return -(int)e.Error();
+        }
+
+        string noException;
+        int n;
+        reader >> noException >> n;
+
+        return n;
+    }
+
+    uint32_t correlationId_ = 0;
+    bool done_ = false;
+    std::vector<char> vOut_;
+    mutex locker_;
+};
+
+template <typename C>
+static shared_ptr<Reply> Start(AsyncTransport& transport, const C& call)
+{
+    RemoteCall::Serializer writer;
+    transport.WriteFrame(call, writer, false);
+
+    auto pReply = make_shared<Reply>();
+    pReply->correlationId_ = RemoteCall::FrameCorrelationId(writer.Data(), writer.Size());
+
+    RemoteCall::ProcessCall(std::vector<char>(writer.Data(), writer.Data() + writer.Size()), [pReply](std::vector<char>&& vOut)
+    {
+        lock_guard<mutex> lock(pReply->locker_);
+
+        pReply->vOut_ = std::move(vOut);
+        pReply->done_ = true;
+    });
+
+    return pReply;
+}
+
+
+int main()
+{
+    AsyncTransport transport;
+
+    RemoteCall::AdmissionPolicy policy;
+    RemoteCall::GetAdmission()->Configure(policy);
+
+    // Reply is sent when the result is completed, the first result is kept
+    auto pReply = Start(transport, Compute(1));
+    TEST_CHECK(!pReply->Done());
+
+    s_pending.Resolve(10);
+    s_pending.Resolve(20);
+    s_pending.Reject(make_exception_ptr(runtime_error("Late")));
+    TEST_CHECK(pReply->Done()  &&  10 == pReply->Result());
+
+    // The state is not kept by the reply
+    s_pending = RemoteCall::Async<int>();
+    TEST_CHECK(s_pState.expired());
+
+    // Async dropped by handler, or destroyed later without completing it, fails the call and leaves admission
+    TEST_CHECK(-(int)RemoteCall::Exception::ServerError == Start(transport, Compute(-1))->Result());
+
+    pReply = Start(transport, Compute(2));
+    TEST_CHECK(!pReply->Done()  &&  1 == RemoteCall::GetAdmission()->InFlight());
+
+    s_pending = RemoteCall::Async<int>();
+    TEST_CHECK(pReply->Done()  &&  -(int)RemoteCall::Exception::ServerError == pReply->Result());
+    TEST_CHECK(0 == RemoteCall::GetAdmission()->InFlight());
+
+    // Idempotent call does not block, duplicate waits for the first execution, the reply is stored when it is ready
+    s_executed = 0;
+
+    auto pFirst = Start(transport, Compute(3).IdempotencyKey("k"));
+    auto pDuplicate = Start(transport, Compute(3).IdempotencyKey("k"));
+    TEST_CHECK(!pFirst->Done()  &&  !pDuplicate->Done());
+
+    s_pending.Resolve(30);
+    TEST_CHECK(30 == pFirst->Result()  &&  30 == pDuplicate->Result());
+
+    TEST_CHECK(30 == Start(transport, Compute(3).IdempotencyKey("k"))->Result());
+    TEST_CHECK(1 == s_executed);
+
+    // Failed one is not stored, the waiting duplicate is executed
+    pFirst = Start(transport, Compute(4).IdempotencyKey("f"));
+    pDuplicate = Start(transport, Compute(4).IdempotencyKey("f"));
+
+    s_pending.Reject(make_exception_ptr(runtime_error("Failed")));
+    TEST_CHECK(-(int)RemoteCall::Exception::ServerError == pFirst->Result());
+    TEST_CHECK(!pDuplicate->Done()  &&  3 == s_executed);
+
+    s_pending.Resolve(40);
+    TEST_CHECK(40 == pDuplicate->Result());
+
+    // Blocking ProcessCall waits for the result
+    thread resolver([]()
+    {
+        while (4 != s_executed)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        s_pending.Resolve(50);
+    });
+
+    TEST_CHECK(50 == transport(Compute(5)).Get());
+    resolver.join();
+
+    RemoteCall::GetAdmission()->Disable();
+
+    cout << "TestAsync passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Tests of RemoteCallCache.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <thread>
+
+using namespace std;
+
+static int s_executed = 0;
+
+string GetConfigurationRemoteFunction(const string& key);
+string REMOTE_CACHED_FUNCTION_DECL(GetConfiguration, 60000, 100)(const string& key);
+
+string REMOTE_FUNCTION_IMPL(GetConfiguration)(const string& key)
+{
+    s_executed++;
+
+    return key + to_string(s_executed);
+}
+
+// Result is cached during 50 ms
+int GetShortLivedRemoteFunction(int n);
+int REMOTE_CACHED_FUNCTION_DECL(GetShortLived, 50, 100)(int n);
+
+int REMOTE_FUNCTION_IMPL(GetShortLived)(int n)
+{
+    s_executed++;
+
+    return n;
+}
+
+// At most 2 results are cached
+int GetFewRemoteFunction(int n);
+int REMOTE_CACHED_FUNCTION_DECL(GetFew, 60000, 2)(int n);
+
+int REMOTE_FUNCTION_IMPL(GetFew)(int n)
+{
+    s_executed++;
+
+    return n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct CacheTransport: public RemoteCall::Transport<CacheTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    bool UseSession() const override
+    {
+        return true;
+    }
+};
+
+// Server side of the callbacks of 'client'
+struct CallbackTransport: public RemoteCall::Transport<CallbackTransport>
+{
+    explicit CallbackTransport(const CacheTransport& client)
+        : client_(client)
+    {}
+
+    bool Send(const std::vector<char>& vIn)
+    {
+        std::vector<char> vOut;
+        client_.ProcessCallback(vIn, vOut);
+
+        return true;
+    }
+
+    const CacheTransport& client_;
+};
+
+// Number of calls executed by server for 'f'
+template <typename F>
+static int Executed(F f)
+{
+    int executed = s_executed;
+    f();
+
+    return s_executed - executed;
+}
+
+
+int main()
+{
+    CacheTransport transport;
+
+    // Result is cached by arguments: the name is interned in the session after the first call, 
+    // the deadline, cancel id and idempotency key are in the header
+    auto first = transport(GetConfiguration("a"));
+    TEST_CHECK(transport(GetConfiguration("a")) == first);
+    TEST_CHECK(transport(GetConfiguration("a").Timeout(chrono::milliseconds(1000))) == first);
+    TEST_CHECK(transport.WithDeadline(chrono::milliseconds(1000))(GetConfiguration("a")) == first);
+    TEST_CHECK(transport(GetConfiguration("a").Idempotent()) == first);
+    TEST_CHECK(1 == s_executed);
+
+    TEST_CHECK(transport(GetConfiguration("b")) != first);
+    TEST_CHECK(2 == s_executed);
+
+    // Removed result of the call
+    transport.InvalidateCache(GetConfiguration("a"));
+    TEST_CHECK(transport(GetConfiguration("a")) != first);
+    TEST_CHECK(transport(GetConfiguration("b").Timeout(chrono::milliseconds(1000))) == "b2");
+    TEST_CHECK(3 == s_executed);
+
+    // Result expires after its TTL
+    TEST_CHECK(1 == Executed([&]() { TEST_CHECK(7 == transport(GetShortLived(7))); }));
+    TEST_CHECK(0 == Executed([&]() { TEST_CHECK(7 == transport(GetShortLived(7))); }));
+
+    this_thread::sleep_for(chrono::milliseconds(100));
+    TEST_CHECK(1 == Executed([&]() { TEST_CHECK(7 == transport(GetShortLived(7))); }));
+
+    // The least recently used result is evicted
+    TEST_CHECK(2 == Executed([&]() { transport(GetFew(1)); transport(GetFew(2)); }));
+    TEST_CHECK(0 == Executed([&]() { transport(GetFew(1)); }));
+    TEST_CHECK(1 == Executed([&]() { transport(GetFew(3)); }));
+    TEST_CHECK(0 == Executed([&]() { transport(GetFew(1)); transport(GetFew(3)); }));
+    TEST_CHECK(1 == Executed([&]() { transport(GetFew(2)); }));
+
+    // Server invalidates results cached by the transport which received the callback, other transport keeps its results
+    {
+        CacheTransport other;
+        CallbackTransport callbacks(transport);
+
+        TEST_CHECK(1 == Executed([&]() { other(GetConfiguration("c")); other(GetConfiguration("c")); }));
+        TEST_CHECK(0 == Executed([&]() { transport(GetConfiguration("b")); transport(GetFew(2)); }));
+
+        callbacks(RemoteCall::InvalidateClientCache("GetConfiguration"));
+
+        TEST_CHECK(1 == Executed([&]() { transport(GetConfiguration("b")); }));
+        TEST_CHECK(0 == Executed([&]() { transport(GetFew(2)); other(GetConfiguration("c")); }));
+
+        callbacks(RemoteCall::InvalidateClientCache(""));
+        TEST_CHECK(2 == Executed([&]() { transport(GetConfiguration("b")); transport(GetFew(2)); }));
+        TEST_CHECK(0 == Executed([&]() { other(GetConfiguration("c")); }));
+    }
+
+    cout << "TestCache passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+// Tests of RemoteCallCallbackQueue.h and '~Batch' frames, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallCallbackQueue.h"
+
+#include <thread>
+#include <future>
+#include <atomic>
+
+using namespace std;
+
+static mutex s_locker;
+static vector<int> s_notes;
+
+void NoteRemoteFunction(int n);
+void REMOTE_FUNCTION_DECL(Note)(int n);
+
+void REMOTE_FUNCTION_IMPL(Note)(int n)
+{
+    lock_guard<mutex> lock(s_locker);
+
+    s_notes.push_back(n);
+}
+
+static promise<void> s_release;
+
+void BlockRemoteFunction();
+void REMOTE_FUNCTION_DECL(Block)();
+
+void REMOTE_FUNCTION_IMPL(Block)()
+{
+    s_release.get_future().wait();
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCallback(vIn, vOut);
+}
+
+
+// Server side of the callbacks, frames are processed as client processes them, the first one waits until the gate is opened
+static atomic<bool> s_open{true};
+static atomic<int> s_sending{0};
+
+struct CallbackTransport: public RemoteCall::Transport<CallbackTransport>
+{
+    bool Send(const std::vector<char>& vIn)
+    {
+        s_sending++;
+
+        while (!s_open)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        ClientRequestHandler(vIn);
+
+        return true;
+    }
+};
+
+struct RequestTransport: public RemoteCall::Transport<RequestTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+};
+
+template <typename C>
+static vector<char> Frame(CallbackTransport& transport, const C& call)
+{
+    RemoteCall::Serializer writer;
+    transport.WriteFrame(call, writer, false);
+
+    return vector<char>(writer.Data(), writer.Data() + writer.Size());
+}
+
+// Error of the reply (NoError if it succeeded)
+static int Error(const vector<char>& vOut)
+{
+    RemoteCall::Serializer reader(vOut);
+    if (!reader.GetCurrent())
+        return RemoteCall::Exception::NoError;
+
+    RemoteCall::Exception e;
+    reader >> e;
+
+    return e.Error();
+}
+
+static vector<int> Notes()
+{
+    lock_guard<mutex> lock(s_locker);
+
+    return s_notes;
+}
+
+
+int main()
+{
+    CallbackTransport transport;
+
+    // Calls queued while the first frame is sent are sent in one '~Batch' frame and processed in order
+    {
+        s_open = false;
+
+        RemoteCall::CallbackQueue<CallbackTransport> queue(transport);
+        TEST_CHECK(queue(Note(0)));
+
+        while (!s_sending)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        for (int i = 1; i < 10; i++)
+        {
+            TEST_CHECK(queue(Note(int(i))));
+        }
+
+        s_open = true;
+        queue.Flush();
+
+        auto metrics = queue.Metrics();
+        TEST_CHECK(10 == metrics.sent_  &&  2 == metrics.batches_  &&  0 == metrics.failed_);
+        TEST_CHECK(vector<int>({ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 }) == Notes());
+    }
+
+    auto batch = Frame(transport, RemoteCall::BatchCall({ Frame(transport, Note(10)), Frame(transport, Note(11)) }));
+
+    // Server does not accept '~Batch'
+    {
+        vector<char> vOut;
+        RemoteCall::ProcessCall(batch, vOut);
+
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(vOut));
+        TEST_CHECK(10u == Notes().size());
+    }
+
+    // '~Batch' inside '~Batch' is rejected, other calls of the batch are processed
+    {
+        s_notes.clear();
+
+        auto nested = Frame(transport, RemoteCall::BatchCall({ Frame(transport, Note(1)), batch, Frame(transport, Note(2)) }));
+
+        vector<char> vOut;
+        RemoteCall::ProcessCallback(nested, vOut);
+
+        TEST_CHECK(RemoteCall::Exception::NoError == Error(vOut));
+        TEST_CHECK(vector<int>({ 1, 2 }) == Notes());
+    }
+
+    // Batched calls are admitted one by one, call waiting for admission does not block the thread
+    {
+        s_notes.clear();
+
+        RemoteCall::AdmissionPolicy policy;
+        policy.initialLimit_ = policy.minLimit_ = policy.maxLimit_ = 1;
+
+        auto pAdmission = RemoteCall::GetAdmission();
+        pAdmission->Configure(policy);
+
+        RequestTransport requests;
+        thread blocked([&requests]() { requests(Block()); });
+
+        while (!pAdmission->InFlight())
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        vector<char> vOut;
+        RemoteCall::ProcessCallback(batch, vOut);
+
+        TEST_CHECK(RemoteCall::Exception::NoError == Error(vOut));
+        TEST_CHECK(1 == pAdmission->Parked()  &&  Notes().empty());
+
+        s_release.set_value();
+        blocked.join();
+
+        TEST_CHECK(vector<int>({ 10, 11 }) == Notes());
+        TEST_CHECK(0 == pAdmission->Parked()  &&  0 == pAdmission->InFlight());
+
+        pAdmission->Disable();
+    }
+
+    cout << "TestCallbackQueue passed" << endl;
+
+    return 0;
+}
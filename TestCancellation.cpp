@@ -0,0 +1,134 @@
+// Tests of RemoteCallCancellation.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <thread>
+
+using namespace std;
+
+static atomic<bool> s_started{false};
+
+bool WaitRemoteFunction(int ms);
+bool REMOTE_FUNCTION_DECL(Wait)(int ms);
+
+// Returns true if the call is cancelled during 'ms'
+bool REMOTE_FUNCTION_IMPL(Wait)(int ms)
+{
+    s_started = true;
+
+    auto end = chrono::steady_clock::now() + chrono::milliseconds(ms);
+    while (chrono::steady_clock::now() < end)
+    {
+        if (RemoteCall::CurrentCancellation().Cancelled())
+            return true;
+
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    return false;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct CancelTransport: public RemoteCall::Transport<CancelTransport>
+{
+    explicit CancelTransport(const string& clientId)
+        : clientId_(clientId)
+    {}
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    void Send(const std::vector<char>& vIn)
+    {
+        std::vector<char> vOut;
+        RemoteCall::ProcessCall(vIn, vOut);
+    }
+
+    std::string ClientId() const override
+    {
+        return clientId_;
+    }
+
+    string clientId_;
+};
+
+// Returns true if the call of client 'a' is cancelled by '~Cancel' of 'canceller'
+static bool Cancels(CancelTransport& a, CancelTransport& canceller)
+{
+    RemoteCall::CancellationSource source;
+
+    s_started = false;
+
+    bool cancelled = false;
+    thread call([&]() { cancelled = a(Wait(300).Cancellation(source)); });
+
+    while (!s_started)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    canceller(source.Cancel());
+    call.join();
+
+    return cancelled;
+}
+
+
+int main()
+{
+    CancelTransport a("A"), b("B");
+
+    // Client cancels only its own calls
+    TEST_CHECK(!Cancels(a, b));
+    TEST_CHECK(Cancels(a, a));
+
+    // Call received after '~Cancel' is cancelled
+    {
+        RemoteCall::CancellationSource source;
+
+        b(source.Cancel());
+        TEST_CHECK(!a(Wait(1).Cancellation(source)));
+
+        a(source.Cancel());
+
+        bool rejected = false;
+        try
+        {
+            a(Wait(1000).Cancellation(source));
+        }
+        catch (const RemoteCall::Exception& e)
+        {
+            rejected = RemoteCall::Exception::Cancelled == e.Error();
+        }
+
+        TEST_CHECK(rejected);
+    }
+
+    // Cancelled id is kept until the deadline of '~Cancel'
+    {
+        auto pCancellations = RemoteCall::GetCancellations();
+        size_t count = pCancellations->CancelledCount();
+
+        RemoteCall::CancellationSource source;
+        a.WithDeadline(chrono::milliseconds(50))(source.Cancel());
+        TEST_CHECK(count + 1 == pCancellations->CancelledCount());
+
+        this_thread::sleep_for(chrono::milliseconds(100));
+
+        TEST_CHECK(count == pCancellations->CancelledCount());
+        TEST_CHECK(!a(Wait(1).Cancellation(source)));
+    }
+
+    cout << "TestCancellation passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Tests of RemoteCallChecksum.h, built with TestServer.cpp. Prints speed of CRC32C computed by processor instructions and by table.
+#include "TestRemoteCall.h"
+
+#include <chrono>
+
+using namespace std;
+
+string ChecksumEchoRemoteFunction(const string& s);
+string REMOTE_FUNCTION_DECL(ChecksumEcho)(const string& s);
+
+string REMOTE_FUNCTION_IMPL(ChecksumEcho)(const string& s)
+{
+    return s;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Corrupts the frame or the reply, removes the checksum of the reply or the flag of the frame
+struct ChecksumTransport: public RemoteCall::Transport<ChecksumTransport>
+{
+    enum Mode { Normal, CorruptFrame, CorruptReply, Unsealed, Unflagged };
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        auto frame = vIn;
+
+        if (CorruptFrame == mode_)
+        {
+            frame.back() ^= 1;
+        }
+
+        if (Unflagged == mode_)
+        {
+            frame[RemoteCall::FrameFlagsOffset + 1] &= ~(RemoteCall::HasChecksum >> 8);
+        }
+
+        RemoteCall::ProcessCall(frame, vOut);
+        vOut_ = vOut;
+
+        if (CorruptReply == mode_)
+        {
+            vOut.back() ^= 1;
+        }
+
+        if (Unsealed == mode_)
+        {
+            vOut.erase(vOut.begin(), vOut.begin() + 1 + RemoteCall::ChecksumSize);
+        }
+
+        return true;
+    }
+
+    bool UseSession() const override
+    {
+        return true;
+    }
+
+    bool Checksums() const override
+    {
+        return true;
+    }
+
+    Mode mode_ = Normal;
+
+    // Reply of the server
+    mutable std::vector<char> vOut_;
+};
+
+// Error of the call (NoError if it succeeded)
+template <typename C>
+static int Error(ChecksumTransport& transport, const C& call)
+{
+    try
+    {
+        transport(call);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+// Reply of the server has checksum
+static bool Sealed(const vector<char>& vOut)
+{
+    vector<char> checked;
+
+    return RemoteCall::CheckReply(vOut, checked);
+}
+
+// Prints speed of 'crc32c' of one thread
+template <typename F>
+static void Measure(const string& name, F crc32c)
+{
+    vector<char> data(1024 * 1024, 'a');
+    const int count = 100;
+
+    uint32_t crc = 0;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        crc = crc32c(data.data(), data.size(), crc);
+    }
+
+    auto time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    cout << "CRC32C by " << name << ": " << (int)((double)data.size() * count / max<double>(1, (double)time)) << " MB/s (" << crc << ")" << endl;
+}
+
+
+int main()
+{
+    // CRC32C of the check value, it continues the CRC32C of the preceding bytes
+    {
+        const char check[] = "123456789";
+
+        TEST_CHECK(0xE3069283 == RemoteCall::Crc32c(check, 9));
+        TEST_CHECK(0xE3069283 == ~RemoteCall::Crc32cTable(check, 9, ~0u));
+        TEST_CHECK(0xE3069283 == RemoteCall::Crc32c(check + 4, 5, RemoteCall::Crc32c(check, 4)));
+
+        if (RemoteCall::HasCrc32cInstructions())
+        {
+            TEST_CHECK(0xE3069283 == ~RemoteCall::Crc32cHardware(check, 9, ~0u));
+        }
+    }
+
+    ChecksumTransport transport;
+    string s(3000, 'x');
+
+    // Frame and reply have checksum
+    {
+        TEST_CHECK(s == transport(ChecksumEcho(s)));
+        TEST_CHECK(s == transport(ChecksumEcho(s))  &&  Sealed(transport.vOut_));
+    }
+
+    // Corrupted frame and reply are rejected, error reply of the server has checksum
+    {
+        transport.mode_ = ChecksumTransport::CorruptFrame;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(transport, ChecksumEcho(s))  &&  Sealed(transport.vOut_));
+
+        transport.mode_ = ChecksumTransport::CorruptReply;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(transport, ChecksumEcho(s)));
+    }
+
+    // Reply without checksum, and frame of the session whose flag was cleared, are rejected
+    {
+        transport.mode_ = ChecksumTransport::Unsealed;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(transport, ChecksumEcho(s)));
+
+        transport.mode_ = ChecksumTransport::Unflagged;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(transport, ChecksumEcho(s))  &&  Sealed(transport.vOut_));
+
+        transport.mode_ = ChecksumTransport::Normal;
+        TEST_CHECK(s == transport(ChecksumEcho(s)));
+    }
+
+    // Truncated frame and reply
+    {
+        vector<char> out;
+        size_t size = 0;
+        vector<char> frame(RemoteCall::FramePrefixSize + 2, 0);
+        frame[0] = (char)RemoteCall::FrameMagic;
+        frame[RemoteCall::FrameFlagsOffset + 1] = RemoteCall::HasChecksum >> 8;
+
+        bool thrown = false;
+        try
+        {
+            RemoteCall::CheckFrame(frame, size);
+        }
+        catch (const RemoteCall::Exception& e)
+        {
+            thrown = RemoteCall::Exception::InvalidFrame == e.Error();
+        }
+
+        TEST_CHECK(thrown);
+
+        thrown = false;
+        try
+        {
+            RemoteCall::CheckReply(vector<char>({ (char)RemoteCall::ChecksummedReply, 0, 0 }), out);
+        }
+        catch (const RemoteCall::Exception& e)
+        {
+            thrown = RemoteCall::Exception::InvalidFrame == e.Error();
+        }
+
+        TEST_CHECK(thrown);
+    }
+
+    if (RemoteCall::HasCrc32cInstructions())
+    {
+        Measure("instructions", [](const char* p, size_t size, uint32_t crc) { return ~RemoteCall::Crc32cHardware(p, size, ~crc); });
+    }
+
+    Measure("table", [](const char* p, size_t size, uint32_t crc) { return ~RemoteCall::Crc32cTable(p, size, ~crc); });
+
+    cout << "TestChecksum passed" << endl;
+
+    return 0;
+}
@@ -1,5 +1,5 @@
 #include "TestRemoteCall.h"
-#include <typeinfo.h>
+#include <typeinfo>
 
 using namespace std;
 
@@ -47,9 +47,9 @@ struct ClientTransport: public RemoteCall::Transport<ClientTransport>
 // For testing, emulates request from server (used for callback replies to the client)
 void ClientRequestHandler(const std::vector<char>& vIn)
 {
-    // 'RemoteCall::ProcessCall' function should be called when 'vIn' is received from server.
+    // 'RemoteCall::ProcessCallback' function should be called when 'vIn' is received from server.
     std::vector<char> vOut;
-    RemoteCall::ProcessCall(vIn, vOut);
+    RemoteCall::ProcessCallback(vIn, vOut);
 }
 
 
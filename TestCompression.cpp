@@ -0,0 +1,255 @@
+// Tests of RemoteCallCompression.h, built with TestServer.cpp. Prints compressed sizes and speed of LzCodec for vector of ints and map of strings.
+#include "TestRemoteCall.h"
+
+#include <random>
+#include <chrono>
+
+using namespace std;
+
+vector<int> CompressionEchoRemoteFunction(const vector<int>& v);
+vector<int> REMOTE_FUNCTION_DECL(CompressionEcho)(const vector<int>& v);
+
+vector<int> REMOTE_FUNCTION_IMPL(CompressionEcho)(const vector<int>& v)
+{
+    return v;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Keeps the last frame and reply as they were sent
+struct CompressionTransport: public RemoteCall::Transport<CompressionTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        vIn_ = vIn;
+        vOut_ = vOut;
+
+        return true;
+    }
+
+    bool UseSession() const override
+    {
+        return true;
+    }
+
+    uint8_t Compression() const override
+    {
+        return RemoteCall::CodecLz;
+    }
+
+    mutable std::vector<char> vIn_, vOut_;
+};
+
+static vector<char> RoundTrip(const vector<char>& data)
+{
+    vector<char> compressed;
+    RemoteCall::GetCodecs()->Get(RemoteCall::CodecLz)->Compress(data.data(), data.size(), compressed);
+
+    vector<char> out(data.size());
+    TEST_CHECK(RemoteCall::GetCodecs()->Get(RemoteCall::CodecLz)->Decompress(compressed.data(), compressed.size(), out.data(), out.size()));
+
+    return out;
+}
+
+// Error of 'f' (NoError if it succeeded)
+template <typename F>
+static int Error(const F& f)
+{
+    try
+    {
+        f();
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+template <typename T>
+static vector<char> Serialized(const T& t)
+{
+    RemoteCall::Serializer writer;
+    writer << t;
+
+    return writer;
+}
+
+// Prints compressed size, compression and decompression speed of one thread
+static size_t Measure(const string& name, const vector<char>& data)
+{
+    const int count = 200;
+
+    vector<char> compressed;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        compressed.clear();
+        TEST_CHECK(RemoteCall::Compress(RemoteCall::CodecLz, data.data(), data.size(), compressed));
+    }
+
+    auto compressTime = chrono::steady_clock::now() - start;
+
+    vector<char> out;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        out.clear();
+        RemoteCall::Decompress(compressed.data(), compressed.size(), out);
+    }
+
+    auto decompressTime = chrono::steady_clock::now() - start;
+    TEST_CHECK(data == out);
+
+    auto speed = [&data, count](chrono::steady_clock::duration time)
+    {
+        return (double)data.size() * count / max<double>(1, (double)chrono::duration_cast<chrono::microseconds>(time).count());
+    };
+
+    cout << name << ": " << data.size() << " bytes compressed to " << compressed.size() << ", compression " << (int)speed(compressTime) <<
+        " MB/s, decompression " << (int)speed(decompressTime) << " MB/s" << endl;
+
+    return compressed.size();
+}
+
+
+int main()
+{
+    // Round trip of empty, short, incompressible and repetitive data
+    {
+        TEST_CHECK(RoundTrip(vector<char>()).empty());
+        TEST_CHECK(vector<char>({ 'a', 'b', 'c' }) == RoundTrip(vector<char>({ 'a', 'b', 'c' })));
+
+        mt19937 random(1);
+        vector<char> noise(100000);
+        for (auto& el: noise)
+        {
+            el = (char)random();
+        }
+
+        TEST_CHECK(noise == RoundTrip(noise));
+
+        vector<char> compressed;
+        TEST_CHECK(!RemoteCall::Compress(RemoteCall::CodecLz, noise.data(), noise.size(), compressed));
+
+        vector<char> same(100000, 'a');
+        TEST_CHECK(same == RoundTrip(same));
+
+        compressed.clear();
+        TEST_CHECK(RemoteCall::Compress(RemoteCall::CodecLz, same.data(), same.size(), compressed)  &&  compressed.size() < 1000);
+
+        // Matches overlapping the bytes they produce, matches longer than 15 and distant matches
+        vector<char> pattern;
+        for (int i = 0; i < 100000; i++)
+        {
+            pattern.push_back("abcabcabd"[i % 9]);
+            pattern.push_back((char)(i % 70000 / 7));
+        }
+
+        TEST_CHECK(pattern == RoundTrip(pattern));
+    }
+
+    // Frame and reply are compressed in session, server reads them back
+    vector<int> v(20000);
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        v[i] = (int)(i % 100);
+    }
+
+    CompressionTransport transport;
+    {
+        TEST_CHECK(v == transport(CompressionEcho(v)));
+        TEST_CHECK(transport(CompressionEcho(v)) == v);
+
+        uint16_t flags;
+        memcpy(&flags, transport.vIn_.data() + RemoteCall::FrameFlagsOffset, sizeof(flags));
+        TEST_CHECK((flags & RemoteCall::Compressed)  &&  transport.vIn_.size() < v.size() * sizeof(int) / 4);
+
+        vector<char> reply;
+        TEST_CHECK(RemoteCall::DecompressReply(transport.vOut_, reply));
+    }
+
+    // Truncated and corrupted frames and replies are rejected
+    {
+        auto frame = transport.vIn_;
+        vector<char> out;
+
+        auto bad = frame;
+        bad.pop_back();
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressFrame(bad, out); }));
+
+        // Length of the frame matches, the compressed data is truncated
+        bad.assign(frame.begin(), frame.begin() + RemoteCall::FramePrefixSize + 100);
+        RemoteCall::Serializer writer(bad);
+        RemoteCall::SetFrameLength(writer);
+        bad = writer;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressFrame(bad, out); }));
+
+        bad.assign(frame.begin(), frame.begin() + RemoteCall::FramePrefixSize + 2);
+        writer = bad;
+        RemoteCall::SetFrameLength(writer);
+        bad = writer;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressFrame(bad, out); }));
+
+        // Unknown codec
+        bad = frame;
+        bad[RemoteCall::FramePrefixSize] = (char)0x7F;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressFrame(bad, out); }));
+
+        // Original size is too big, or does not match the data
+        for (uint32_t originalSize: { (uint32_t)RemoteCall::MaxDecompressedSize + 1, 100u })
+        {
+            bad = frame;
+            memcpy(bad.data() + RemoteCall::FramePrefixSize + 1, &originalSize, sizeof(originalSize));
+            TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressFrame(bad, out); }));
+        }
+
+        // Match before the start of the data
+        vector<char> reply = { (char)RemoteCall::CompressedReply, (char)RemoteCall::CodecLz, 4, 0, 0, 0, 0x00, (char)0xFF, (char)0xFF };
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressReply(reply, out); }));
+
+        reply = transport.vOut_;
+        reply.resize(reply.size() / 2);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressReply(reply, out); }));
+
+        reply.resize(3);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error([&]() { RemoteCall::DecompressReply(reply, out); }));
+    }
+
+    // Sizes and speed of the data of README
+    {
+        map<string, int> m;
+        for (int i = 0; i < 2000; i++)
+        {
+            m[RemoteCall::ToString() << "configuration key " << i] = i;
+        }
+
+        auto vSize = Measure("Vector of 20000 ints (0-99)", Serialized(v));
+        auto mSize = Measure("Map of 2000 string keys", Serialized(m));
+
+        TEST_CHECK(vSize < Serialized(v).size() / 4  &&  mSize < Serialized(m).size());
+
+        // Byte-aligned sequences do not repeat in consecutive ints, they are sent as is
+        vector<int> sequence(20000);
+        for (size_t i = 0; i < sequence.size(); i++)
+        {
+            sequence[i] = (int)i;
+        }
+
+        vector<char> compressed;
+        auto data = Serialized(sequence);
+        TEST_CHECK(!RemoteCall::Compress(RemoteCall::CodecLz, data.data(), data.size(), compressed));
+    }
+
+    cout << "TestCompression passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+// Tests of RemoteCallDelta.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+void TouchRemoteFunction(vector<int>& v, map<int, string>& m, int index);
+void REMOTE_FUNCTION_DECL(Touch)(vector<int>& v, map<int, string>& m, int index);
+
+void REMOTE_FUNCTION_IMPL(Touch)(vector<int>& v, map<int, string>& m, int index)
+{
+    if (index < 0)
+        return;
+
+    v[index] = -1;
+    v.push_back(index);
+
+    m[index] = "changed";
+    m.erase(0);
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct DeltaTransport: public RemoteCall::Transport<DeltaTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+        replySize_ = vOut.size();
+
+        return true;
+    }
+
+    bool DeltaReplies() const override
+    {
+        return delta_;
+    }
+
+    bool delta_ = true;
+    size_t replySize_ = 0;
+};
+
+// Reads reply delta of vector 'v', returns false if it is rejected as invalid frame
+static bool ReadDelta(const RemoteCall::Serializer& delta, vector<int>& v)
+{
+    RemoteCall::Serializer reader(vector<char>(delta.Data(), delta.Data() + delta.Size()));
+
+    try
+    {
+        RemoteCall::ParamDelta<vector<int>>::Read(reader, v);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == e.Error());
+        return false;
+    }
+
+    return true;
+}
+
+
+int main()
+{
+    DeltaTransport transport;
+
+    vector<int> v(1000);
+    map<int, string> m;
+    for (int i = 0; i < 100; i++)
+    {
+        v[i] = i;
+        m[i] = to_string(i);
+    }
+
+    // Unchanged parameters
+    auto expectedV = v;
+    auto expectedM = m;
+
+    transport(Touch(v, m, -1));
+    TEST_CHECK(expectedV == v  &&  expectedM == m);
+    size_t unchangedSize = transport.replySize_;
+
+    // Changed elements
+    expectedV[5] = -1;
+    expectedV.push_back(5);
+    expectedM[5] = "changed";
+    expectedM.erase(0);
+
+    transport(Touch(v, m, 5));
+    TEST_CHECK(expectedV == v  &&  expectedM == m);
+    size_t deltaSize = transport.replySize_;
+
+    // The same values as whole values
+    transport.delta_ = false;
+    expectedV[7] = -1;
+    expectedV.push_back(7);
+    expectedM[7] = "changed";
+
+    transport(Touch(v, m, 7));
+    TEST_CHECK(expectedV == v  &&  expectedM == m);
+    TEST_CHECK(unchangedSize < deltaSize  &&  deltaSize * 10 < transport.replySize_);
+
+    // Malformed vector deltas
+    {
+        RemoteCall::Serializer delta;
+        delta << (char)RemoteCall::ReplyDelta << (size_t)3 << (size_t)1 << (size_t)1 << 10;
+
+        vector<int> received = { 1, 2, 3 };
+        TEST_CHECK(ReadDelta(delta, received));
+        TEST_CHECK((vector<int>{ 1, 10, 3 }) == received);
+    }
+    {
+        // Index out of range
+        RemoteCall::Serializer delta;
+        delta << (char)RemoteCall::ReplyDelta << (size_t)3 << (size_t)1 << (size_t)3 << 10;
+
+        vector<int> received = { 1, 2, 3 };
+        TEST_CHECK(!ReadDelta(delta, received));
+    }
+    {
+        // Size larger than the elements which can follow
+        RemoteCall::Serializer delta;
+        delta << (char)RemoteCall::ReplyDelta << (size_t)-1 << (size_t)0;
+
+        vector<int> received = { 1, 2, 3 };
+        TEST_CHECK(!ReadDelta(delta, received));
+    }
+    {
+        // Count larger than the remaining bytes
+        RemoteCall::Serializer delta;
+        delta << (char)RemoteCall::ReplyDelta << (size_t)1 << (size_t)-1 << (size_t)0 << 10;
+
+        vector<int> received = { 1, 2, 3 };
+        TEST_CHECK(!ReadDelta(delta, received));
+    }
+    {
+        // Truncated element
+        RemoteCall::Serializer delta;
+        delta << (char)RemoteCall::ReplyDelta << (size_t)3 << (size_t)1 << (size_t)0;
+
+        vector<int> received = { 1, 2, 3 };
+        TEST_CHECK(!ReadDelta(delta, received));
+    }
+
+    cout << "TestDelta passed" << endl;
+
+    return 0;
+}
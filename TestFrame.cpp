@@ -0,0 +1,222 @@
+// Tests of RemoteCallFrame.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+int FrameEchoRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(FrameEcho)(int n);
+
+int REMOTE_FUNCTION_IMPL(FrameEcho)(int n)
+{
+    return n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Transport which returns the reply of the previous call, the reply without correlation id, or an error which is not correlated
+struct FrameTransport: public RemoteCall::Transport<FrameTransport>
+{
+    enum Mode { Normal, Previous, Stripped, Error };
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        vIn_ = vIn;
+
+        std::vector<char> reply;
+        RemoteCall::ProcessCall(vIn, reply);
+
+        switch (mode_)
+        {
+        case Normal:
+            vOut = reply;
+            break;
+
+        case Previous:
+            vOut = previous_;
+            break;
+
+        case Stripped:
+            vOut.assign(reply.begin() + RemoteCall::CorrelatedPrefixSize, reply.end());
+            break;
+
+        case Error:
+        {
+            RemoteCall::Serializer writer;
+            writer << RemoteCall::Exception(RemoteCall::Exception::Overloaded, "Server is overloaded.");
+
+            vOut = writer;
+            break;
+        }
+        }
+
+        previous_ = reply;
+
+        return true;
+    }
+
+    Mode mode_ = Normal;
+    mutable std::vector<char> vIn_, previous_;
+};
+
+// Error of the call (NoError if it succeeded)
+template <typename C>
+static int Error(FrameTransport& transport, const C& call)
+{
+    try
+    {
+        transport(call);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+// Reads the header of 'frame', returns error of the read (NoError if it succeeded)
+static int ReadHeader(const vector<char>& frame, RemoteCall::FrameHeader& header)
+{
+    RemoteCall::Serializer reader(frame);
+
+    try
+    {
+        reader >> header;
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+// Error of the server reply to 'frame'
+static int ReplyError(const vector<char>& frame)
+{
+    vector<char> vOut;
+    RemoteCall::ProcessCall(frame, vOut);
+
+    RemoteCall::Serializer reader(vOut);
+    if (!reader.GetCurrent())
+        return RemoteCall::Exception::NoError;
+
+    RemoteCall::Exception e;
+    reader >> e;
+
+    return e.Error();
+}
+
+
+int main()
+{
+    // All fields of the header are read as they were written
+    vector<char> frame;
+    {
+        RemoteCall::FrameHeader header("client of the frame test", RemoteCall::DeltaReplies);
+        header.kind_ = RemoteCall::MethodCall;
+        header.idempotencyKey_ = "key";
+        header.deadline_ = RemoteCall::Deadline(chrono::microseconds(1234567));
+        header.cancelId_ = "cancel";
+        header.priority_ = RemoteCall::PriorityHigh;
+        header.correlationId_ = 0x12345678;
+
+        RemoteCall::Serializer writer;
+        writer << header << string("body");
+        RemoteCall::SetFrameLength(writer);
+        frame = writer;
+
+        RemoteCall::FrameHeader read;
+        TEST_CHECK(RemoteCall::Exception::NoError == ReadHeader(frame, read));
+        TEST_CHECK(RemoteCall::MethodCall == read.kind_  &&  "client of the frame test" == read.clientId_);
+        TEST_CHECK((read.flags_ & RemoteCall::DeltaReplies)  &&  (read.flags_ & RemoteCall::HasClientId));
+        TEST_CHECK("key" == read.idempotencyKey_  &&  header.deadline_ == read.deadline_  &&  "cancel" == read.cancelId_);
+        TEST_CHECK(RemoteCall::PriorityHigh == read.priority_  &&  0 == read.sessionId_);
+        TEST_CHECK(0x12345678 == read.correlationId_  &&  0x12345678 == RemoteCall::FrameCorrelationId(frame.data(), frame.size()));
+        TEST_CHECK(frame.size() - RemoteCall::FramePrefixSize == read.length_);
+
+        header.sessionId_ = 7;
+
+        writer.clear();
+        writer << header;
+        RemoteCall::SetFrameLength(writer);
+
+        TEST_CHECK(RemoteCall::Exception::NoError == ReadHeader(writer, read));
+        TEST_CHECK(7 == read.sessionId_  &&  !(read.flags_ & RemoteCall::HasClientId)  &&  7 == RemoteCall::FrameSessionId(writer));
+    }
+
+    // Malformed frames are rejected, their error replies do not have correlation id
+    {
+        RemoteCall::FrameHeader header;
+
+        auto bad = frame;
+        bad[0] = 0;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header)  &&  0 == header.correlationId_);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReplyError(bad));
+
+        bad = frame;
+        bad[1] = RemoteCall::FrameVersion + 1;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header));
+
+        bad = frame;
+        bad[2] = RemoteCall::CallKindCount;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header));
+
+        bad.assign(frame.begin(), frame.begin() + RemoteCall::FramePrefixSize - 1);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header));
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReplyError(bad));
+
+        bad.assign(frame.begin(), frame.end() - 1);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header));
+
+        bad = frame;
+        bad.push_back(0);
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadHeader(bad, header));
+
+        TEST_CHECK(0 == RemoteCall::FrameCorrelationId(bad.data(), RemoteCall::FramePrefixSize - 1));
+    }
+
+    // Client takes only the reply of its call
+    {
+        FrameTransport transport;
+
+        TEST_CHECK(1 == transport(FrameEcho(1)));
+        auto first = RemoteCall::FrameCorrelationId(transport.vIn_.data(), transport.vIn_.size());
+
+        TEST_CHECK(2 == transport(FrameEcho(2)));
+        auto second = RemoteCall::FrameCorrelationId(transport.vIn_.data(), transport.vIn_.size());
+        TEST_CHECK(first  &&  second  &&  first != second);
+
+        // Reply of the previous call
+        transport.mode_ = FrameTransport::Previous;
+        TEST_CHECK(RemoteCall::Exception::TransportError == Error(transport, FrameEcho(3)));
+
+        // Successful reply without correlation id
+        transport.mode_ = FrameTransport::Stripped;
+        TEST_CHECK(RemoteCall::Exception::TransportError == Error(transport, FrameEcho(4)));
+
+        // Error reply of the server which could not read the header
+        transport.mode_ = FrameTransport::Error;
+        TEST_CHECK(RemoteCall::Exception::Overloaded == Error(transport, FrameEcho(5)));
+
+        transport.mode_ = FrameTransport::Normal;
+        TEST_CHECK(6 == transport(FrameEcho(6)));
+
+        // Error reply of the executed call is correlated
+        vector<char> vOut;
+        auto call = transport.vIn_;
+        call[RemoteCall::FramePrefixSize] = 0;
+        RemoteCall::ProcessCall(call, vOut);
+        TEST_CHECK(RemoteCall::CorrelatedReply == (uint8_t)vOut[0]  &&  vOut[RemoteCall::CorrelatedPrefixSize]);
+        TEST_CHECK(RemoteCall::CorrelatedPrefixSize == RemoteCall::CheckCorrelation(vOut, RemoteCall::FrameCorrelationId(call.data(), call.size())));
+    }
+
+    cout << "TestFrame passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+// Tests of gather mode of RemoteCallSerializer.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Transport which receives frame as segments, it records how many of them reference arguments
+struct GatherTransport: public RemoteCall::Transport<GatherTransport>
+{
+    bool SendReceiveV(const iovec* pIov, size_t count, std::vector<char>& vOut)
+    {
+        std::vector<char> vIn;
+        for (size_t i = 0; i < count; i++)
+        {
+            vIn.insert(vIn.end(), (const char*)pIov[i].iov_base, (const char*)pIov[i].iov_base + pIov[i].iov_len);
+        }
+
+        segments_ = count;
+
+        // Argument which was copied to the frame can be destroyed before the frame is sent
+        if (!overwrite_.empty())
+        {
+            std::fill(overwrite_.begin(), overwrite_.end(), '#');
+        }
+
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    size_t segments_ = 0;
+    string overwrite_;
+};
+
+
+int main()
+{
+    GatherTransport transport;
+
+    string big(100000, 'b');
+
+    // Copied by default
+    ITest* pTest = transport(TestClassFactory(big, "c"));
+    TEST_CHECK(1 == transport.segments_);
+
+    string s;
+    int n;
+    transport(pTest->GetData(s, n));
+    TEST_CHECK(big == s);
+
+    transport(RemoteCall::Delete(pTest));
+
+    // Referenced if it is passed via Ref
+    pTest = transport(TestClassFactory(RemoteCall::Serializer::Ref<string>{ big }, "c"));
+    TEST_CHECK(transport.segments_ > 1);
+
+    transport(pTest->GetData(s, n));
+    TEST_CHECK(big == s);
+
+    transport(RemoteCall::Delete(pTest));
+
+    // Copy is not changed by changes of the argument after it is written
+    transport.overwrite_ = big;
+    pTest = transport(TestClassFactory(transport.overwrite_, "c"));
+    transport.overwrite_.clear();
+
+    transport(pTest->GetData(s, n));
+    TEST_CHECK(big == s);
+
+    transport(RemoteCall::Delete(pTest));
+
+    cout << "TestGather passed" << endl;
+
+    return 0;
+}
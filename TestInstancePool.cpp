@@ -0,0 +1,137 @@
+// Tests of RemoteCallInstancePool.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallInstancePool.h"
+
+using namespace std;
+
+REMOTE_INTERFACE(IPooled)
+{
+    virtual int REMOTE_METHOD_DECL(Value)() = 0;
+};
+
+static int s_constructed = 0;
+
+class CPooled: public IPooled
+{
+public:
+    explicit CPooled(int n)
+        : n_(n)
+    {
+        s_constructed++;
+    }
+
+    void Reset(int n)
+    {
+        n_ = n;
+    }
+
+    int REMOTE_METHOD_IMPL(Value)() override
+    {
+        return n_;
+    }
+
+private:
+    int n_;
+};
+
+static RemoteCall::InstancePool<CPooled> s_pool;
+
+IPooled* CreatePooledRemoteFunction(int n);
+IPooled* REMOTE_FUNCTION_DECL(CreatePooled)(int n);
+
+IPooled* REMOTE_FUNCTION_IMPL(CreatePooled)(int n)
+{
+    return s_pool.Create(n);
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct PoolTransport: public RemoteCall::Transport<PoolTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+};
+
+// Creates the instance, returns its id after its value is checked and it is deleted by client
+static string CreateAndDelete(PoolTransport& transport, int n)
+{
+    IPooled* pPooled = transport(CreatePooled(n));
+    TEST_CHECK(n == transport(pPooled->Value()));
+
+    string instanceId = pPooled->instanceId_;
+    transport(RemoteCall::Delete(pPooled));
+
+    return instanceId;
+}
+
+// Error of the method call to the instance id (NoError if it succeeded)
+static int Error(const string& instanceId)
+{
+    RemoteCall::FrameHeader header;
+    header.kind_ = RemoteCall::MethodCall;
+
+    RemoteCall::Serializer reader;
+    RemoteCall::Serializer reply(RemoteCall::ProcessClassCall(header, instanceId, "Value", reader));
+    if (!reply.GetCurrent())
+        return RemoteCall::Exception::NoError;
+
+    RemoteCall::Exception e;
+    reply >> e;
+
+    return e.Error();
+}
+
+
+int main()
+{
+    PoolTransport transport;
+
+    // Released instance is reused by Reset, its generation goes before the current node tag
+    RemoteCall::SetNodeTag("");
+    auto first = CreateAndDelete(transport, 1);
+    TEST_CHECK(string::npos == first.find('@')  &&  string::npos == first.find('.'));
+    TEST_CHECK(1 == s_constructed  &&  1 == s_pool.Size()  &&  1 == s_pool.Free());
+
+    RemoteCall::SetNodeTag("node");
+    auto second = CreateAndDelete(transport, 2);
+    TEST_CHECK(first + ".1@node" == second);
+
+    auto third = CreateAndDelete(transport, 3);
+    TEST_CHECK(first + ".2@node" == third  &&  "node" == RemoteCall::InstanceNodeTag(third));
+    TEST_CHECK(1 == s_constructed  &&  1 == s_pool.Size()  &&  1 == s_pool.Free());
+
+    // Calls with ids of the previous generations fail
+    {
+        IPooled* pPooled = transport(CreatePooled(4));
+        TEST_CHECK(0 == s_pool.Free()  &&  1 == s_constructed);
+
+        TEST_CHECK(RemoteCall::Exception::NoError == Error(pPooled->instanceId_));
+
+        for (auto& stale: { first, second, third })
+        {
+            TEST_CHECK(RemoteCall::Exception::InvalidClassInstance == Error(stale));
+        }
+
+        // Instance in use is not reused, the second one is constructed
+        IPooled* pOther = transport(CreatePooled(5));
+        TEST_CHECK(5 == transport(pOther->Value())  &&  4 == transport(pPooled->Value()));
+        TEST_CHECK(2 == s_constructed  &&  2 == s_pool.Size());
+
+        transport(RemoteCall::Delete(pPooled));
+        transport(RemoteCall::Delete(pOther));
+        TEST_CHECK(2 == s_pool.Free());
+    }
+
+    cout << "TestInstancePool passed" << endl;
+
+    return 0;
+}
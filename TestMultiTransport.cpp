@@ -0,0 +1,135 @@
+// Tests of RemoteCallMultiTransport.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallMultiTransport.h"
+
+#include <thread>
+
+using namespace std;
+
+static atomic<int> s_executed{0};
+static atomic<int> s_sent{0};
+
+int SlowRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(Slow)(int n);
+
+int REMOTE_FUNCTION_IMPL(Slow)(int n)
+{
+    s_executed++;
+
+    this_thread::sleep_for(chrono::milliseconds(50));
+
+    return n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct EndpointTransport: public RemoteCall::Transport<EndpointTransport>
+{
+    explicit EndpointTransport(const string& address)
+        : address_(address)
+    {}
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        s_sent++;
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    // Endpoints share the server in this process, they are different clients of it
+    std::string ClientId() const override
+    {
+        return address_;
+    }
+
+    string address_;
+};
+
+// Runs 'count' concurrent idempotent calls, returns how many times they were executed
+static int Execute(const RemoteCall::CallPolicy& policy, int count)
+{
+    RemoteCall::MultiTransport<EndpointTransport> transport({ "a", "b" }, policy);
+
+    s_executed = 0;
+
+    vector<thread> threads;
+    for (int i = 0; i < count; i++)
+    {
+        threads.emplace_back([&transport, i]()
+        {
+            TEST_CHECK(i == transport(Slow(i).Idempotent()));
+        });
+    }
+
+    for (auto& thread: threads)
+    {
+        thread.join();
+    }
+
+    return s_executed;
+}
+
+
+int main()
+{
+    RemoteCall::CallPolicy policy;
+    policy.initialHedgeDelay_ = chrono::milliseconds(1);
+
+    // Every slow call is hedged
+    TEST_CHECK(16 == Execute(policy, 8));
+
+    // Calls over the limit are not hedged
+    policy.maxHedges_ = 2;
+    int executed = Execute(policy, 8);
+    TEST_CHECK(executed >= 9  &&  executed <= 10);
+
+    policy.maxHedges_ = 0;
+    TEST_CHECK(8 == Execute(policy, 8));
+
+    // Unknown node tag is requested from endpoints once during 'unknownTagTime_'
+    {
+        RemoteCall::MultiTransport<EndpointTransport> transport({ "a", "b" }, policy);
+
+        auto unknown = [&transport]()
+        {
+            try
+            {
+                transport(RemoteCall::MethodInfo<true, void>("1@unknown", "Method"));
+            }
+            catch (const RemoteCall::Exception& e)
+            {
+                return RemoteCall::Exception::InvalidClassInstance == e.Error();
+            }
+
+            return false;
+        };
+
+        s_sent = 0;
+        TEST_CHECK(unknown());
+        TEST_CHECK(2 == s_sent);
+
+        TEST_CHECK(unknown());
+        TEST_CHECK(2 == s_sent);
+
+        // Tags found when the unknown one was requested are used
+        ITest* pTest = transport(TestClassFactory("s", "c"));
+
+        string s;
+        int n;
+        transport(pTest->GetData(s, n));
+        TEST_CHECK("s" == s);
+        TEST_CHECK(4 == s_sent);
+
+        transport(RemoteCall::Delete(pTest));
+    }
+
+    cout << "TestMultiTransport passed" << endl;
+
+    return 0;
+}
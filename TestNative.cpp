@@ -0,0 +1,161 @@
+// Tests of RemoteCallNative.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+struct Point
+{
+    double x_, y_;
+    int tag_;
+};
+
+inline RemoteCall::Serializer& operator << (RemoteCall::Serializer& writer, const Point& point)
+{
+    return writer << point.x_ << point.y_ << point.tag_;
+}
+
+inline RemoteCall::Serializer& operator >> (RemoteCall::Serializer& reader, Point& point)
+{
+    return reader >> point.x_ >> point.y_ >> point.tag_;
+}
+
+// Same structure which is not marked
+struct Unmarked
+{
+    double x_, y_;
+    int tag_;
+};
+
+namespace RemoteCall
+{
+    template <> struct NativeLayout<Point>: std::true_type {};
+}
+
+enum Color: uint8_t { Red, Green, Blue };
+
+static_assert(RemoteCall::NativeArg<int>::value  &&  RemoteCall::NativeArg<const double&>::value  &&  RemoteCall::NativeArg<Color>::value, "");
+static_assert(RemoteCall::NativeArg<const Point&>::value  &&  !RemoteCall::NativeArg<const Unmarked&>::value, "");
+static_assert(!RemoteCall::NativeArg<bool>::value  &&  !RemoteCall::NativeArg<int*>::value  &&  !RemoteCall::NativeArg<int&>::value, "");
+static_assert(!RemoteCall::NativeArg<ITest*>::value  &&  !RemoteCall::NativeArg<const std::string&>::value, "");
+
+double NativeMixRemoteFunction(char c, long long l, Color color, const Point& point, short s, double d);
+double REMOTE_FUNCTION_DECL(NativeMix)(char c, long long l, Color color, const Point& point, short s, double d);
+
+double REMOTE_FUNCTION_IMPL(NativeMix)(char c, long long l, Color color, const Point& point, short s, double d)
+{
+    return c + l + color * 1000 + point.x_ * point.y_ + point.tag_ + s + d;
+}
+
+size_t NativeNameRemoteFunction(const string& name, int n);
+size_t REMOTE_FUNCTION_DECL(NativeName)(const string& name, int n);
+
+size_t REMOTE_FUNCTION_IMPL(NativeName)(const string& name, int n)
+{
+    return name.size() + n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Keeps the last frame, 'truncate' bytes are removed from the end of the native block
+struct NativeTransport: public RemoteCall::Transport<NativeTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        vIn_ = vIn;
+
+        RemoteCall::Serializer writer(vector<char>(vIn.begin(), vIn.end() - truncate_));
+        RemoteCall::SetFrameLength(writer);
+
+        RemoteCall::ProcessCall(writer, vOut);
+
+        return true;
+    }
+
+    bool UseSession() const override
+    {
+        return true;
+    }
+
+    bool UseNativeArgs() const override
+    {
+        return native_;
+    }
+
+    bool native_ = true;
+    size_t truncate_ = 0;
+    mutable std::vector<char> vIn_;
+};
+
+static uint16_t Flags(const vector<char>& frame)
+{
+    return RemoteCall::FrameFlagsOf(frame.data(), frame.size());
+}
+
+// Error of the call (NoError if it succeeded)
+template <typename C>
+static int Error(NativeTransport& transport, const C& call)
+{
+    try
+    {
+        transport(call);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+
+int main()
+{
+    Point point = { 1.5, 4, 7 };
+    auto expected = NativeMixRemoteFunction('a', 1ll << 40, Blue, point, short(-3), 0.25);
+
+    // Arguments are read in place as they were written, in native and in portable session
+    {
+        NativeTransport native, portable;
+        portable.native_ = false;
+
+        TEST_CHECK(expected == native(NativeMix('a', 1ll << 40, Blue, point, short(-3), 0.25)));
+        TEST_CHECK(Flags(native.vIn_) & RemoteCall::NativeArgs);
+
+        TEST_CHECK(expected == portable(NativeMix('a', 1ll << 40, Blue, point, short(-3), 0.25)));
+        TEST_CHECK(!(Flags(portable.vIn_) & RemoteCall::NativeArgs));
+
+        // Call with a string parameter uses the portable encoding
+        TEST_CHECK(7 == native(NativeName("abc", 4))  &&  !(Flags(native.vIn_) & RemoteCall::NativeArgs));
+    }
+
+    // Offsets of the block follow alignment of the declared parameters
+    {
+        using Pack = RemoteCall::NativePack<char, long long, Color, const Point&, short, double>;
+
+        TEST_CHECK(0 == Pack::Offset(0)  &&  alignof(long long) == Pack::Offset(1));
+        TEST_CHECK(Pack::Offset(1) + sizeof(long long) == Pack::Offset(2));
+        TEST_CHECK(RemoteCall::AlignUp(Pack::Offset(2) + 1, alignof(Point)) == Pack::Offset(3));
+        TEST_CHECK(Pack::Offset(3) + sizeof(Point) == Pack::Offset(4));
+        TEST_CHECK(RemoteCall::AlignUp(Pack::Offset(4) + sizeof(short), alignof(double)) == Pack::Offset(5));
+        TEST_CHECK(Pack::Offset(5) + sizeof(double) == Pack::Size()  &&  0 == Pack::Size() % Pack::Alignment());
+    }
+
+    // Truncated block is rejected
+    {
+        NativeTransport native;
+        TEST_CHECK(7 == native(NativeName("abc", 4)));
+
+        native.truncate_ = 1;
+
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == Error(native, NativeMix('a', 1ll << 40, Blue, point, short(-3), 0.25)));
+    }
+
+    cout << "TestNative passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Tests of RemoteCallPack.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+long long MixRemoteFunction(const string& s, long long n);
+long long REMOTE_FUNCTION_DECL(Mix)(const string& s, long long n);
+
+long long REMOTE_FUNCTION_IMPL(Mix)(const string& s, long long n)
+{
+    return (long long)s.size() + n;
+}
+
+double NumbersRemoteFunction(char c, long long l, const string& s, short n, double d, int& out);
+double REMOTE_FUNCTION_DECL(Numbers)(char c, long long l, const string& s, short n, double d, int& out);
+
+double REMOTE_FUNCTION_IMPL(Numbers)(char c, long long l, const string& s, short n, double d, int& out)
+{
+    out = (int)s.size();
+
+    return c + l + n + d;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct PackTransport: public RemoteCall::Transport<PackTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+};
+
+// Arguments of the frame after the header and the call name
+template <typename C>
+static vector<char> Args(PackTransport& transport, const C& call)
+{
+    RemoteCall::Serializer writer;
+    transport.WriteFrame(call, writer, false);
+
+    RemoteCall::Serializer reader(vector<char>(writer.Data(), writer.Data() + writer.Size()));
+
+    RemoteCall::FrameHeader header;
+    reader >> header;
+    RemoteCall::SkipName(reader);
+
+    return vector<char>(reader.ReadData(), reader.ReadData() + reader.Remaining());
+}
+
+
+int main()
+{
+    PackTransport transport;
+
+    // Arguments are converted to the declared types, in the fixed prefix and after it
+    {
+        int n = 5;
+        TEST_CHECK(8 == transport(Mix("abc", n)));
+        TEST_CHECK(1 - (1ll << 40) == transport(Mix(string("x"), -(1ll << 40))));
+
+        int out = 0;
+        TEST_CHECK(1.0 + 2 + 3 + 4.5 == transport(Numbers(1, 2, "abcd", 3, 4.5f, out))  &&  4 == out);
+    }
+
+    // The encoding is the same as writing the declared types one by one
+    {
+        RemoteCall::Serializer writer;
+        writer << string("abc") << (long long)5;
+
+        TEST_CHECK(vector<char>(writer) == Args(transport, Mix("abc", 5)));
+
+        int out = 7;
+        writer.clear();
+        writer << (char)1 << (long long)2 << string("abcd") << (short)3 << 4.5 << 7;
+
+        TEST_CHECK(vector<char>(writer) == Args(transport, Numbers(1, 2, "abcd", 3, 4.5f, out)));
+    }
+
+    cout << "TestPack passed" << endl;
+
+    return 0;
+}
@@ -2,6 +2,13 @@
 
 #include "RemoteCall.h"
 
+#include <iostream>
+#include <cstdlib>
+
+// Test programs (Test*.cpp built with TestServer.cpp) stop on the first failed check, also in release builds
+#define TEST_CHECK(condition) \
+    do { if (!(condition)) { std::cerr << __FILE__ << '(' << __LINE__ << "): " #condition << std::endl; std::exit(1); } } while (false)
+
 struct ABC
 {
    std::string s_;
@@ -31,6 +38,12 @@ REMOTE_INTERFACE(ITest)
 };
 
 
+// Functions are declared before the templates of REMOTE_FUNCTION_DECL which take their address
+std::tuple<int, std::string> TestSyncRemoteFunction(std::vector<ABC>& vABC, const std::map<int, std::string>& m);
+void SetTestCallbackRemoteFunction(const std::string&, ITestCallback*, int n);
+void TriggerTestCallbackRemoteFunction();
+ITest* TestClassFactoryRemoteFunction(const std::string& s, const std::string& c);
+
 std::tuple<int, std::string> REMOTE_FUNCTION_DECL(TestSync)(std::vector<ABC>& vABC, const std::map<int, std::string>& m);
 void REMOTE_FUNCTION_DECL(SetTestCallback)(const std::string&, ITestCallback*, int n);
 void REMOTE_FUNCTION_DECL(TriggerTestCallback)();
@@ -0,0 +1,141 @@
+// Tests of proxies of RemoteCallInterface.h and RemoteCallRemotePtr.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallRemotePtr.h"
+
+#include <thread>
+#include <atomic>
+
+using namespace std;
+
+// The last instance created by TestClassFactory (TestServer.cpp)
+extern ITest* s_pTest;
+
+ITest* LastTestRemoteFunction();
+ITest* REMOTE_FUNCTION_DECL(LastTest)();
+
+ITest* REMOTE_FUNCTION_IMPL(LastTest)()
+{
+    return s_pTest;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Counts frames sent by this thread and by others, frames of other threads wait until the gate is opened
+static const thread::id s_mainThread = this_thread::get_id();
+static atomic<bool> s_open{true};
+static atomic<int> s_sending{0};
+
+struct ProxyTransport: public RemoteCall::Transport<ProxyTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        if (s_mainThread == this_thread::get_id())
+        {
+            main_++;
+        }
+        else
+        {
+            s_sending++;
+
+            while (!s_open)
+            {
+                this_thread::sleep_for(chrono::milliseconds(1));
+            }
+
+            other_++;
+        }
+
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    mutable atomic<int> main_{0};
+    mutable atomic<int> other_{0};
+};
+
+
+int main()
+{
+    ProxyTransport transport;
+    auto pProxies = RemoteCall::GetProxies();
+
+    // Instance received twice has one proxy, Delete sends '~' with its last reference
+    {
+        ITest* pTest = transport(TestClassFactory("a", "c"));
+        ITest* pSame = transport(LastTest());
+        TEST_CHECK(pTest == pSame  &&  1 == pProxies->Count());
+
+        int sent = transport.main_;
+        transport(RemoteCall::Delete(pSame));
+        TEST_CHECK(sent == transport.main_  &&  1 == pProxies->Count());
+
+        // The other reference still uses the instance
+        string s;
+        int n = 0;
+        TEST_CHECK(transport(pTest->GetData(s, n))  &&  "a" == s);
+
+        transport(RemoteCall::Delete(pTest));
+        TEST_CHECK(sent + 2 == transport.main_  &&  0 == pProxies->Count());
+    }
+
+    // Delete of RemotePtr proxy received again does not delete the instance
+    {
+        RemoteCall::RemoteDeletes<ProxyTransport> deletes(transport);
+
+        auto pTest = deletes.Hold(transport(TestClassFactory("b", "c")));
+        transport(RemoteCall::Delete(transport(LastTest())));
+
+        string s;
+        int n = 0;
+        transport(pTest->UpdateData("!", 1));
+        TEST_CHECK(transport(pTest->GetData(s, n))  &&  "b!" == s);
+
+        pTest.reset();
+        TEST_CHECK(1 == deletes.Pending()  &&  0 == pProxies->Count());
+
+        int sent = transport.main_;
+        deletes.Flush();
+        TEST_CHECK(sent + 1 == transport.main_  &&  0 == deletes.Pending());
+    }
+
+    // Batch is sent by sender thread, releasing RemotePtr does not wait while it is sent
+    {
+        RemoteCall::RemoteDeletes<ProxyTransport> deletes(transport, 2);
+
+        vector<RemoteCall::RemotePtr<ITest>> tests;
+        for (int i = 0; i < 4; i++)
+        {
+            tests.push_back(deletes.Hold(transport(TestClassFactory("c", "c"))));
+        }
+
+        s_open = false;
+
+        int sent = transport.main_;
+        tests[0].reset();
+        tests[1].reset();
+
+        while (!s_sending)
+        {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        tests[2].reset();
+        tests[3].reset();
+        TEST_CHECK(2 == deletes.Pending()  &&  0 == transport.other_);
+
+        s_open = true;
+        deletes.Flush();
+
+        TEST_CHECK(sent == transport.main_  &&  2 == transport.other_  &&  0 == deletes.Pending());
+    }
+
+    cout << "TestRemotePtr passed" << endl;
+
+    return 0;
+}
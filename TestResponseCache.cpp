@@ -0,0 +1,123 @@
+// Tests of RemoteCallResponseCache.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+static int s_executed = 0;
+static bool s_fail = false;
+
+int CountRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(Count)(int n);
+
+int REMOTE_FUNCTION_IMPL(Count)(int n)
+{
+    s_executed++;
+
+    if (s_fail)
+        throw runtime_error("Failed");
+
+    return n + s_executed;
+}
+
+int OtherCountRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(OtherCount)(int n);
+
+int REMOTE_FUNCTION_IMPL(OtherCount)(int n)
+{
+    s_executed++;
+
+    return -n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct CacheTransport: public RemoteCall::Transport<CacheTransport>
+{
+    explicit CacheTransport(const string& clientId)
+        : clientId_(clientId)
+    {}
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    std::string ClientId() const override
+    {
+        return clientId_;
+    }
+
+    bool Checksums() const override
+    {
+        return checksums_;
+    }
+
+    string clientId_;
+    bool checksums_ = false;
+};
+
+// Returns false if the call throws ServerError
+template <typename C>
+static bool Succeeds(CacheTransport& transport, C call)
+{
+    try
+    {
+        transport(call);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        TEST_CHECK(RemoteCall::Exception::ServerError == e.Error());
+        return false;
+    }
+
+    return true;
+}
+
+
+int main()
+{
+    CacheTransport a("A"), b("B");
+
+    // Retry returns the stored reply
+    int first = a(Count(10).IdempotencyKey("k"));
+    TEST_CHECK(a(Count(10).IdempotencyKey("k")) == first);
+    TEST_CHECK(1 == s_executed);
+
+    // The same key of another client or of another call is not the same call
+    TEST_CHECK(b(Count(10).IdempotencyKey("k")) != first);
+    TEST_CHECK(2 == s_executed);
+
+    TEST_CHECK(-10 == a(OtherCount(10).IdempotencyKey("k")));
+    TEST_CHECK(3 == s_executed);
+
+    // Failed call is not stored, its retry is executed
+    s_fail = true;
+    TEST_CHECK(!Succeeds(a, Count(1).IdempotencyKey("f")));
+    TEST_CHECK(4 == s_executed);
+
+    s_fail = false;
+    TEST_CHECK(Succeeds(a, Count(1).IdempotencyKey("f")));
+    TEST_CHECK(5 == s_executed);
+
+    TEST_CHECK(Succeeds(a, Count(1).IdempotencyKey("f")));
+    TEST_CHECK(5 == s_executed);
+
+    // Reply is stored before it is sealed
+    CacheTransport c("C");
+    c.checksums_ = true;
+
+    first = c(Count(10).IdempotencyKey("k"));
+    TEST_CHECK(c(Count(10).IdempotencyKey("k")) == first);
+    TEST_CHECK(6 == s_executed);
+
+    cout << "TestResponseCache passed" << endl;
+
+    return 0;
+}
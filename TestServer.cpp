@@ -104,8 +104,8 @@ void REMOTE_FUNCTION_IMPL(TriggerTestCallback)()
     {
         s_transport(s_pCallback->CallFromServer(12345));
 
-        // delete to avoid local memory leak, it doesn't call server 
-        delete s_pCallback;
+        // release to avoid local memory leak, it doesn't call server 
+        RemoteCall::Release(s_pCallback);
 
         s_pCallback = 0;
     }
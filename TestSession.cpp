@@ -0,0 +1,163 @@
+// Tests of RemoteCallSession.h, built with TestServer.cpp. Prints sizes of a call frame without and with session.
+#include "TestRemoteCall.h"
+
+using namespace std;
+
+static string s_clientId;
+
+int SessionEchoRemoteFunction(int n);
+int REMOTE_FUNCTION_DECL(SessionEcho)(int n);
+
+int REMOTE_FUNCTION_IMPL(SessionEcho)(int n)
+{
+    s_clientId = RemoteCall::CurrentClientId();
+
+    return n;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct SessionTransport: public RemoteCall::Transport<SessionTransport>
+{
+    SessionTransport(bool session)
+        : session_(session)
+    {}
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::ProcessCall(vIn, vOut);
+        frameSize_ = vIn.size();
+        frames_++;
+
+        return true;
+    }
+
+    bool UseSession() const override
+    {
+        return session_;
+    }
+
+    std::string ClientId() const override
+    {
+        return "client of the session test";
+    }
+
+    bool session_;
+    mutable size_t frameSize_ = 0;
+    mutable int frames_ = 0;
+};
+
+// Reads name written by client session, returns error of the read (NoError if it succeeded)
+static int ReadName(const RemoteCall::Serializer& writer, RemoteCall::Session* pSession, string& s)
+{
+    RemoteCall::Serializer reader(vector<char>(writer.Data(), writer.Data() + writer.Size()));
+
+    try
+    {
+        s = RemoteCall::ReadName(reader, pSession);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return e.Error();
+    }
+
+    return RemoteCall::Exception::NoError;
+}
+
+
+int main()
+{
+    // Frame of the call carries session id and index of the confirmed name instead of the client id and the name
+    {
+        SessionTransport plain(false), transport(true);
+
+        TEST_CHECK(1 == plain(SessionEcho(1)));
+        auto plainSize = plain.frameSize_;
+
+        TEST_CHECK(2 == transport(SessionEcho(2))  &&  "client of the session test" == s_clientId);
+        auto definedSize = transport.frameSize_;
+
+        s_clientId.clear();
+        TEST_CHECK(3 == transport(SessionEcho(3))  &&  "client of the session test" == s_clientId);
+        auto sessionSize = transport.frameSize_;
+
+        cout << "Frame of SessionEcho(int): " << plainSize << " bytes without session, " << definedSize <<
+            " bytes defining the name, " << sessionSize << " bytes in session" << endl;
+
+        TEST_CHECK(sessionSize + 20 <= plainSize  &&  definedSize > sessionSize);
+
+        // Server lost the session, the call is sent again in a new one
+        RemoteCall::GetSessions()->Clear([](const std::string&) { return false; });
+        TEST_CHECK(0 == RemoteCall::GetSessions()->Count());
+
+        transport.frames_ = 0;
+        TEST_CHECK(4 == transport(SessionEcho(4)));
+        TEST_CHECK(3 == transport.frames_  &&  1 == RemoteCall::GetSessions()->Count());
+    }
+
+    // Confirmation and reset of a previous session do not change the current one
+    {
+        RemoteCall::ClientSession session;
+        session.Open(1);
+
+        RemoteCall::Serializer writer;
+        session.WriteName(writer, "SessionEcho");
+        TEST_CHECK(RemoteCall::StringDef == (uint8_t)writer.Data()[0]);
+
+        session.Reset(1);
+        session.Open(2);
+        session.Confirm(1, "SessionEcho");
+        session.Reset(1);
+        TEST_CHECK(2 == session.Id());
+
+        writer.clear();
+        session.WriteName(writer, "SessionEcho");
+        TEST_CHECK(RemoteCall::StringDef == (uint8_t)writer.Data()[0]);
+
+        session.Confirm(2, "SessionEcho");
+
+        writer.clear();
+        session.WriteName(writer, "SessionEcho");
+        TEST_CHECK(RemoteCall::StringRef == (uint8_t)writer.Data()[0]);
+    }
+
+    // Malformed names are rejected
+    {
+        RemoteCall::Session session("client", 0, 0, false);
+        string s;
+
+        RemoteCall::Serializer writer;
+        writer << (uint8_t)RemoteCall::StringRef << (uint16_t)7;
+        TEST_CHECK(RemoteCall::Exception::InvalidSession == ReadName(writer, &session, s));
+        TEST_CHECK(RemoteCall::Exception::InvalidSession == ReadName(writer, nullptr, s));
+
+        writer.clear();
+        writer << (uint8_t)RemoteCall::StringDef << (uint16_t)RemoteCall::MaxSessionStrings << string("SessionEcho");
+        TEST_CHECK(RemoteCall::Exception::InvalidSession == ReadName(writer, &session, s));
+
+        writer.clear();
+        writer << (uint8_t)RemoteCall::StringDef << (uint16_t)7;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadName(writer, &session, s));
+
+        writer.clear();
+        writer << (uint8_t)RemoteCall::StringRef << (uint8_t)7;
+        TEST_CHECK(RemoteCall::Exception::InvalidFrame == ReadName(writer, &session, s));
+
+        writer.clear();
+        writer << (uint8_t)RemoteCall::StringDef << (uint16_t)7 << string("SessionEcho");
+        TEST_CHECK(RemoteCall::Exception::NoError == ReadName(writer, &session, s)  &&  "SessionEcho" == s);
+
+        writer.clear();
+        writer << (uint8_t)RemoteCall::StringRef << (uint16_t)7;
+        TEST_CHECK(RemoteCall::Exception::NoError == ReadName(writer, &session, s)  &&  "SessionEcho" == s);
+    }
+
+    cout << "TestSession passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Tests of RemoteCallSharedBlob.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallSharedBlob.h"
+#include "RemoteCallSocket.h"
+
+#include <cstring>
+
+using namespace std;
+
+size_t BlobSumRemoteFunction(const RemoteCall::SharedBlob& blob);
+void BlobFillRemoteFunction(RemoteCall::SharedBlob& blob, char c);
+
+size_t REMOTE_FUNCTION_DECL(BlobSum)(const RemoteCall::SharedBlob& blob);
+void REMOTE_FUNCTION_DECL(BlobFill)(RemoteCall::SharedBlob& blob, char c);
+
+size_t REMOTE_FUNCTION_IMPL(BlobSum)(const RemoteCall::SharedBlob& blob)
+{
+    TEST_CHECK(!blob.Writable());
+
+    size_t sum = 0;
+    for (size_t i = 0; i < blob.Size(); i++)
+    {
+        sum += (unsigned char)blob.Data()[i];
+    }
+
+    return sum;
+}
+
+void REMOTE_FUNCTION_IMPL(BlobFill)(RemoteCall::SharedBlob& blob, char c)
+{
+    TEST_CHECK(blob.Writable());
+
+    memset(blob.Data(), c, blob.Size());
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Server in the same process, client is this process
+struct BlobTransport: public RemoteCall::Transport<BlobTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        RemoteCall::PeerScope scope(peerPid_);
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    pid_t peerPid_ = getpid();
+};
+
+// Blob as it is received from client
+static RemoteCall::SharedBlob Received(const string& handle, uint64_t offset, uint64_t size)
+{
+    RemoteCall::Serializer writer;
+    writer << handle << offset << size;
+
+    RemoteCall::Serializer reader((std::vector<char>)writer);
+
+    RemoteCall::SharedBlob blob;
+    reader >> blob;
+
+    return blob;
+}
+
+static bool Rejected(RemoteCall::SharedBlob blob, bool writable, pid_t peerPid = getpid())
+{
+    RemoteCall::PeerScope scope(peerPid);
+
+    try
+    {
+        blob.Map(writable);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return RemoteCall::Exception::ServerError == e.Error();
+    }
+
+    return false;
+}
+
+
+int main()
+{
+    BlobTransport transport;
+
+    RemoteCall::SharedBlob blob(1 << 20);
+    memset(blob.Data(), 1, blob.Size());
+
+    TEST_CHECK(transport(BlobSum(blob)) == 1 << 20);
+
+    auto slice = blob.Slice(5000, 10000);
+    transport(BlobFill(slice, 3));
+
+    TEST_CHECK(1 == blob.Data()[4999]  &&  3 == blob.Data()[5000]  &&  3 == blob.Data()[14999]  &&  1 == blob.Data()[15000]);
+    TEST_CHECK(transport(BlobSum(slice)) == 30000);
+
+    // SocketServer knows the client process of Unix domain socket
+    {
+        RemoteCall::SocketServer server("/tmp/RemoteCallTestBlob.sock", 1);
+        thread serverThread([&]() { server.Run(); });
+
+        {
+            RemoteCall::SocketTransport socketTransport("/tmp/RemoteCallTestBlob.sock", 5000);
+            TEST_CHECK(socketTransport(BlobSum(slice)) == 30000);
+        }
+
+        server.Stop();
+        serverThread.join();
+    }
+
+    // Blob of other process than the one which sent the frame
+    transport.peerPid_ = getpid() + 1;
+    bool rejected = false;
+    try
+    {
+        transport(BlobSum(blob));
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        rejected = RemoteCall::Exception::ServerError == e.Error();
+    }
+    TEST_CHECK(rejected);
+
+    // Handle of a blob created by this process
+    RemoteCall::SharedBlob small(4096);
+
+    RemoteCall::Serializer writer;
+    writer << small;
+
+    RemoteCall::Serializer reader((std::vector<char>)writer);
+    string handle;
+    reader >> handle;
+
+    TEST_CHECK(!Rejected(Received(handle, 0, 4096), true));
+
+    // Client is not known
+    TEST_CHECK(Rejected(Received(handle, 0, 4096), false, 0));
+
+    // Range outside of the memfd
+    TEST_CHECK(Rejected(Received(handle, 4096, 1), false));
+    TEST_CHECK(Rejected(Received(handle, 1, UINT64_MAX), false));
+
+    string self = RemoteCall::ToString() << "/proc/" << getpid() << "/fd/";
+
+    // Descriptor which is not memfd
+    int fd = open("/proc/self/exe", O_RDONLY | O_CLOEXEC);
+    TEST_CHECK(-1 != fd);
+    TEST_CHECK(Rejected(Received(self + to_string(fd), 0, 1), false));
+    close(fd);
+
+    // Handle which is not a descriptor of the client
+    TEST_CHECK(Rejected(Received("/etc/passwd", 0, 1), false));
+    TEST_CHECK(Rejected(Received(handle + "/../../1/fd/3", 0, 1), false));
+
+    cout << "TestSharedBlob passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Tests of RemoteCallSharedMemory.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+#include "RemoteCallSharedMemory.h"
+
+#include <thread>
+
+using namespace std;
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+// Capacity which is not a multiple of the cache line is rounded up, headers of the rings stay aligned
+static void TestRoundTrip(size_t capacity)
+{
+    RemoteCall::SharedMemoryServer server("", capacity);
+    RemoteCall::SharedMemoryTransport transport(dup(server.Channel().Fd()), 5000);
+
+    atomic<bool> stop(false);
+    thread serverThread([&]() { server.Run(stop, 10); });
+
+    for (int i = 0; i < 1000; i++)
+    {
+        vector<ABC> v = { { "A", i }, { string(i * 7, 'x'), 1 } };
+        auto ret = transport(TestSync(v, map<int, string>{ { 1, "R" }, { 9, "T" } }));
+
+        TEST_CHECK(10 == get<0>(ret)  &&  "RT" == get<1>(ret));
+        TEST_CHECK(i + 10 == v[0].n_  &&  (size_t)i * 7 + 1 == v[1].s_.size());
+    }
+
+    stop = true;
+    serverThread.join();
+}
+
+// Reply to a call which timed out is not taken by the next call
+static void TestLateReply()
+{
+    RemoteCall::SharedMemoryServer server("", 1 << 16);
+    RemoteCall::SharedMemoryTransport transport(dup(server.Channel().Fd()), 50);
+
+    vector<ABC> v = { { "A", 1 } };
+
+    bool timedOut = false;
+    try
+    {
+        transport(TestSync(v, map<int, string>{ { 1, "Late" } }));
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        timedOut = RemoteCall::Exception::TransportError == e.Error();
+    }
+
+    TEST_CHECK(timedOut);
+
+    // Late reply is in the ring before the next call is sent
+    TEST_CHECK(server.ProcessOne(0));
+
+    atomic<bool> stop(false);
+    thread serverThread([&]() { server.Run(stop, 10); });
+
+    v = { { "B", 2 } };
+    auto ret = transport(TestSync(v, map<int, string>{ { 2, "Next" } }));
+
+    TEST_CHECK(2 == get<0>(ret)  &&  "Next" == get<1>(ret)  &&  12 == v[0].n_);
+
+    stop = true;
+    serverThread.join();
+}
+
+// Client does not map rings which are outside of the shared memory
+static void TestTruncatedRegion()
+{
+    RemoteCall::SharedMemoryServer server("", 1 << 16);
+
+    int fd = memfd_create("RemoteCallTest", 0);
+    TEST_CHECK(-1 != fd);
+
+    // Initialized header of the server's channel, without its rings
+    vector<char> header(64);
+    TEST_CHECK(pread(server.Channel().Fd(), header.data(), header.size(), 0) == (ssize_t)header.size());
+    TEST_CHECK(pwrite(fd, header.data(), header.size(), 0) == (ssize_t)header.size());
+
+    bool rejected = false;
+    try
+    {
+        RemoteCall::SharedMemoryTransport transport(fd);
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        rejected = RemoteCall::Exception::TransportError == e.Error();
+    }
+
+    TEST_CHECK(rejected);
+}
+
+
+int main()
+{
+    TestRoundTrip(1 << 16);
+    TestRoundTrip(20004);
+    TestLateReply();
+    TestTruncatedRegion();
+
+    cout << "TestSharedMemory passed" << endl;
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+// Tests of RemoteCallSocket.h, built with TestServer.cpp. Also prints loopback round trip time of TestSync call.
+#include "TestRemoteCall.h"
+#include "RemoteCallSocket.h"
+
+#include <chrono>
+
+using namespace std;
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+template <typename F>
+static bool Fails(F f, RemoteCall::Exception::ErrorType error)
+{
+    try
+    {
+        f();
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return error == e.Error();
+    }
+
+    return false;
+}
+
+static void TestRoundTrip(const string& address, int workers, RemoteCall::SocketServer::Engine engine)
+{
+    RemoteCall::SocketServer server(address, workers, RemoteCall::SocketServer::Handler(), engine);
+    thread serverThread([&]() { server.Run(); });
+
+    {
+        RemoteCall::SocketTransport transport(address, 5000);
+
+        const int threads = 4;
+        const int calls = 5000;
+
+        auto start = chrono::steady_clock::now();
+
+        vector<thread> clients;
+        for (int c = 0; c < threads; c++)
+        {
+            clients.emplace_back([&, c]()
+            {
+                for (int i = 0; i < calls; i++)
+                {
+                    vector<ABC> v = { { "A", i }, { string(i % 300, 'x'), c } };
+                    auto ret = transport(TestSync(v, map<int, string>{ { 1, "R" }, { 9, "T" } }));
+
+                    TEST_CHECK(10 == get<0>(ret)  &&  i + 10 == v[0].n_  &&  c + 10 == v[1].n_);
+                }
+            });
+        }
+
+        for (auto& el: clients)
+        {
+            el.join();
+        }
+
+        auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+        cout << address << (server.UsesUring()? " io_uring": " epoll") << ", workers " << workers << ": " 
+            << (double)us / (threads * calls) << " us per call, " << threads << " client threads" << endl;
+
+        // Frame bigger than receive buffers
+        vector<ABC> v = { { string(300000, 'q'), 1 } };
+        transport(TestSync(v, map<int, string>()));
+        TEST_CHECK(300001 == v[0].s_.size()  &&  11 == v[0].n_);
+    }
+
+    server.Stop();
+    serverThread.join();
+}
+
+static void TestMaxFrameSize(const string& address)
+{
+    RemoteCall::SocketServer server(address);
+    server.SetMaxFrameSize(64 * 1024);
+
+    thread serverThread([&]() { server.Run(); });
+
+    {
+        RemoteCall::SocketTransport transport(address, 5000);
+
+        // Server closes connection with bigger frame
+        vector<ABC> v = { { string(100000, 'q'), 1 } };
+        TEST_CHECK(Fails([&]() { transport(TestSync(v, map<int, string>())); }, RemoteCall::Exception::TransportError));
+
+        // Client closes connection with bigger reply
+        transport.SetMaxFrameSize(1000);
+        v = { { string(2000, 'q'), 1 } };
+        TEST_CHECK(Fails([&]() { transport(TestSync(v, map<int, string>())); }, RemoteCall::Exception::TransportError));
+
+        transport.SetMaxFrameSize(64 * 1024);
+        v = { { "A", 1 } };
+        transport(TestSync(v, map<int, string>()));
+        TEST_CHECK(11 == v[0].n_);
+    }
+
+    server.Stop();
+    serverThread.join();
+}
+
+// Server which replies to the first frame of each connection and closes it after reading the second one
+struct DroppingServer
+{
+    explicit DroppingServer(const string& address)
+        : address_(address)
+    {
+        listen_ = socket(address_.Family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(address_.Path().c_str());
+
+        TEST_CHECK(0 == bind(listen_, address_.Addr(), address_.Length())  &&  0 == listen(listen_, 16));
+
+        thread_ = thread([this]() { Run(); });
+    }
+
+    ~DroppingServer()
+    {
+        shutdown(listen_, SHUT_RDWR);
+        thread_.join();
+
+        close(listen_);
+        unlink(address_.Path().c_str());
+    }
+
+    atomic<int> dropped_{0};
+
+private:
+    void Run()
+    {
+        while (true)
+        {
+            int fd = accept(listen_, nullptr, nullptr);
+            if (-1 == fd)
+                return;
+
+            vector<char> vIn;
+            if (Read(fd, vIn))
+            {
+                vector<char> vOut;
+                RemoteCall::ProcessCall(vIn, vOut);
+
+                RemoteCall::FrameLength length = (RemoteCall::FrameLength)vOut.size();
+                iovec iov[2] = { { &length, sizeof(length) }, { vOut.data(), vOut.size() } };
+
+                size_t sent;
+                RemoteCall::SendAll(fd, iov, 2, sent);
+
+                if (Read(fd, vIn))
+                {
+                    dropped_++;
+                }
+            }
+
+            close(fd);
+        }
+    }
+
+    static bool Read(int fd, vector<char>& v)
+    {
+        RemoteCall::FrameLength length;
+        size_t received;
+        if (!RemoteCall::ReceiveAll(fd, (char*)&length, sizeof(length), received))
+            return false;
+
+        v.resize(length);
+        return RemoteCall::ReceiveAll(fd, v.data(), length, received);
+    }
+
+private:
+    RemoteCall::SocketAddress address_;
+    int listen_;
+    thread thread_;
+};
+
+// Call which server could have executed is resent only if it is idempotent
+static void TestRetry(const string& address)
+{
+    {
+        DroppingServer server(address);
+        RemoteCall::SocketTransport transport(address, 5000);
+
+        vector<ABC> v = { { "A", 1 } };
+        transport(TestSync(v, map<int, string>()));
+
+        TEST_CHECK(Fails([&]() { transport(TestSync(v, map<int, string>())); }, RemoteCall::Exception::TransportError));
+        TEST_CHECK(1 == server.dropped_);
+    }
+
+    {
+        DroppingServer server(address);
+        RemoteCall::SocketTransport transport(address, 5000);
+
+        vector<ABC> v = { { "A", 1 } };
+        transport(TestSync(v, map<int, string>()));
+
+        v = { { "B", 2 } };
+        transport(TestSync(v, map<int, string>()).Idempotent());
+        TEST_CHECK(1 == server.dropped_  &&  12 == v[0].n_);
+    }
+}
+
+
+// Server falls back to epoll if io_uring cannot be set up, and to single-shot receive if multishot is rejected
+static void TestFallbacks(const string& address)
+{
+    auto& support = RemoteCall::GetUringSupport();
+
+    for (int i = 0; i < 2; i++)
+    {
+        support.setup_ = 1 == i;
+        support.multishotReceive_ = 0 == i;
+
+        RemoteCall::SocketServer server(address, 0, RemoteCall::SocketServer::Handler(), RemoteCall::SocketServer::IoUring);
+        thread serverThread([&]() { server.Run(); });
+
+        {
+            RemoteCall::SocketTransport transport(address, 5000);
+
+            for (int n = 0; n < 3; n++)
+            {
+                vector<ABC> v = { { string(n * 30000, 'f'), n } };
+                transport(TestSync(v, map<int, string>()));
+                TEST_CHECK(n * 30000 + 1 == (int)v[0].s_.size()  &&  n + 10 == v[0].n_);
+            }
+        }
+
+        server.Stop();
+        serverThread.join();
+
+        if (0 == i)
+        {
+            TEST_CHECK(!server.UsesUring()  &&  !server.UsesMultishotReceive());
+        }
+        else if (server.UsesUring())
+        {
+            TEST_CHECK(!server.UsesMultishotReceive());
+        }
+        else
+        {
+            cout << "io_uring is not available, multishot receive fallback is not tested" << endl;
+        }
+    }
+
+    support = RemoteCall::UringSupport();
+}
+
+
+int main()
+{
+    TestRoundTrip("unix:/tmp/RemoteCallTest.sock", 0, RemoteCall::SocketServer::Auto);
+    TestRoundTrip("/tmp/RemoteCallTest.sock", 2, RemoteCall::SocketServer::Auto);
+    TestRoundTrip("/tmp/RemoteCallTest.sock", 0, RemoteCall::SocketServer::Epoll);
+    TestRoundTrip("127.0.0.1:39123", 0, RemoteCall::SocketServer::Auto);
+    TestRoundTrip("127.0.0.1:39124", 3, RemoteCall::SocketServer::Epoll);
+
+    TestMaxFrameSize("/tmp/RemoteCallTest.sock");
+    TestRetry("/tmp/RemoteCallTest.sock");
+    TestFallbacks("/tmp/RemoteCallTest.sock");
+
+    cout << "TestSocket passed" << endl;
+
+    return 0;
+}
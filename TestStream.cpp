@@ -0,0 +1,164 @@
+// Tests of RemoteCallStream.h, built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <thread>
+
+using namespace std;
+
+static int s_produced = 0;
+static int s_alive = 0;
+
+struct Cursor
+{
+    Cursor(int n): n_(n) { s_alive++; }
+    ~Cursor() { s_alive--; }
+
+    int i_ = 0;
+    int n_;
+};
+
+RemoteCall::Stream<string> RangeRemoteFunction(int n);
+RemoteCall::Stream<string> REMOTE_FUNCTION_DECL(Range)(int n);
+
+RemoteCall::Stream<string> REMOTE_FUNCTION_IMPL(Range)(int n)
+{
+    auto pCursor = make_shared<Cursor>(n);
+
+    return RemoteCall::Stream<string>([pCursor](string& s)
+    {
+        if (pCursor->i_ == pCursor->n_)
+            return false;
+
+        s = to_string(pCursor->i_++);
+        s_produced++;
+
+        return true;
+    }, 100);
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct StreamTransport: public RemoteCall::Transport<StreamTransport>
+{
+    explicit StreamTransport(const string& clientId)
+        : clientId_(clientId)
+    {}
+
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        calls_++;
+        RemoteCall::ProcessCall(vIn, vOut);
+
+        return true;
+    }
+
+    std::string ClientId() const override
+    {
+        return clientId_;
+    }
+
+    string clientId_;
+    int calls_ = 0;
+};
+
+static bool Invalid(RemoteCall::Stream<string>& stream, size_t count)
+{
+    try
+    {
+        string s;
+        for (size_t i = 0; i < count; i++)
+        {
+            stream.Next(s);
+        }
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return RemoteCall::Exception::ServerError == e.Error();
+    }
+
+    return false;
+}
+
+
+int main()
+{
+    StreamTransport transport("A");
+
+    // Internal calls of streams are registered before the first stream is returned
+    TEST_CHECK(RemoteCall::FunctionCallers()->GetCaller("~StreamNext")  &&  RemoteCall::FunctionCallers()->GetCaller("~StreamCancel"));
+
+    // Chunks are requested when received items are consumed
+    {
+        auto stream = transport(Range(1000));
+
+        int i = 0;
+        for (auto& el: stream)
+        {
+            TEST_CHECK(to_string(i++) == el);
+        }
+
+        TEST_CHECK(1000 == i  &&  11 == transport.calls_);
+    }
+    TEST_CHECK(0 == s_alive);
+
+    // Destroyed stream is cancelled, server releases the producer
+    {
+        auto stream = transport(Range(1000));
+        stream.SetCredits(10);
+
+        string s;
+        for (int i = 0; i < 150; i++)
+        {
+            TEST_CHECK(stream.Next(s)  &&  to_string(i) == s);
+        }
+
+        TEST_CHECK(1000 + 150 == s_produced  &&  1 == s_alive);
+    }
+    TEST_CHECK(0 == s_alive);
+
+    {
+        auto stream = transport(Range(0));
+        TEST_CHECK(!(stream.begin() != stream.end()));
+    }
+
+    // Stream is read only by the client which received it
+    {
+        StreamTransport other("B");
+
+        auto stream = transport(Range(1000));
+        AttachTransport(stream, &other);
+
+        TEST_CHECK(Invalid(stream, 101));
+        TEST_CHECK(1 == s_alive);
+
+        // Cancel of other client is ignored
+        stream.Cancel();
+        TEST_CHECK(1 == s_alive);
+    }
+    TEST_CHECK(1 == s_alive);
+
+    // Abandoned streams are removed when streams are accessed after their idle timeout
+    {
+        RemoteCall::GetStreams()->SetIdleTimeout(chrono::milliseconds(50));
+
+        auto abandoned = transport(Range(1000));
+        TEST_CHECK(2 == s_alive);
+
+        this_thread::sleep_for(chrono::milliseconds(1100));
+
+        auto stream = transport(Range(1));
+        TEST_CHECK(0 == s_alive);
+
+        TEST_CHECK(Invalid(abandoned, 101));
+    }
+    TEST_CHECK(0 == s_alive);
+
+    cout << "TestStream passed" << endl;
+
+    return 0;
+}
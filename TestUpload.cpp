@@ -0,0 +1,217 @@
+// Tests of InputStream (RemoteCallStream.h) and detached calls (RemoteCallServer.h), built with TestServer.cpp
+#include "TestRemoteCall.h"
+
+#include <atomic>
+#include <thread>
+#include <future>
+#include <functional>
+
+using namespace std;
+
+static atomic<int> s_produced(0);
+static atomic<int> s_maxAhead(0);
+static atomic<bool> s_gate(false);
+
+long long SumRemoteFunction(const RemoteCall::InputStream<string>& rows, int k);
+long long REMOTE_FUNCTION_DECL(Sum)(const RemoteCall::InputStream<string>& rows, int k);
+
+// k == 3 returns before reading all items, k == 4 throws, k == 5 reads items when the gate is open
+long long REMOTE_FUNCTION_IMPL(Sum)(const RemoteCall::InputStream<string>& rows, int k)
+{
+    long long sum = 0;
+    int consumed = 0;
+
+    while (5 == k  &&  !s_gate)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    for (auto& el: rows)
+    {
+        sum += stoi(el) * k;
+        consumed++;
+
+        int ahead = s_produced - consumed;
+        if (ahead > s_maxAhead)
+        {
+            s_maxAhead = ahead;
+        }
+
+        if (500 == consumed  &&  3 == k)
+            break;
+
+        if (500 == consumed  &&  4 == k)
+            throw runtime_error("Handler exception");
+    }
+
+    return sum;
+}
+
+void ClientRequestHandler(const std::vector<char>& vIn)
+{
+    std::vector<char> vOut;
+    RemoteCall::ProcessCall(vIn, vOut);
+}
+
+
+struct UploadTransport: public RemoteCall::Transport<UploadTransport>
+{
+    bool SendReceive(const std::vector<char>& vIn, std::vector<char>& vOut)
+    {
+        calls_++;
+
+        if (beforeSend_)
+        {
+            beforeSend_(calls_);
+        }
+
+        if (!later_)
+        {
+            RemoteCall::ProcessCall(vIn, vOut);
+            return true;
+        }
+
+        // Reply which is not completed when ProcessCall returns opens the gate of the handler
+        promise<vector<char>> reply;
+        RemoteCall::ProcessCall(vIn, [&reply](vector<char>&& v) { reply.set_value(move(v)); });
+
+        auto future = reply.get_future();
+        if (future_status::ready != future.wait_for(chrono::seconds(0)))
+        {
+            completedLater_++;
+            s_gate = true;
+        }
+
+        vOut = future.get();
+
+        return true;
+    }
+
+    std::string ClientId() const override
+    {
+        return clientId_;
+    }
+
+    int calls_ = 0;
+    string clientId_ = "A";
+    function<void(int)> beforeSend_;
+
+    // Replies are completed via callback, number of replies completed after ProcessCall returned
+    bool later_ = false;
+    int completedLater_ = 0;
+};
+
+static RemoteCall::InputStream<string> Numbers(int n)
+{
+    auto pI = make_shared<int>(0);
+
+    return RemoteCall::InputStream<string>([pI, n](string& s)
+    {
+        if (n == *pI)
+            return false;
+
+        s = to_string((*pI)++);
+        s_produced++;
+
+        return true;
+    }, 100);
+}
+
+template <typename F>
+static bool Fails(F f, RemoteCall::Exception::ErrorType error)
+{
+    try
+    {
+        f();
+    }
+    catch (const RemoteCall::Exception& e)
+    {
+        return error == e.Error();
+    }
+
+    return false;
+}
+
+
+int main()
+{
+    UploadTransport transport;
+
+    // The first chunk is the last one
+    TEST_CHECK(90 == transport(Sum(Numbers(10), 2))  &&  1 == transport.calls_);
+
+    // Server reads chunks while they are received, at most a few chunks ahead
+    long long n = 100000;
+    s_produced = 0;
+    TEST_CHECK(n * (n - 1) / 2 == transport(Sum(Numbers((int)n), 1)));
+    TEST_CHECK(s_maxAhead <= 100 * 6);
+
+    s_produced = 0;
+    TEST_CHECK(3LL * 499 * 500 / 2 == transport(Sum(Numbers((int)n), 3)));
+
+    TEST_CHECK(Fails([&]() { transport(Sum(Numbers((int)n), 4)); }, RemoteCall::Exception::ServerError));
+
+    // Client producer throws, server call is cancelled
+    auto failing = RemoteCall::InputStream<string>([](string& s) -> bool
+    {
+        static int i = 0;
+        if (150 == i++)
+            throw runtime_error("Producer exception");
+
+        s = "1";
+        return true;
+    }, 100);
+
+    bool thrown = false;
+    try
+    {
+        transport(Sum(failing, 1));
+    }
+    catch (const runtime_error&)
+    {
+        thrown = true;
+    }
+    TEST_CHECK(thrown);
+
+    // Call is rejected if all threads of detached calls are busy (cancelled call above could still be finishing)
+    this_thread::sleep_for(chrono::milliseconds(200));
+    RemoteCall::GetDetachedCalls()->SetMaxThreads(1);
+
+    transport.calls_ = 0;
+    transport.beforeSend_ = [](int calls)
+    {
+        if (2 == calls)
+        {
+            UploadTransport other;
+            TEST_CHECK(Fails([&]() { other(Sum(Numbers(1000), 1)); }, RemoteCall::Exception::Overloaded));
+        }
+    };
+
+    TEST_CHECK(1000 * 999 / 2 == transport(Sum(Numbers(1000), 1)));
+
+    RemoteCall::GetDetachedCalls()->SetMaxThreads(64);
+
+    // Chunks are accepted only from the client of the call
+    transport.calls_ = 0;
+    transport.beforeSend_ = [&transport](int calls)
+    {
+        if (2 == calls)
+        {
+            transport.clientId_ = "B";
+        }
+    };
+
+    TEST_CHECK(Fails([&]() { transport(Sum(Numbers(1000), 1)); }, RemoteCall::Exception::ServerError));
+
+    // Thread which receives a chunk does not wait for the handler, reply is completed when the handler reads chunks
+    {
+        UploadTransport later;
+        later.later_ = true;
+
+        TEST_CHECK(5LL * 1000 * 999 / 2 == later(Sum(Numbers(1000), 5))  &&  later.completedLater_  &&  s_gate);
+    }
+
+    cout << "TestUpload passed" << endl;
+
+    return 0;
+}